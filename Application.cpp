@@ -21,10 +21,19 @@
 
 
 #include <avr/interrupt.h>
+#include <util/crc16.h>
 
 
 Application::Application()
-    : dht(3), rtc(), modeSelector(), storage(), logSystem(0, &storage)
+    : dht(3), rtc(), modeSelector(), storage(), logSystem(CONFIG_AREA_SIZE, &storage), burstBuffer(), scheduler(),
+#ifdef LR_PHASE_TRACE
+    phaseTrace(&storage),
+#endif
+    _logTask(Scheduler::InvalidTask), _interval(0), _lastTemperature(DHT22::InvalidValue), _lastHumidity(DHT22::InvalidValue),
+    _burstSamplesRemaining(0)
+#ifdef LR_LIVE_STREAM
+    , _streamDropCount(0), _streamReportedDropCount(0), _isStreamPending(false)
+#endif
 {
 }
 
@@ -44,6 +53,27 @@ namespace {
     
 // constants
 const char DATE_FORMAT[] PROGMEM = "%04d-%02d-%02d %02d:%02d:%02d";
+const uint8_t IMAGE_BLOCK_SIZE = 32; // The number of bytes read at once for an image.
+const uint16_t MAXIMUM_SLEEP_STEP = 60; // The maximum time in seconds to sleep without checking the RTC.
+
+static_assert(LR_BURST_POST_TRIGGER_SAMPLES > 0 && LR_BURST_POST_TRIGGER_SAMPLES < BurstBuffer::Capacity,
+    "The burst buffer needs space for the samples before and after the trigger.");
+static_assert(LR_BURST_SLOPE_SAMPLES < BurstBuffer::Capacity,
+    "The burst buffer needs space for the samples of the slope trigger.");
+
+const uint8_t SERIAL_TX_CAPACITY = SERIAL_TX_BUFFER_SIZE - 1; // The ring buffer keeps one slot free.
+
+#ifdef LR_LIVE_STREAM
+const uint8_t STREAM_DROP_LINE_LENGTH = 20; // "Dropped 4294967295\r\n"
+
+static_assert(LogRecord::MaximumTextLength + STREAM_DROP_LINE_LENGTH <= SERIAL_TX_CAPACITY,
+    "A record and the drop line have to fit into the transmit buffer.");
+#endif
+
+#ifdef LR_PHASE_TRACE_OUTPUT
+static_assert(PhaseTrace::MaximumTextLength <= SERIAL_TX_CAPACITY,
+    "A line of the phase trace has to fit into the transmit buffer.");
+#endif
 
     
 }
@@ -51,6 +81,7 @@ const char DATE_FORMAT[] PROGMEM = "%04d-%02d-%02d %02d:%02d:%02d";
 
 void Application::signalError(uint8_t errorNumber)
 {
+    storage.flush(); // Keep the buffered records.
     pinMode(SIGNAL_LED, OUTPUT);
     while (true) {
         for (uint8_t i = 0; i < errorNumber; ++i) {
@@ -95,13 +126,194 @@ void Application::sendDurationToSerial(uint32_t seconds)
 }
 
 
+#ifdef LR_APPLICATION_DEBUG
+void Application::sendStorageStatisticsToSerial()
+{
+#if defined(LR_STORAGE_FRAM) && defined(LR_STORAGE_READ_CACHE_SIZE)
+    Serial.print(F("Read cache hits: "));
+    Serial.print(storage.getCacheHits());
+    Serial.print(F(" misses: "));
+    Serial.println(storage.getCacheMisses());
+#endif
+#ifdef LR_STORAGE_BLOCK
+    Serial.print(F("Block reads: "));
+    Serial.print(storage.getBlockReads());
+    Serial.print(F(" writes: "));
+    Serial.println(storage.getBlockWrites());
+#endif
+}
+#endif
+
+
+void Application::sendRecordsToSerial()
+{
+    sendRecordsToSerial(0, logSystem.currentNumberOfRecords());
+}
+
+
+void Application::sendRecordsToSerial(uint32_t first, uint32_t end)
+{
+    Serial.print(F("Sending "));
+    const uint32_t numberOfRecords = end - first;
+    Serial.print(numberOfRecords);
+    Serial.println(F(" records."));
+#ifdef LR_APPLICATION_DEBUG
+    const uint32_t readStartTime = millis();
+#endif
+    for (const LogRecordView &view : logSystem.getRecords(first, end)) {
+        view.writeToSerial();
+    }
+#ifdef LR_APPLICATION_DEBUG
+    Serial.print(F("Read time: "));
+    Serial.print(millis() - readStartTime);
+    Serial.println(F("ms"));
+    sendStorageStatisticsToSerial();
+#endif
+}
+
+
+void Application::sendSessionsToSerial()
+{
+    const uint16_t numberOfSessions = logSystem.currentNumberOfSessions();
+    Serial.print(numberOfSessions);
+    Serial.println(F(" sessions."));
+    for (uint16_t i = 0; i < numberOfSessions; ++i) {
+        Serial.print(i);
+        Serial.print(F(": "));
+        const LogSession session = logSystem.getSession(i);
+        if (session.isNull()) {
+            Serial.println(F("Session record overwritten or corrupted."));
+        } else {
+            session.writeToSerial();
+        }
+    }
+}
+
+
+void Application::sendSessionToSerial(uint16_t session)
+{
+    const LogSession logSession = logSystem.getSession(session);
+    if (logSession.isNull()) {
+        Serial.println(F("Unknown session."));
+        return;
+    }
+    sendRecordsToSerial(logSession.getRecordIndex(), logSystem.getSessionEnd(session));
+}
+
+
+void Application::sendRollupsToSerial(uint32_t tier)
+{
+    if (tier >= LogRollup::TierCount) {
+        Serial.println(F("Unknown tier."));
+        return;
+    }
+    const LogRollup::Tier rollupTier = static_cast<LogRollup::Tier>(tier);
+    Serial.print(F("Sending "));
+    const uint16_t numberOfRollups = logSystem.currentNumberOfRollups(rollupTier);
+    Serial.print(numberOfRollups);
+    Serial.println(rollupTier == LogRollup::Daily ? F(" daily rollups.") : F(" hourly rollups."));
+    for (uint16_t i = 0; i < numberOfRollups; ++i) {
+        const LogRollup rollup = logSystem.getRollup(rollupTier, i);
+        if (!rollup.isNull()) {
+            rollup.writeToSerial();
+        }
+    }
+    const LogRollup currentRollup = logSystem.getCurrentRollup(rollupTier);
+    if (!currentRollup.isNull()) {
+        currentRollup.writeToSerial();
+    }
+}
+
+
+uint32_t Application::readNumberFromSerial()
+{
+    uint32_t result = 0;
+    while (true) {
+        while (Serial.available() == 0) {
+        }
+        const int character = Serial.read();
+        if (character < '0' || character > '9') {
+            return result;
+        }
+        result = result * 10 + (character - '0');
+    }
+}
+
+
+void Application::sendImageToSerial()
+{
+    // The image is framed by a line with its size and a line with the CRC-16.
+    const uint32_t size = storage.size();
+    Serial.print(F("IMAGE "));
+    Serial.println(size);
+    uint8_t buffer[IMAGE_BLOCK_SIZE];
+    uint16_t crc = 0xffff;
+    for (uint32_t index = 0; index < size; index += IMAGE_BLOCK_SIZE) {
+        const uint8_t blockSize = static_cast<uint8_t>(min(size - index, static_cast<uint32_t>(IMAGE_BLOCK_SIZE)));
+        storage.readBytes(index, buffer, blockSize);
+        for (uint8_t i = 0; i < blockSize; ++i) {
+            crc = _crc16_update(crc, buffer[i]);
+        }
+        Serial.write(buffer, blockSize);
+    }
+    Serial.println();
+    Serial.print(F("CRC "));
+    Serial.println(crc, HEX);
+}
+
+
+void Application::processCommands()
+{
+    Serial.println(F("Command selected. Commands: r = records, l = list sessions, d<n> = records of session n, u<n> = rollups of tier n (0 = hourly, 1 = daily), s = statistics, i = raw storage image."));
+#ifdef LR_PHASE_TRACE_PERSIST
+    Serial.println(F("Phase trace enabled. Commands: t = persisted phase trace."));
+#endif
+    while (true) {
+        while (Serial.available() == 0) {
+        }
+        switch (Serial.read()) {
+            case 'r':
+                sendRecordsToSerial();
+                break;
+            case 'l':
+                sendSessionsToSerial();
+                break;
+            case 'd':
+                sendSessionToSerial(static_cast<uint16_t>(readNumberFromSerial()));
+                break;
+            case 'u':
+                sendRollupsToSerial(readNumberFromSerial());
+                break;
+            case 's':
+                logSystem.getStatistics().writeToSerial();
+                break;
+            case 'i':
+                sendImageToSerial();
+                break;
+#ifdef LR_PHASE_TRACE_PERSIST
+            case 't':
+                phaseTrace.writePersistedToSerial();
+                break;
+#endif
+            case '\r':
+            case '\n':
+            case ' ':
+                break;
+            default:
+                Serial.println(F("Unknown command."));
+                break;
+        }
+    }
+}
+
+
 void Application::setup()
 {
     // Initialize the serial interface.
     Serial.begin(57600);
 
     // Initialize all libraries
-    Wire.begin();
+    I2CBus::begin();
     dht.begin();
     rtc.begin();
     modeSelector.begin();
@@ -116,8 +328,19 @@ void Application::setup()
     }
     
     // Initialize the log system.
+#ifdef LR_APPLICATION_DEBUG
+    const uint32_t scanStartTime = millis();
+#endif
     logSystem.begin();
+#ifdef LR_APPLICATION_DEBUG
+    Serial.print(F("Storage scan: "));
+    Serial.print(millis() - scanStartTime);
+    Serial.println(F("ms"));
+    sendStorageStatisticsToSerial();
+#endif
 
+    // The storage leaves the bus at the clock of the FRAM.
+    I2CBus::select(I2CBus::RealTimeClock);
     if (!rtc.isrunning()) {
         Serial.println(F("Warning! RTC is not running."));
         signalError(3);
@@ -125,19 +348,15 @@ void Application::setup()
     
     // Check the mode.
     if (modeSelector.getMode() == ModeSelector::Read) {
-        Serial.print(F("Read selected. Sending "));
-        const uint32_t numberOfRecords = logSystem.currentNumberOfRecords();
-        Serial.print(numberOfRecords);
-        Serial.println(F(" records."));
-        for (uint32_t i = 0; i < numberOfRecords; ++i) {
-            LogRecord record = logSystem.getLogRecord(i);
-            record.writeToSerial();
-        }
+        Serial.print(F("Read selected. "));
+        sendRecordsToSerial();
         Serial.println(F("Finished successfully. Enter sleep mode."));
         Serial.flush();
         set_sleep_mode(B010); // Enter power-down mode.
         cli(); // no interrupts to wake the cpu again.
         sleep_mode(); // enter sleep mode.
+    } else if (modeSelector.getMode() == ModeSelector::Command) {
+        processCommands();
     } else if (modeSelector.getMode() == ModeSelector::Format) {
         Serial.println(F("Format (!) selected. Format is starting in ~10 seconds."));
         // using LED on pin 13 to blink aggresively.
@@ -157,6 +376,7 @@ void Application::setup()
         }
         Serial.println(F("Erasing all logged records..."));
         logSystem.format();
+        storage.flush();
         Serial.println(F("Format finished successfully. Enter sleep mode."));
         Serial.flush();
         set_sleep_mode(B010); // Enter power-down mode.
@@ -168,24 +388,31 @@ void Application::setup()
         Serial.println(modeSelector.getIntervalText());
         Serial.print(F("Maximum records: "));
         Serial.println(logSystem.maximumNumberOfRecords());
+        // Start a new session in the log.
+        I2CBus::select(I2CBus::RealTimeClock);
+        _currentTime = rtc.now();
+        if (!logSystem.appendSession(_currentTime, modeSelector.getInterval())) {
+            signalError(5);
+        }
+        storage.flush();
+        Serial.print(F("Session: "));
+        Serial.println(logSystem.currentNumberOfSessions() - 1);
         Serial.print(F("Current records: "));
         Serial.println(logSystem.currentNumberOfRecords());
-        // calculate how long we can record data.
-        const uint32_t availableRecords = logSystem.maximumNumberOfRecords()-logSystem.currentNumberOfRecords();
-        Serial.print(F("Avaliable records: "));
-        Serial.println(availableRecords);
-        const uint32_t recordingTime = (availableRecords*modeSelector.getInterval());
-        Serial.print(F("Recording time: "));
+        // calculate how long the history in the ring is.
+        const uint32_t recordingTime = (logSystem.maximumNumberOfRecords()*modeSelector.getInterval());
+        Serial.print(F("Record history: "));
         sendDurationToSerial(recordingTime);
         Serial.println();
+        Serial.print(F("Hourly rollups: "));
+        Serial.println(logSystem.maximumNumberOfRollups(LogRollup::Hourly));
+        Serial.print(F("Daily rollups: "));
+        Serial.println(logSystem.maximumNumberOfRollups(LogRollup::Daily));
         Serial.print(F("Current time: "));
+        I2CBus::select(I2CBus::RealTimeClock);
         _currentTime = rtc.now();
         sendDateTimeToSerial(_currentTime);
         Serial.println();
-        const DateTime recordingEndTime = DateTime(_currentTime.unixtime() + recordingTime);
-        Serial.print(F("Recording end time: "));
-        sendDateTimeToSerial(recordingEndTime);
-        Serial.println();
         
         // Enable the red led as output.
         pinMode(SIGNAL_LED, OUTPUT);
@@ -200,68 +427,343 @@ void Application::setup()
         TIMSK2 = _BV(TOIE2); // Interrupt on overflow.
         sei(); // Allow interrupts.
         
-        // Keep the sleep interval between 1s and 1m
-        _sleepDelay = min(modeSelector.getInterval() / 10, 60);
+        // An adaptive interval starts with the shortest interval.
+        if (modeSelector.isAdaptive()) {
+            _interval = LR_ADAPTIVE_MINIMUM_INTERVAL;
+        } else {
+            _interval = modeSelector.getInterval();
+        }
         
-        // Set the next record time.
-        _nextRecordTime = DateTime(_currentTime.unixtime() + modeSelector.getInterval());
+        // Logging is a task, which writes the first record right now. In
+        // burst mode, the task samples the sensor and writes the records
+        // at the next record time.
+        if (modeSelector.isBurst()) {
+            _nextRecordTime = _currentTime;
+            _logTask = scheduler.addTask(&Application::onLogTask, this, LR_BURST_SAMPLE_INTERVAL, _currentTime.unixtime());
+        } else {
+            _logTask = scheduler.addTask(&Application::onLogTask, this, _interval, _currentTime.unixtime());
+        }
+#ifdef LR_STORAGE_BLOCK
+        // New records are collected in the block buffer, which is written in a fixed interval.
+        scheduler.addTask(&Application::onFlushTask, this, LR_STORAGE_FLUSH_INTERVAL, _currentTime.unixtime() + LR_STORAGE_FLUSH_INTERVAL);
+#endif
     }
 }
 
 
 void Application::loop()
+{
+    scheduler.runDueTasks(_currentTime.unixtime());
+    sleepUntil(scheduler.getNextDeadline());
+}
+
+
+void Application::onLogTask(void *context)
+{
+    static_cast<Application*>(context)->logTask();
+}
+
+
+void Application::logTask()
 {
     // Read the values from the sensor
-    DHT22::Measurement measurement = dht.readTemperatureAndHumidity();
-    
-    // Check for read errors from the sensor.
-    if (measurement.humidity == NAN || measurement.temperature == NAN) {
-        signalError(6);
+#ifdef LR_PHASE_TRACE
+    const uint32_t sensorStart = micros();
+#endif
+    uint8_t attempts;
+    const DHT22::Measurement measurement = readSensor(attempts);
+#ifdef LR_PHASE_TRACE
+    phaseTrace.add(PhaseTrace::Sensor, sensorStart, attempts);
+    const uint32_t writeStart = micros();
+    const uint32_t recordCount = logSystem.totalNumberOfRecords();
+#endif
+    writeSample(measurement, attempts);
+#ifdef LR_PHASE_TRACE
+    phaseTrace.add(PhaseTrace::Write, writeStart, static_cast<uint16_t>(logSystem.totalNumberOfRecords() - recordCount));
+#endif
+}
+
+
+void Application::writeSample(const DHT22::Measurement &measurement, uint8_t attempts)
+{
+    // Keep logging if the sensor could not be read, and write the error instead.
+    if (!measurement.isValid()) {
+        const LogError logError(_currentTime, measurement.status == DHT22::StatusChecksumError ?
+            LogError::SensorChecksum : LogError::SensorTimeout, attempts);
+        if (modeSelector.isBurst()) {
+            burstErrorTask(logError);
+        } else {
+            writeError(logError);
+        }
+        return;
     }
     
     // Write the record
     LogRecord logRecord(_currentTime, measurement.temperature, measurement.humidity);
+    if (modeSelector.isBurst()) {
+        burstTask(logRecord);
+        return;
+    }
     if (!logSystem.appendRecord(logRecord)) {
         // storage is full
         signalError(5);
     }
+#ifdef LR_LIVE_STREAM
+    streamRecord(logRecord);
+#endif
 
 #ifdef LR_APPLICATION_DEBUG
-    Serial.print(F("Write log: t:"));
-    Serial.print(measurement.temperature);
-    Serial.print(F("C h:"));
-    Serial.print(measurement.humidity);
-    Serial.print(F("% time:"));
-    sendDateTimeToSerial(_currentTime);
-    Serial.println();
+    Serial.print(F("Write log: "));
+    logRecord.writeToSerial();
     Serial.flush();
 #endif
     
-    // Wait until we reached the right time.
+    if (modeSelector.isAdaptive()) {
+        adaptInterval(measurement);
+    }
+}
+
+
+DHT22::Measurement Application::readSensor(uint8_t &attempts)
+{
+    // The retries have to end before the next run of the log task. Each
+    // retry takes the delay and up to one second for the read itself.
+    const uint32_t period = modeSelector.isBurst() ? LR_BURST_SAMPLE_INTERVAL : _interval;
+    const uint32_t maximumRetries = (period - 1) / (LR_SENSOR_RETRY_DELAY + 1);
+    DHT22::Measurement measurement = dht.readTemperatureAndHumidity();
+    attempts = 1;
+    while (!measurement.isValid() && attempts < LR_SENSOR_READ_ATTEMPTS && attempts <= maximumRetries) {
+        powerSave(LR_SENSOR_RETRY_DELAY);
+        measurement = dht.readTemperatureAndHumidity();
+        ++attempts;
+    }
+    return measurement;
+}
+
+
+void Application::writeError(const LogError &logError)
+{
+    if (!logSystem.appendError(logError)) {
+        // storage is full
+        signalError(5);
+    }
+#ifdef LR_APPLICATION_DEBUG
+    Serial.print(F("Write error: "));
+    logError.writeToSerial();
+    Serial.flush();
+#endif
+}
+
+
+#ifdef LR_STORAGE_BLOCK
+void Application::onFlushTask(void *context)
+{
+    static_cast<Application*>(context)->storage.flush();
+}
+#endif
+
+
+void Application::adaptInterval(const DHT22::Measurement &measurement)
+{
+    uint32_t interval;
+    if (_lastTemperature == DHT22::InvalidValue ||
+        abs(measurement.temperature - _lastTemperature) >= LR_ADAPTIVE_TEMPERATURE_DELTA ||
+        abs(measurement.humidity - _lastHumidity) >= LR_ADAPTIVE_HUMIDITY_DELTA) {
+        interval = LR_ADAPTIVE_MINIMUM_INTERVAL;
+    } else {
+        interval = min(_interval * 2, modeSelector.getInterval());
+    }
+    _lastTemperature = measurement.temperature;
+    _lastHumidity = measurement.humidity;
+    _interval = interval;
+    scheduler.setPeriod(_logTask, interval);
+}
+
+
+
+bool Application::isBurstTriggered() const
+{
+    if (burstBuffer.count() < 2) {
+        return false;
+    }
+    const LogRecord &latest = burstBuffer.getRecord(0);
+    const LogRecord &previous = burstBuffer.getRecord(1);
+    if ((latest.getTemperature() > LR_BURST_TEMPERATURE_THRESHOLD && previous.getTemperature() <= LR_BURST_TEMPERATURE_THRESHOLD) ||
+        (latest.getHumidity() > LR_BURST_HUMIDITY_THRESHOLD && previous.getHumidity() <= LR_BURST_HUMIDITY_THRESHOLD)) {
+        return true;
+    }
+    if (burstBuffer.count() <= LR_BURST_SLOPE_SAMPLES) {
+        return false;
+    }
+    const LogRecord &earlier = burstBuffer.getRecord(LR_BURST_SLOPE_SAMPLES);
+    return abs(latest.getTemperature() - earlier.getTemperature()) >= LR_BURST_TEMPERATURE_DELTA ||
+        abs(latest.getHumidity() - earlier.getHumidity()) >= LR_BURST_HUMIDITY_DELTA;
+}
+
+
+void Application::burstTask(const LogRecord &logRecord)
+{
+    burstBuffer.add(logRecord);
+    if (_burstSamplesRemaining > 0) {
+        // Write all pending samples after the last sample of the burst.
+        if (--_burstSamplesRemaining == 0) {
+            const LogRecord *pendingRecords = burstBuffer.getPendingRecords();
+            if (!logSystem.appendRecords(pendingRecords, burstBuffer.pendingCount())) {
+                signalError(5);
+            }
+#ifdef LR_LIVE_STREAM
+            for (uint8_t i = 0; i < burstBuffer.pendingCount(); ++i) {
+                streamRecord(pendingRecords[i]);
+            }
+#endif
+#ifdef LR_APPLICATION_DEBUG
+            Serial.print(F("Write burst: "));
+            Serial.print(burstBuffer.pendingCount());
+            Serial.println(F(" records."));
+            Serial.flush();
+#endif
+            burstBuffer.markWritten();
+        }
+    } else if (isBurstTriggered()) {
+        _burstSamplesRemaining = LR_BURST_POST_TRIGGER_SAMPLES;
+    } else if (_currentTime.unixtime() >= _nextRecordTime.unixtime()) {
+        // A regular record. The older samples are no longer written, to keep the log in time order.
+        if (!logSystem.appendRecord(logRecord)) {
+            signalError(5);
+        }
+#ifdef LR_LIVE_STREAM
+        streamRecord(logRecord);
+#endif
+#ifdef LR_APPLICATION_DEBUG
+        Serial.print(F("Write log: "));
+        logRecord.writeToSerial();
+        Serial.flush();
+#endif
+        burstBuffer.markWritten();
+    }
+    // Skip regular records which were covered by a burst.
+    while (_nextRecordTime.unixtime() <= _currentTime.unixtime()) {
+        _nextRecordTime = DateTime(_nextRecordTime.unixtime() + _interval);
+    }
+}
+
+
+void Application::burstErrorTask(const LogError &logError)
+{
+    if (_burstSamplesRemaining > 0 || _currentTime.unixtime() < _nextRecordTime.unixtime()) {
+        return;
+    }
+    // The older samples are no longer written, to keep the log in time order.
+    writeError(logError);
+    burstBuffer.markWritten();
+    while (_nextRecordTime.unixtime() <= _currentTime.unixtime()) {
+        _nextRecordTime = DateTime(_nextRecordTime.unixtime() + _interval);
+    }
+}
+
+
+#ifdef LR_LIVE_STREAM
+void Application::streamRecord(const LogRecord &logRecord)
+{
+    // Serial.write() waits if the buffer is full, so only complete lines
+    // are sent, which fit into the free space.
+    uint8_t requiredSpace = LogRecord::MaximumTextLength;
+    if (_streamDropCount != _streamReportedDropCount) {
+        requiredSpace += STREAM_DROP_LINE_LENGTH;
+    }
+    if (Serial.availableForWrite() < requiredSpace) {
+        ++_streamDropCount;
+        return;
+    }
+    if (_streamDropCount != _streamReportedDropCount) {
+        Serial.print(F("Dropped "));
+        Serial.println(_streamDropCount);
+        _streamReportedDropCount = _streamDropCount;
+    }
+    logRecord.writeToSerial();
+    _isStreamPending = true;
+}
+
+
+void Application::finishStream()
+{
+    if (!_isStreamPending) {
+        return;
+    }
+    waitForSerial(SERIAL_TX_CAPACITY);
+    _isStreamPending = false;
+}
+#endif
+
+
+#ifdef LR_PHASE_TRACE_OUTPUT
+void Application::writePhaseTrace()
+{
+    // Less than half of the ring is added while the logger is awake, so no entry is lost.
+    const uint8_t count = phaseTrace.getUnsentCount();
+    if (count < LR_PHASE_TRACE_SIZE / 2) {
+        return;
+    }
+    const uint32_t outputStart = micros();
+    while (phaseTrace.getUnsentCount() > 0) {
+        waitForSerial(PhaseTrace::MaximumTextLength);
+        phaseTrace.writeUnsentEntryToSerial();
+    }
+    waitForSerial(SERIAL_TX_CAPACITY);
+    phaseTrace.add(PhaseTrace::Output, outputStart, count);
+}
+#endif
+
+
+#if defined(LR_LIVE_STREAM) || defined(LR_PHASE_TRACE_OUTPUT)
+void Application::waitForSerial(uint8_t space)
+{
+    // The interrupts of the UART and the timer wake the processor from idle mode.
+    SMCR = 0; // Idle mode.
+    while (Serial.availableForWrite() < space || (space >= SERIAL_TX_CAPACITY && (UCSR0A & _BV(TXC0)) == 0)) {
+        SMCR |= _BV(SE);
+        sleep_cpu();
+        SMCR &= ~_BV(SE);
+    }
+}
+#endif
+
+
+void Application::sleepUntil(uint32_t deadline)
+{
+    // The timer is not precise. Sleep in steps and check the real time
+    // clock after each step, until the deadline is reached.
     while (true) {
-        powerSave(_sleepDelay);
+#ifdef LR_PHASE_TRACE
+        const uint32_t clockStart = micros();
+#endif
+        I2CBus::select(I2CBus::RealTimeClock);
         _currentTime = rtc.now();
-        const int32_t secondsToNextRecord = _nextRecordTime.unixtime()-_currentTime.unixtime();
-        if (secondsToNextRecord<_sleepDelay) {
-            if (secondsToNextRecord > 0) {
-                powerSave(secondsToNextRecord);
-            }
+#ifdef LR_PHASE_TRACE
+        phaseTrace.add(PhaseTrace::Clock, clockStart, 0);
+#endif
+        if (_currentTime.unixtime() >= deadline) {
             break;
         }
+        const uint32_t secondsToDeadline = deadline - _currentTime.unixtime();
+        // A flash chip erases the next sector while the logger sleeps.
+        logSystem.eraseAhead();
+        powerSave(secondsToDeadline < MAXIMUM_SLEEP_STEP ? secondsToDeadline : MAXIMUM_SLEEP_STEP);
     }
-    
-    // Read the current time for the log entry.
-    _currentTime = rtc.now();
-    
-    // Increase the next record time. This will keep the timing stable, even
-    // if we do not wake up precise at the right time.
-    _nextRecordTime = DateTime(_nextRecordTime.unixtime() + modeSelector.getInterval());
 }
 
 
-
 void Application::powerSave(uint16_t seconds)
 {
+#ifdef LR_LIVE_STREAM
+    finishStream();
+#endif
+#ifdef LR_PHASE_TRACE_OUTPUT
+    writePhaseTrace();
+#endif
+#ifdef LR_PHASE_TRACE
+    const uint32_t sleepStart = micros();
+#endif
     // Go to sleep (for 1/60s).
     SMCR = _BV(SM1)|_BV(SM0); // Power-save mode.
     const uint32_t waitIntervals = (seconds*61); // This is almost a second.
@@ -271,6 +773,10 @@ void Application::powerSave(uint16_t seconds)
         sleep_cpu();
         SMCR &= ~_BV(SE); // Disable sleep mode.
     }
+#ifdef LR_PHASE_TRACE
+    // The timer of micros() stops while sleeping, only the awake time is traced.
+    phaseTrace.add(PhaseTrace::Sleep, sleepStart, static_cast<uint16_t>(min(waitIntervals, static_cast<uint32_t>(0xffff))));
+#endif
 }
 
 
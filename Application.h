@@ -32,10 +32,15 @@
 #include <avr/sleep.h>
 
 // Local libraries
+#include "ConfigArea.h"
+#include "I2CBus.h"
 #include "Storage.h"
 #include "LogSystem.h"
 #include "ModeSelector.h"
+#include "BurstBuffer.h"
+#include "Scheduler.h"
 #include "DHT22.h"
+#include "PhaseTrace.h"
 
 
 // The pin for the signal LED
@@ -45,6 +50,62 @@
 //#define LR_APPLICATION_DEBUG
 
 
+// Uncomment to send each new record to the serial while logging.
+// Records which do not fit into the transmit buffer are dropped.
+//#define LR_LIVE_STREAM
+
+
+// The shortest interval in seconds for the adaptive interval.
+#define LR_ADAPTIVE_MINIMUM_INTERVAL 10
+
+// The change of the temperature in 1/10 degrees between two records,
+// which switches the adaptive interval to the shortest interval.
+#define LR_ADAPTIVE_TEMPERATURE_DELTA 5
+
+// The change of the humidity in 1/10 percent between two records,
+// which switches the adaptive interval to the shortest interval.
+#define LR_ADAPTIVE_HUMIDITY_DELTA 20
+
+
+// The maximum number of reads of the sensor for one sample. The retries
+// are limited to the time until the next sample.
+#define LR_SENSOR_READ_ATTEMPTS 3
+
+// The wait in seconds before a read is repeated. The DHT22 needs
+// two seconds between two reads.
+#define LR_SENSOR_RETRY_DELAY 2
+
+
+// The interval in seconds between two samples in burst mode.
+#define LR_BURST_SAMPLE_INTERVAL 2
+
+// The number of samples written after the trigger of a burst.
+// The remaining space of the burst buffer holds the samples before it.
+#define LR_BURST_POST_TRIGGER_SAMPLES 12
+
+// The number of samples to look back for the slope trigger.
+#define LR_BURST_SLOPE_SAMPLES 5
+
+// The change of the temperature in 1/10 degrees over the slope
+// samples, which triggers a burst.
+#define LR_BURST_TEMPERATURE_DELTA 5
+
+// The change of the humidity in 1/10 percent over the slope
+// samples, which triggers a burst.
+#define LR_BURST_HUMIDITY_DELTA 30
+
+// The temperature in 1/10 degrees which triggers a burst if it is exceeded.
+#define LR_BURST_TEMPERATURE_THRESHOLD 400
+
+// The humidity in 1/10 percent which triggers a burst if it is exceeded.
+#define LR_BURST_HUMIDITY_THRESHOLD 900
+
+
+// The maximum time in seconds new records stay in the block buffer of the
+// SD card storage. A power loss loses at most the records of this time.
+#define LR_STORAGE_FLUSH_INTERVAL 600
+
+
 /// The application
 ///
 class Application
@@ -80,6 +141,176 @@ private:
     ///
     void sendDurationToSerial(uint32_t seconds);
     
+#ifdef LR_APPLICATION_DEBUG
+    /// Send the statistics of the storage to the serial.
+    ///
+    void sendStorageStatisticsToSerial();
+#endif
+    
+    /// Send all records as text to the serial.
+    ///
+    void sendRecordsToSerial();
+    
+    /// Send a range of records as text to the serial.
+    ///
+    /// Session records are sent as a line which starts with `Session`,
+    /// error records as a line which starts with `Sensor error`.
+    ///
+    /// @param first The index of the first record.
+    /// @param end The index after the last record.
+    ///
+    void sendRecordsToSerial(uint32_t first, uint32_t end);
+    
+    /// Send a list of all sessions to the serial.
+    ///
+    void sendSessionsToSerial();
+    
+    /// Send the records of one session to the serial.
+    ///
+    void sendSessionToSerial(uint16_t session);
+    
+    /// Send the rollups of one tier as text to the serial.
+    ///
+    /// The rollup of the current period is sent last, it is incomplete.
+    ///
+    /// @param tier The number of the tier, see `LogRollup::Tier`.
+    ///
+    void sendRollupsToSerial(uint32_t tier);
+    
+    /// Read a decimal number from the serial.
+    ///
+    /// The number ends with the first character which is not a digit.
+    ///
+    uint32_t readNumberFromSerial();
+    
+    /// Send the raw storage image to the serial.
+    ///
+    /// The image is sent verbatim, between a line `IMAGE <size>` and
+    /// a line `CRC <crc-16 in hex>`.
+    ///
+    void sendImageToSerial();
+    
+    /// Process commands from the serial, forever.
+    ///
+    void processCommands();
+    
+    /// The task function for the log task.
+    ///
+    static void onLogTask(void *context);
+    
+    /// The log task.
+    ///
+    /// Reads the sensor and writes a record. If the sensor could not
+    /// be read, an error record is written instead.
+    ///
+    void logTask();
+    
+    /// Write the record for a sample, or the error if the sensor could not be read.
+    ///
+    /// @param measurement The measurement of the sample.
+    /// @param attempts The number of reads for the measurement.
+    ///
+    void writeSample(const DHT22::Measurement &measurement, uint8_t attempts);
+    
+    /// Read the sensor, and repeat failed reads.
+    ///
+    /// A failed read is repeated after `LR_SENSOR_RETRY_DELAY` seconds,
+    /// up to `LR_SENSOR_READ_ATTEMPTS` reads. Only as many reads are
+    /// done as end before the next run of the log task.
+    ///
+    /// @param attempts Set to the number of reads.
+    /// @return The measurement of the last read.
+    ///
+    DHT22::Measurement readSensor(uint8_t &attempts);
+    
+    /// Write an error record for a failed measurement.
+    ///
+    void writeError(const LogError &logError);
+    
+#ifdef LR_STORAGE_BLOCK
+    /// The task function to write the buffered block to the card.
+    ///
+    static void onFlushTask(void *context);
+#endif
+    
+    /// Adapt the interval to the change of the measured values.
+    ///
+    /// If the values changed more than the thresholds since the last
+    /// record, the interval is set to the shortest interval. Otherwise
+    /// it is doubled, up to the selected interval.
+    ///
+    /// @param measurement The measurement of the current record.
+    ///
+    void adaptInterval(const DHT22::Measurement &measurement);
+    
+    /// Check if the latest samples in the burst buffer trigger a burst.
+    ///
+    bool isBurstTriggered() const;
+    
+    /// The log task in burst mode.
+    ///
+    /// The sensor is sampled into the burst buffer. If a burst is
+    /// triggered, the samples before and after the trigger are written
+    /// at once. Otherwise, only the samples at the regular interval
+    /// are written.
+    ///
+    /// @param logRecord The record of the current sample.
+    ///
+    void burstTask(const LogRecord &logRecord);
+    
+    /// The log task in burst mode, for a failed sample.
+    ///
+    /// The failed sample is not added to the burst buffer. The error is
+    /// only written in place of a regular record, outside of a burst.
+    ///
+    /// @param logError The error of the current sample.
+    ///
+    void burstErrorTask(const LogError &logError);
+    
+#ifdef LR_LIVE_STREAM
+    /// Send a record to the live stream.
+    ///
+    /// The record is only sent if it fits into the transmit buffer of
+    /// the serial, so sending never waits for the UART. Otherwise it is
+    /// dropped and counted. The number of dropped records is sent in front
+    /// of the next record, as a line `Dropped <n>`.
+    ///
+    void streamRecord(const LogRecord &logRecord);
+    
+    /// Wait in idle mode, until the live stream is sent.
+    ///
+    /// The UART stops in power-save mode. The wait is bounded by the size
+    /// of the transmit buffer and the baud rate, it does not depend on
+    /// the receiver.
+    ///
+    void finishStream();
+#endif
+    
+#ifdef LR_PHASE_TRACE_OUTPUT
+    /// Send the phase trace, once half of the ring was not sent yet.
+    ///
+    /// Waits in idle mode for free space and until all lines are sent.
+    ///
+    void writePhaseTrace();
+#endif
+    
+#if defined(LR_LIVE_STREAM) || defined(LR_PHASE_TRACE_OUTPUT)
+    /// Wait in idle mode, until the transmit buffer of the serial has free space.
+    ///
+    /// @param space The number of free bytes to wait for. For the whole buffer,
+    ///    it also waits until the UART sent the last byte.
+    ///
+    void waitForSerial(uint8_t space);
+#endif
+    
+    /// Sleep until the given time.
+    ///
+    /// The idle wakes are used to erase the storage ahead of the log.
+    ///
+    /// @param deadline The time to wake up, as unix time.
+    ///
+    void sleepUntil(uint32_t deadline);
+    
     /// Enter power-safe mode.
     ///
     /// @param seconds Stay in power save mode for approx this number of seconds.
@@ -92,9 +323,23 @@ private:
     ModeSelector modeSelector;
     Storage storage;
     LogSystem logSystem;
+    BurstBuffer burstBuffer;
+    Scheduler scheduler;
+#ifdef LR_PHASE_TRACE
+    PhaseTrace phaseTrace;
+#endif
     
-    int32_t _sleepDelay;
+    uint8_t _logTask;
+    uint32_t _interval;
+    int16_t _lastTemperature;
+    int16_t _lastHumidity;
+    uint8_t _burstSamplesRemaining;
     DateTime _currentTime;
     DateTime _nextRecordTime;
+#ifdef LR_LIVE_STREAM
+    uint32_t _streamDropCount;
+    uint32_t _streamReportedDropCount;
+    bool _isStreamPending;
+#endif
 };
 
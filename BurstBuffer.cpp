@@ -0,0 +1,96 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "BurstBuffer.h"
+
+
+static_assert(BurstBuffer::Capacity >= 2, "The burst buffer needs space for at least two records.");
+
+
+BurstBuffer::BurstBuffer()
+    : _start(0), _count(0), _pendingCount(0)
+{
+}
+
+
+BurstBuffer::~BurstBuffer()
+{
+}
+
+
+void BurstBuffer::add(const LogRecord &logRecord)
+{
+    uint8_t index = _start + _count;
+    if (index >= Capacity) {
+        index -= Capacity;
+    }
+    _records[index] = logRecord;
+    if (_count < Capacity) {
+        ++_count;
+    } else if (++_start >= Capacity) {
+        _start = 0;
+    }
+    if (_pendingCount < Capacity) {
+        ++_pendingCount;
+    }
+}
+
+
+void BurstBuffer::markWritten()
+{
+    _pendingCount = 0;
+}
+
+
+const LogRecord& BurstBuffer::getRecord(uint8_t age) const
+{
+    uint16_t index = _start + _count - 1 - age;
+    if (index >= Capacity) {
+        index -= Capacity;
+    }
+    return _records[index];
+}
+
+
+const LogRecord* BurstBuffer::getPendingRecords()
+{
+    if (_start > 0) {
+        // Rotate the records by reversing both parts and then all records.
+        // This needs no additional RAM.
+        reverse(0, _start);
+        reverse(_start, Capacity);
+        reverse(0, Capacity);
+        _start = 0;
+    }
+    return _records + (_count - _pendingCount);
+}
+
+
+void BurstBuffer::reverse(uint8_t first, uint8_t last)
+{
+    while (first + 1 < last) {
+        --last;
+        const LogRecord record = _records[first];
+        _records[first] = _records[last];
+        _records[last] = record;
+        ++first;
+    }
+}
+
+
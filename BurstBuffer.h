@@ -0,0 +1,98 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "LogSystem.h"
+
+
+/// The RAM in bytes used for the records of the burst buffer.
+///
+/// The number of records in the buffer is derived from this budget.
+///
+#define LR_BURST_BUFFER_BYTES 320
+
+
+/// A ring buffer for the records sampled in burst mode.
+///
+/// The buffer keeps the latest records. If it is full, adding a record
+/// overwrites the oldest one. Records which are written to the log stay
+/// in the buffer for the trigger, but are no longer pending.
+///
+class BurstBuffer
+{
+public:
+    /// The number of records which fit into the buffer.
+    ///
+    static const uint8_t Capacity = LR_BURST_BUFFER_BYTES / sizeof(LogRecord);
+    
+public:
+    /// ctor
+    ///
+    BurstBuffer();
+    
+    /// dtor
+    ///
+    ~BurstBuffer();
+    
+public:
+    /// Add a record to the buffer.
+    ///
+    void add(const LogRecord &logRecord);
+    
+    /// Mark all records in the buffer as written.
+    ///
+    void markWritten();
+    
+    /// Get the number of records in the buffer.
+    ///
+    inline uint8_t count() const { return _count; }
+    
+    /// Get the number of records which are not written yet.
+    ///
+    inline uint8_t pendingCount() const { return _pendingCount; }
+    
+    /// Get a record from the buffer.
+    ///
+    /// @param age The age of the record, 0 is the latest record.
+    ///
+    const LogRecord& getRecord(uint8_t age) const;
+    
+    /// Get the records which are not written yet, ordered by time.
+    ///
+    /// This rearranges the records in place.
+    ///
+    /// @return A pointer to `pendingCount()` records.
+    ///
+    const LogRecord* getPendingRecords();
+    
+private:
+    /// Reverse the records in the given range of the buffer.
+    ///
+    void reverse(uint8_t first, uint8_t last);
+    
+private:
+    LogRecord _records[Capacity]; ///< The records.
+    uint8_t _start; ///< The index of the oldest record.
+    uint8_t _count; ///< The number of records.
+    uint8_t _pendingCount; ///< The number of latest records which are not written yet.
+};
+
+
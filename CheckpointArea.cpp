@@ -0,0 +1,185 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "CheckpointArea.h"
+
+
+#include "InternalLogRecord.h"
+#include "Storage.h"
+
+
+// Anonymous namespace to avoid conflicts.
+namespace {
+
+
+// The number of bytes read at once to check a checkpoint.
+const uint8_t READ_CHUNK_SIZE = 16;
+
+// The value of an erased checkpoint number.
+const uint32_t ERASED_NUMBER = 0xffffffffUL;
+
+
+}
+
+
+CheckpointArea::CheckpointArea(Storage *storage)
+    : _storage(storage), _offset(0), _dataSize(0), _sector(0), _nextPosition(0), _nextNumber(0), _latest(NoCheckpoint)
+{
+}
+
+
+CheckpointArea::~CheckpointArea()
+{
+}
+
+
+void CheckpointArea::begin(uint32_t offset, uint8_t dataSize)
+{
+    _offset = offset;
+    _dataSize = (dataSize <= MaximumDataSize ? dataSize : 0);
+    _sector = 0;
+    _nextPosition = 0;
+    _nextNumber = 0;
+    _latest = NoCheckpoint;
+    if (!isEnabled()) {
+        return;
+    }
+    const uint32_t sectorSize = _storage->eraseSize();
+    const uint8_t entrySize = getEntrySize();
+    const uint32_t entryCount = sectorSize / entrySize;
+    for (uint8_t sector = 0; sector < SectorCount; ++sector) {
+        // The checkpoints are appended to the sector, the written ones are
+        // followed by erased ones.
+        const uint32_t sectorStart = sectorSize * sector;
+        uint32_t low = 0;
+        uint32_t high = entryCount;
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+            if (isWritten(sectorStart + entrySize * middle)) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        // Only the last checkpoint of a sector can be incomplete.
+        for (uint32_t index = low; index > 0 && index + 2 > low; --index) {
+            const uint32_t position = sectorStart + entrySize * (index - 1);
+            uint32_t number;
+            if (readNumber(position, number)) {
+                if (_latest == NoCheckpoint || number >= _nextNumber) {
+                    _latest = position;
+                    _nextNumber = number + 1;
+                    _sector = sector;
+                    _nextPosition = entrySize * low;
+                }
+                break;
+            }
+        }
+    }
+}
+
+
+bool CheckpointArea::read(uint8_t *data) const
+{
+    if (!isEnabled() || _latest == NoCheckpoint) {
+        return false;
+    }
+    _storage->readBytes(_offset + _latest + sizeof(InternalCheckpointHeader), data, _dataSize);
+    return true;
+}
+
+
+void CheckpointArea::write(const uint8_t *data)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    const uint32_t sectorSize = _storage->eraseSize();
+    const uint8_t entrySize = getEntrySize();
+    if (_nextPosition + entrySize > sectorSize || !isErased(sectorSize * _sector + _nextPosition)) {
+        // The latest checkpoint is in the current sector, so the other one can be erased.
+        _sector = (_sector + 1) % SectorCount;
+        _nextPosition = 0;
+        _storage->eraseSector(_offset + sectorSize * _sector);
+    }
+    const uint32_t position = sectorSize * _sector + _nextPosition;
+    InternalCheckpointHeader header;
+    header.number = _nextNumber;
+    uint16_t crc = getCRC(&header, sizeof(InternalCheckpointHeader));
+    crc = getCRC(data, _dataSize, crc);
+    _storage->writeBytes(_offset + position, reinterpret_cast<const uint8_t*>(&header), sizeof(InternalCheckpointHeader));
+    _storage->writeBytes(_offset + position + sizeof(InternalCheckpointHeader), data, _dataSize);
+    _storage->writeBytes(_offset + position + sizeof(InternalCheckpointHeader) + _dataSize, reinterpret_cast<const uint8_t*>(&crc), sizeof(uint16_t));
+    _latest = position;
+    _nextPosition += entrySize;
+    ++_nextNumber;
+}
+
+
+uint8_t CheckpointArea::getEntrySize() const
+{
+    return static_cast<uint8_t>(sizeof(InternalCheckpointHeader) + _dataSize + sizeof(uint16_t));
+}
+
+
+bool CheckpointArea::isWritten(uint32_t position) const
+{
+    InternalCheckpointHeader header;
+    _storage->readBytes(_offset + position, reinterpret_cast<uint8_t*>(&header), sizeof(InternalCheckpointHeader));
+    return header.number != ERASED_NUMBER;
+}
+
+
+bool CheckpointArea::isErased(uint32_t position) const
+{
+    uint8_t buffer[READ_CHUNK_SIZE];
+    const uint8_t entrySize = getEntrySize();
+    for (uint8_t start = 0; start < entrySize; start += READ_CHUNK_SIZE) {
+        const uint8_t count = (entrySize - start < READ_CHUNK_SIZE ? entrySize - start : READ_CHUNK_SIZE);
+        _storage->readBytes(_offset + position + start, buffer, count);
+        for (uint8_t i = 0; i < count; ++i) {
+            if (buffer[i] != 0xff) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+bool CheckpointArea::readNumber(uint32_t position, uint32_t &number) const
+{
+    // The CRC covers the header and the data, which are read in chunks.
+    uint8_t buffer[READ_CHUNK_SIZE];
+    const uint8_t size = static_cast<uint8_t>(sizeof(InternalCheckpointHeader) + _dataSize);
+    uint16_t crc = 0xFFFF;
+    for (uint8_t start = 0; start < size; start += READ_CHUNK_SIZE) {
+        const uint8_t count = (size - start < READ_CHUNK_SIZE ? size - start : READ_CHUNK_SIZE);
+        _storage->readBytes(_offset + position + start, buffer, count);
+        if (start == 0) {
+            memcpy(&number, buffer, sizeof(uint32_t));
+        }
+        crc = getCRC(buffer, count, crc);
+    }
+    uint16_t storedCRC;
+    _storage->readBytes(_offset + position + size, reinterpret_cast<uint8_t*>(&storedCRC), sizeof(uint16_t));
+    return crc == storedCRC;
+}
+
+
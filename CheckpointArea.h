@@ -0,0 +1,127 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include <Arduino.h>
+
+
+class Storage;
+
+
+/// An append-only area for checkpoints on a storage which has to be erased.
+///
+/// A flash chip can not overwrite a checkpoint in place, like the slots in
+/// the configuration area. The area uses two erase sectors instead. Each
+/// checkpoint is appended behind the latest one, with the next number and
+/// a CRC. If the sector is full, the other sector is erased and the
+/// checkpoints continue there. An interrupted write leaves an invalid
+/// checkpoint, and the previous checkpoint is kept.
+///
+/// `begin()` finds the end of the checkpoints in each sector with a binary
+/// search, so only a few checkpoints are read.
+///
+class CheckpointArea
+{
+public:
+    /// The number of erase sectors of an area.
+    ///
+    static const uint8_t SectorCount = 2;
+    
+    /// The largest size of the data of a checkpoint.
+    ///
+    static const uint8_t MaximumDataSize = 96;
+    
+public:
+    /// Create a disabled area.
+    ///
+    /// @param storage The storage to use.
+    ///
+    CheckpointArea(Storage *storage);
+    
+    /// dtor
+    ///
+    ~CheckpointArea();
+    
+public:
+    /// Find the latest checkpoint in the storage.
+    ///
+    /// @param offset The offset of the first sector of the area, at the start of an erase sector.
+    /// @param dataSize The size of the data of a checkpoint, or 0 to disable the area.
+    ///
+    void begin(uint32_t offset, uint8_t dataSize);
+    
+    /// Check if the area is used.
+    ///
+    inline bool isEnabled() const { return _dataSize > 0; }
+    
+    /// Read the latest checkpoint.
+    ///
+    /// @param data The buffer for the data of the checkpoint.
+    /// @return true if there is a valid checkpoint.
+    ///
+    bool read(uint8_t *data) const;
+    
+    /// Append a checkpoint.
+    ///
+    /// Nothing is written if the area is disabled.
+    ///
+    /// @param data The data of the checkpoint.
+    ///
+    void write(const uint8_t *data);
+    
+private:
+    /// Get the size of a checkpoint with its header and CRC.
+    ///
+    uint8_t getEntrySize() const;
+    
+    /// Check if a checkpoint was written at a position of the area.
+    ///
+    bool isWritten(uint32_t position) const;
+    
+    /// Check if all bytes of a checkpoint at a position of the area are erased.
+    ///
+    bool isErased(uint32_t position) const;
+    
+    /// Read and check a checkpoint at a position of the area.
+    ///
+    /// @param position The position in the area.
+    /// @param number The number of the checkpoint.
+    /// @return true if the checkpoint is valid.
+    ///
+    bool readNumber(uint32_t position, uint32_t &number) const;
+    
+private:
+    /// The marker for an area without a valid checkpoint.
+    ///
+    static const uint32_t NoCheckpoint = 0xffffffffUL;
+    
+private:
+    Storage *_storage;
+    uint32_t _offset; ///< The offset of the area in the storage.
+    uint8_t _dataSize; ///< The size of the data of a checkpoint, or 0 if the area is disabled.
+    uint8_t _sector; ///< The sector for the next checkpoint.
+    uint32_t _nextPosition; ///< The position for the next checkpoint in its sector.
+    uint32_t _nextNumber; ///< The number for the next checkpoint.
+    uint32_t _latest; ///< The position of the latest checkpoint in the area, or `NoCheckpoint`.
+};
+
+
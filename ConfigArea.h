@@ -0,0 +1,133 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <stdint.h>
+
+
+// The layout of the configuration area at the start of the storage.
+//
+// The log area starts behind the configuration area. The layout is shared
+// with the host tools, which read storage images.
+
+
+// Uncomment to keep the phase trace in the configuration area, see `PhaseTrace.h`.
+// This moves the log area behind the trace. Format the storage after changing
+// this setting, and build the host tools with the same setting.
+//#define LR_PHASE_TRACE_PERSIST
+
+
+/// The size of the configuration area in bytes, on a large storage.
+///
+/// A small storage uses a smaller area, see `getConfigAreaSize()`.
+///
+#ifdef LR_PHASE_TRACE_PERSIST
+const uint32_t CONFIG_AREA_SIZE = 768;
+#else
+const uint32_t CONFIG_AREA_SIZE = 512;
+#endif
+
+/// The offset of the statistics checkpoints of the log system.
+///
+const uint32_t CONFIG_STATISTICS_OFFSET = 0;
+
+/// The number of bytes for the statistics checkpoints of the log system.
+///
+const uint32_t CONFIG_STATISTICS_SIZE = 160;
+
+
+/// The offset of the session index of the log system.
+///
+const uint32_t CONFIG_SESSION_INDEX_OFFSET = 160;
+
+/// The number of bytes for the session index of the log system.
+///
+const uint32_t CONFIG_SESSION_INDEX_SIZE = 96;
+
+
+/// The offset of the config store, see `ConfigStore.h`.
+///
+const uint32_t CONFIG_STORE_OFFSET = 256;
+
+/// The number of bytes for the config store.
+///
+const uint32_t CONFIG_STORE_SIZE = 256;
+
+/// The keys of the values in the config store.
+///
+const uint8_t CONFIG_KEY_RECORD_END = 0; ///< The number of records since the format, as a hint for the end of the log.
+const uint8_t CONFIG_KEY_HOURLY_ROLLUP_END = 1; ///< The number of hourly rollups since the format.
+const uint8_t CONFIG_KEY_DAILY_ROLLUP_END = 2; ///< The number of daily rollups since the format.
+
+
+#ifdef LR_PHASE_TRACE_PERSIST
+/// The offset of the persisted phase trace.
+///
+const uint32_t CONFIG_PHASE_TRACE_OFFSET = 512;
+
+/// The number of bytes for the persisted phase trace.
+///
+const uint32_t CONFIG_PHASE_TRACE_SIZE = 256;
+#endif
+
+
+static_assert(CONFIG_STATISTICS_OFFSET + CONFIG_STATISTICS_SIZE <= CONFIG_SESSION_INDEX_OFFSET, "The statistics overlap the session index.");
+static_assert(CONFIG_SESSION_INDEX_OFFSET + CONFIG_SESSION_INDEX_SIZE <= CONFIG_STORE_OFFSET, "The session index overlaps the config store.");
+static_assert(CONFIG_STORE_OFFSET + CONFIG_STORE_SIZE <= CONFIG_AREA_SIZE, "The config store exceeds the configuration area.");
+#ifdef LR_PHASE_TRACE_PERSIST
+static_assert(CONFIG_STORE_OFFSET + CONFIG_STORE_SIZE <= CONFIG_PHASE_TRACE_OFFSET, "The config store overlaps the phase trace.");
+static_assert(CONFIG_PHASE_TRACE_OFFSET + CONFIG_PHASE_TRACE_SIZE <= CONFIG_AREA_SIZE, "The phase trace exceeds the configuration area.");
+#endif
+
+
+/// The size of the largest storage, which uses the small configuration area.
+///
+/// This includes the EEPROM of the processor. On a small storage, the whole
+/// log is read in a few milliseconds, but an update of the config store for
+/// each record would double the time to write it. So there is no config
+/// store, and its 256 bytes are kept for the log. On the 1KB EEPROM of the
+/// ATmega328P, the ring has room for 35 instead of 24 records.
+///
+const uint32_t CONFIG_SMALL_STORAGE_SIZE = 4096;
+
+/// The size of the configuration area on a small storage.
+///
+/// The persisted phase trace keeps its offset, so the area is not reduced
+/// with `LR_PHASE_TRACE_PERSIST`.
+///
+#ifdef LR_PHASE_TRACE_PERSIST
+const uint32_t CONFIG_SMALL_AREA_SIZE = CONFIG_AREA_SIZE;
+#else
+const uint32_t CONFIG_SMALL_AREA_SIZE = CONFIG_STORE_OFFSET;
+#endif
+
+
+/// Get the size of the configuration area for a storage.
+///
+/// @param storageSize The size of the storage in bytes.
+/// @return The number of bytes of the configuration area at the start of the storage.
+///
+inline uint32_t getConfigAreaSize(uint32_t storageSize)
+{
+    return storageSize <= CONFIG_SMALL_STORAGE_SIZE ? CONFIG_SMALL_AREA_SIZE : CONFIG_AREA_SIZE;
+}
+
+
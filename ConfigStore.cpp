@@ -0,0 +1,145 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "ConfigStore.h"
+
+
+#include "InternalLogRecord.h"
+#include "Storage.h"
+
+
+// Anonymous namespace to avoid conflicts.
+namespace {
+
+
+// The largest number of slots, which keeps the slot numbers apart from `NoSlot`.
+const uint8_t MAXIMUM_SLOT_COUNT = 0xfe;
+
+
+// Read an entry and check it.
+//
+// @return true if the entry is valid.
+//
+bool readEntry(Storage *storage, uint32_t start, InternalConfigEntry &entry)
+{
+    storage->readBytes(start, reinterpret_cast<uint8_t*>(&entry), sizeof(InternalConfigEntry));
+    return entry.key < ConfigStore::KeyCount && entry.crc == getCRC(&entry, offsetof(InternalConfigEntry, crc));
+}
+
+
+}
+
+
+ConfigStore::ConfigStore(Storage *storage)
+    : _storage(storage), _offset(0), _slotCount(0), _nextSlot(0), _nextNumber(0)
+{
+    for (uint8_t key = 0; key < KeyCount; ++key) {
+        _value[key] = 0;
+        _slot[key] = NoSlot;
+    }
+}
+
+
+ConfigStore::~ConfigStore()
+{
+}
+
+
+void ConfigStore::begin(uint32_t offset, uint32_t size)
+{
+    _offset = offset;
+    const uint32_t slotCount = size / sizeof(InternalConfigEntry);
+    _slotCount = (slotCount > KeyCount ? static_cast<uint8_t>(slotCount < MAXIMUM_SLOT_COUNT ? slotCount : MAXIMUM_SLOT_COUNT) : 0);
+    _nextSlot = 0;
+    _nextNumber = 0;
+    uint32_t number[KeyCount];
+    for (uint8_t key = 0; key < KeyCount; ++key) {
+        _value[key] = 0;
+        _slot[key] = NoSlot;
+        number[key] = 0;
+    }
+    // The entry with the highest number of each key is the current one. The
+    // next entry is written behind the entry with the highest number.
+    for (uint8_t slot = 0; slot < _slotCount; ++slot) {
+        InternalConfigEntry entry;
+        if (!readEntry(_storage, _offset + sizeof(InternalConfigEntry) * slot, entry)) {
+            continue;
+        }
+        if (_slot[entry.key] == NoSlot || entry.number > number[entry.key]) {
+            _value[entry.key] = entry.value;
+            _slot[entry.key] = slot;
+            number[entry.key] = entry.number;
+        }
+        if (entry.number >= _nextNumber) {
+            _nextNumber = entry.number + 1;
+            _nextSlot = (slot + 1) % _slotCount;
+        }
+    }
+}
+
+
+bool ConfigStore::hasValue(uint8_t key) const
+{
+    return key < KeyCount && _slot[key] != NoSlot;
+}
+
+
+uint32_t ConfigStore::getValue(uint8_t key, uint32_t defaultValue) const
+{
+    if (!hasValue(key)) {
+        return defaultValue;
+    }
+    return _value[key];
+}
+
+
+void ConfigStore::setValue(uint8_t key, uint32_t value)
+{
+    if (!isEnabled() || key >= KeyCount || (_slot[key] != NoSlot && _value[key] == value)) {
+        return;
+    }
+    // There are more slots than keys, so there is always a free slot.
+    uint8_t slot = _nextSlot;
+    while (isCurrentSlot(slot)) {
+        slot = (slot + 1) % _slotCount;
+    }
+    InternalConfigEntry entry;
+    entry.number = _nextNumber;
+    entry.value = value;
+    entry.key = key;
+    entry.crc = getCRC(&entry, offsetof(InternalConfigEntry, crc));
+    _storage->writeBytes(_offset + sizeof(InternalConfigEntry) * slot, reinterpret_cast<const uint8_t*>(&entry), sizeof(InternalConfigEntry));
+    _value[key] = value;
+    _slot[key] = slot;
+    _nextSlot = (slot + 1) % _slotCount;
+    ++_nextNumber;
+}
+
+
+bool ConfigStore::isCurrentSlot(uint8_t slot) const
+{
+    for (uint8_t key = 0; key < KeyCount; ++key) {
+        if (_slot[key] == slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
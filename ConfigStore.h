@@ -0,0 +1,119 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <Arduino.h>
+
+
+class Storage;
+
+
+/// A small key/value store in the configuration area.
+///
+/// The store keeps a few 32 bit values, which can be written often, like
+/// the end of the log after each record. Each write appends an entry with
+/// the key, the value and a CRC to a ring of slots, so the writes are
+/// spread over all slots of the store.
+///
+/// A slot with the current entry of a key is never overwritten. A write
+/// goes to the next slot without a current entry. Therefore an interrupted
+/// write can only destroy an outdated entry, and the previous value of the
+/// key is kept.
+///
+/// `begin()` reads all slots once and keeps the current value and slot of
+/// each key in RAM, so reading a value does not access the storage.
+///
+/// The store needs more slots than keys. It has to be placed in a part of
+/// the storage which can be overwritten, so it is not used on a flash chip.
+///
+class ConfigStore
+{
+public:
+    /// The number of keys.
+    ///
+    static const uint8_t KeyCount = 4;
+    
+public:
+    /// Create a disabled store.
+    ///
+    /// @param storage The storage to use.
+    ///
+    ConfigStore(Storage *storage);
+    
+    /// dtor
+    ///
+    ~ConfigStore();
+    
+public:
+    /// Read the current values from the storage.
+    ///
+    /// @param offset The offset of the store in the storage.
+    /// @param size The size of the store in bytes, or 0 to disable the store.
+    ///
+    void begin(uint32_t offset, uint32_t size);
+    
+    /// Check if the store is used.
+    ///
+    inline bool isEnabled() const { return _slotCount > 0; }
+    
+    /// Check if a key has a value.
+    ///
+    bool hasValue(uint8_t key) const;
+    
+    /// Get the value of a key.
+    ///
+    /// @param key The key.
+    /// @param defaultValue The value to return if the key has no value.
+    ///
+    uint32_t getValue(uint8_t key, uint32_t defaultValue = 0) const;
+    
+    /// Set the value of a key.
+    ///
+    /// The value is only written if it changed. Nothing is written if
+    /// the store is disabled.
+    ///
+    void setValue(uint8_t key, uint32_t value);
+    
+    /// Get the number of slots.
+    ///
+    inline uint8_t getSlotCount() const { return _slotCount; }
+    
+private:
+    /// Check if a slot holds the current entry of a key.
+    ///
+    bool isCurrentSlot(uint8_t slot) const;
+    
+private:
+    /// The marker for a key without value.
+    ///
+    static const uint8_t NoSlot = 0xff;
+    
+private:
+    Storage *_storage;
+    uint32_t _offset; ///< The offset of the store in the storage.
+    uint8_t _slotCount; ///< The number of slots, or 0 if the store is disabled.
+    uint8_t _nextSlot; ///< The slot to try for the next write.
+    uint32_t _nextNumber; ///< The number for the next entry.
+    uint32_t _value[KeyCount]; ///< The current value of each key.
+    uint8_t _slot[KeyCount]; ///< The slot with the current entry of each key, or `NoSlot`.
+};
+
+
@@ -63,7 +63,7 @@ DHT22::PulseResult DHT22::getPulse()
 
 DHT22::Measurement DHT22::readTemperatureAndHumidity()
 {
-    Measurement measurement = {NAN, NAN};
+    Measurement measurement = {InvalidValue, InvalidValue, StatusTimeout};
     
     // 5 bytes of read data.
     uint8_t readData[5];
@@ -133,20 +133,21 @@ DHT22::Measurement DHT22::readTemperatureAndHumidity()
 #ifdef LR_DHT22_DEBUG
         Serial.println(F("Checksum does not match."));
 #endif
+        measurement.status = StatusChecksumError;
         goto END_READ;
     }
     
     // Convert the read bits into temperature and humidity
-    measurement.temperature = (static_cast<uint16_t>(readData[2]&0x7f) << 8) + readData[3];
-    measurement.temperature /= 10.0f;
+    // The values are sent as 1/10 units with the sign in the highest bit.
+    measurement.temperature = (static_cast<int16_t>(readData[2]&0x7f) << 8) + readData[3];
     if ((readData[2] & 0x80) != 0) {
-        measurement.temperature *= -1.0f;
+        measurement.temperature = -measurement.temperature;
     }
-    measurement.humidity = (static_cast<uint16_t>(readData[0]&0x7f) << 8) + readData[1];
-    measurement.humidity /= 10.0f;
+    measurement.humidity = (static_cast<int16_t>(readData[0]&0x7f) << 8) + readData[1];
     if ((readData[0] & 0x80) != 0) {
-        measurement.humidity *= -1.0f;
+        measurement.humidity = -measurement.humidity;
     }
+    measurement.status = StatusOk;
     
 END_READ:
     // End time critical code
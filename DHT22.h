@@ -41,11 +41,31 @@ class DHT22
     };
 
 public:
+    /// The value used in a measurement if the sensor could not be read.
+    ///
+    static const int16_t InvalidValue = -32768;
+    
+    /// The result of reading the sensor.
+    ///
+    enum Status : uint8_t {
+        StatusOk, ///< The values were read.
+        StatusTimeout, ///< The sensor did not answer, or stopped sending.
+        StatusChecksumError ///< The data did not match the checksum.
+    };
+    
     /// One single measurement from the sensor.
     ///
+    /// The sensor delivers its values as fixed point numbers with
+    /// one decimal place. These values are kept as they are.
+    ///
     struct Measurement {
-        float temperature;
-        float humidity;
+        int16_t temperature; ///< The temperature in 1/10 celsius.
+        int16_t humidity; ///< The relative humidity in 1/10 percent.
+        Status status; ///< The result of the read.
+        
+        /// Check if this measurement contains valid values.
+        ///
+        inline bool isValid() const { return temperature != InvalidValue && humidity != InvalidValue; }
     };
     
 public:
@@ -64,7 +84,10 @@ public:
     
     /// Read the temperature and humidity
     ///
-    /// The temperature is read in celsius.
+    /// The temperature is read in 1/10 celsius, the humidity in 1/10 percent.
+    /// If the sensor could not be read, both values are set to `InvalidValue`
+    /// and the status tells the reason. The sensor needs two seconds between
+    /// two reads.
     ///
     Measurement readTemperatureAndHumidity();
     
@@ -24,6 +24,10 @@
 #include <RTClib.h>
 #include <RTC_DS1307.h>
 #include <SPI.h>
+#include "Storage.h"
+#ifdef LR_STORAGE_BLOCK
+#include <SD.h> // Only the raw block access of the SD card is used.
+#endif
 
 #include "Application.h"
 
@@ -0,0 +1,65 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "I2CBus.h"
+
+
+#include <Wire.h>
+
+
+// Anonymous namespace to avoid conflicts.
+namespace {
+
+
+// The highest clock of the TWI hardware, with a bit rate register of zero.
+const uint32_t MAXIMUM_CLOCK = F_CPU / 16;
+
+
+}
+
+
+I2CBus::Device I2CBus::_selectedDevice = I2CBus::RealTimeClock;
+
+
+void I2CBus::begin()
+{
+    Wire.begin();
+    Wire.setClock(getClock(RealTimeClock));
+    _selectedDevice = RealTimeClock;
+}
+
+
+void I2CBus::select(Device device)
+{
+    if (device != _selectedDevice) {
+        Wire.setClock(getClock(device));
+        _selectedDevice = device;
+    }
+}
+
+
+uint32_t I2CBus::getClock(Device device)
+{
+    if (device == Fram) {
+        return LR_I2C_FAST_CLOCK < MAXIMUM_CLOCK ? LR_I2C_FAST_CLOCK : MAXIMUM_CLOCK;
+    }
+    return LR_I2C_STANDARD_CLOCK;
+}
+
+
@@ -0,0 +1,76 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <Arduino.h>
+
+
+/// The I2C clock for the DS1307 real time clock, which supports 100kHz only.
+///
+#define LR_I2C_STANDARD_CLOCK 100000UL
+
+/// The I2C clock for the MB85RC FRAM chips, which support 1MHz.
+///
+/// The TWI hardware can not run faster than a sixteenth of the processor
+/// clock, the clock is limited to this.
+///
+#define LR_I2C_FAST_CLOCK 1000000UL
+
+
+/// The shared I2C bus.
+///
+/// The devices on the bus support different clock rates. Before a device
+/// is accessed, it is selected, which switches the clock of the bus to the
+/// rate of the device. The clock is only changed if another device was
+/// selected before, which takes a single register write.
+///
+/// The RTC library does not know about the bus, so `Application` selects
+/// the clock before each access to the RTC. The FRAM storage selects
+/// itself before each transfer.
+///
+class I2CBus
+{
+public:
+    /// The devices on the bus.
+    ///
+    enum Device : uint8_t {
+        RealTimeClock = 0, ///< The DS1307 real time clock.
+        Fram = 1 ///< The MB85RC FRAM chips of the storage.
+    };
+    
+public:
+    /// Initialize the bus, with the real time clock selected.
+    ///
+    static void begin();
+    
+    /// Select the device for the next transfers.
+    ///
+    static void select(Device device);
+    
+    /// Get the clock rate for a device in Hz.
+    ///
+    static uint32_t getClock(Device device);
+    
+private:
+    static Device _selectedDevice; ///< The device the clock is set for.
+};
+
+
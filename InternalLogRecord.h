@@ -0,0 +1,392 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "RecordSchema.h"
+
+#include <Arduino.h>
+#include <util/crc16.h>
+#include <stddef.h>
+
+
+// The storage format of the log system.
+//
+// The format is shared with the host tools, which read storage images.
+
+
+/// The data of a session record, in place of the values.
+///
+struct InternalSessionData
+{
+    uint16_t bootCount; ///< The number of times the logger started logging.
+    uint16_t interval; ///< The interval of the session in `LOG_SESSION_INTERVAL_UNIT` seconds.
+} __attribute__((packed));
+
+
+/// The data of a session link record, in place of the values.
+///
+/// The link record follows each session record. It chains the sessions,
+/// which finds sessions older than the ones in the session index.
+///
+struct InternalSessionLinkData
+{
+    uint16_t session; ///< The number of the session since the format.
+    uint16_t previousDistance; ///< The number of records back to the previous session record, or 0 if there is none in reach.
+} __attribute__((packed));
+
+
+/// The data of an error record, in place of the values.
+///
+struct InternalErrorData
+{
+    uint8_t code; ///< The error code, see `LogError::Code`.
+    uint8_t attempts; ///< The number of failed attempts.
+} __attribute__((packed));
+
+
+/// The internal representation of a log record.
+///
+/// Each record carries a sequence number. The first record after a format
+/// uses the sequence base from the log header, every following record the
+/// next number. Records with an unexpected sequence number are left over
+/// from before the last format, or from the previous lap of the ring.
+///
+/// The upper four bits of the sequence field are the type of the record.
+/// A session record stores `InternalSessionData` in place of the values,
+/// the session link record behind it `InternalSessionLinkData` and an
+/// error record `InternalErrorData`.
+///
+/// @tparam tSchema The schema with the channels of the record.
+///
+template<typename tSchema>
+struct InternalRecordLayout
+{
+    uint32_t unixtime; ///< The time as unix timestamp.
+    uint32_t sequence; ///< The sequence number of this record.
+    union __attribute__((packed)) {
+        int16_t values[tSchema::ChannelCount]; ///< The values in the fixed point units of the channels.
+        InternalSessionData session; ///< The data of a session record.
+        InternalSessionLinkData sessionLink; ///< The data of a session link record.
+        InternalErrorData error; ///< The data of an error record.
+    };
+    uint16_t crc; ///< The CRC-16 of the record.
+} __attribute__((packed));
+
+
+/// The internal representation of the log records.
+///
+typedef InternalRecordLayout<LogRecordSchema> InternalLogRecord;
+
+static_assert(sizeof(InternalLogRecord) == 10 + 2 * (LogRecordSchema::ChannelCount < 2 ? 2 : LogRecordSchema::ChannelCount),
+    "Unexpected size of the internal log record.");
+
+
+/// The minimum, mean and maximum of one value in a rollup.
+///
+struct InternalRollupValues
+{
+    int16_t minimum; ///< The minimum in the fixed point units of the channel.
+    int16_t mean; ///< The rounded mean in the fixed point units of the channel.
+    int16_t maximum; ///< The maximum in the fixed point units of the channel.
+} __attribute__((packed));
+
+
+/// The internal representation of a rollup in a rollup tier.
+///
+/// A rollup summarizes the measurements of one period, like an hour.
+/// The rollups of a tier are written to a ring, each one with the next
+/// number in the sequence of the tier, which starts with the sequence
+/// base of the log header. The upper four bits of the sequence field
+/// are the record type of the tier.
+///
+/// @tparam tSchema The schema with the channels of the record.
+///
+template<typename tSchema>
+struct InternalRollupLayout
+{
+    uint32_t unixtime; ///< The start of the period as unix timestamp.
+    uint32_t sequence; ///< The sequence number of this rollup.
+    uint32_t count; ///< The number of measurements in the period.
+    InternalRollupValues values[tSchema::ChannelCount]; ///< The values for each channel.
+    uint16_t crc; ///< The CRC-16 of the rollup.
+} __attribute__((packed));
+
+
+/// The internal representation of the rollups.
+///
+typedef InternalRollupLayout<LogRecordSchema> InternalLogRollup;
+
+static_assert(sizeof(InternalLogRollup) == 14 + sizeof(InternalRollupValues) * LogRecordSchema::ChannelCount,
+    "Unexpected size of the internal log rollup.");
+
+
+/// The header at the start of the log area.
+///
+/// The header is only written on format. It starts a new sequence
+/// for the records and for the rollups of each tier.
+///
+struct InternalLogHeader
+{
+    uint32_t magic; ///< The magic value to identify the format.
+    uint32_t sequenceBase; ///< The sequence number of the first record.
+    uint16_t crc; ///< The CRC-16 of the header.
+} __attribute__((packed));
+
+static_assert(sizeof(InternalLogHeader) == 10, "Unexpected size of the internal log header.");
+
+
+/// The number of error codes counted in the statistics.
+///
+const uint8_t LOG_ERROR_CODE_COUNT = 2;
+
+
+/// The statistics of a single value in a checkpoint.
+///
+struct InternalValueStatistics
+{
+    int16_t minimum; ///< The minimum in the fixed point units of the channel.
+    uint32_t minimumTime; ///< The time of the minimum as unix timestamp.
+    int16_t maximum; ///< The maximum in the fixed point units of the channel.
+    uint32_t maximumTime; ///< The time of the maximum as unix timestamp.
+    int64_t sum; ///< The sum of all values.
+    uint64_t sumOfSquares; ///< The sum of the squares of all values.
+} __attribute__((packed));
+
+
+/// A checkpoint of the log statistics in the configuration area.
+///
+/// There are two slots for checkpoints, which are written alternately.
+/// The valid checkpoint with more records is used.
+///
+struct InternalLogStatistics
+{
+    uint32_t sequenceBase; ///< The sequence base of the log, which changes on format.
+    uint32_t recordCount; ///< The number of log records since the format included in the statistics.
+    uint32_t count; ///< The number of valid records in the statistics.
+    InternalValueStatistics values[LogRecordSchema::ChannelCount]; ///< The statistics for each channel.
+    uint32_t errorCount[LOG_ERROR_CODE_COUNT]; ///< The number of error records for each error code.
+    uint8_t isComplete; ///< 1 if the statistics include all records since the format.
+    uint16_t crc; ///< The CRC-16 of the checkpoint.
+} __attribute__((packed));
+
+static_assert(sizeof(InternalLogStatistics) == 15 + sizeof(InternalValueStatistics) * LogRecordSchema::ChannelCount + 4 * LOG_ERROR_CODE_COUNT, "Unexpected size of the internal log statistics.");
+
+
+/// The index of the latest sessions in the configuration area.
+///
+/// The start of session `n` is stored at `n % LOG_SESSION_INDEX_SIZE`.
+/// The index is written before the session record. An interrupted
+/// update leaves an invalid CRC, or an entry which does not point to
+/// a linked session record, and the index is rebuilt from the records.
+///
+struct InternalSessionIndex
+{
+    uint32_t sequenceBase; ///< The sequence base of the log, which changes on format.
+    uint16_t bootCount; ///< The number of times the logger started logging, kept on format.
+    uint16_t sessionCount; ///< The number of sessions in the log.
+    uint32_t sessionStart[20]; ///< The number of the session records since the format, for the latest sessions.
+    uint16_t crc; ///< The CRC-16 of the index.
+} __attribute__((packed));
+
+static_assert(sizeof(InternalSessionIndex) == 90, "Unexpected size of the internal session index.");
+
+
+/// An entry of the config store in the configuration area.
+///
+/// Each write of a value appends a new entry with the next number, the
+/// entry of a key with the highest number holds its current value.
+///
+struct InternalConfigEntry
+{
+    uint32_t number; ///< The number of the entry, which increases with each write.
+    uint32_t value; ///< The value.
+    uint8_t key; ///< The key of the value.
+    uint16_t crc; ///< The CRC-16 of the entry.
+} __attribute__((packed));
+
+static_assert(sizeof(InternalConfigEntry) == 11, "Unexpected size of the internal config entry.");
+
+
+/// The header of a checkpoint in a checkpoint area on a flash chip.
+///
+/// The data of the checkpoint follows the header, and a CRC-16 over the
+/// header and the data follows the data. The checkpoint with the highest
+/// number is the latest one.
+///
+struct InternalCheckpointHeader
+{
+    uint32_t number; ///< The number of the checkpoint, which increases with each write.
+} __attribute__((packed));
+
+static_assert(sizeof(InternalCheckpointHeader) == 4, "Unexpected size of the internal checkpoint header.");
+
+
+/// The number of sessions in the session index.
+///
+const uint8_t LOG_SESSION_INDEX_SIZE = sizeof(InternalSessionIndex::sessionStart) / sizeof(uint32_t);
+
+/// The unit of the interval in a session record, in seconds.
+///
+const uint8_t LOG_SESSION_INTERVAL_UNIT = 2;
+
+/// The magic value for the log header, "LRL5".
+///
+const uint32_t LOG_HEADER_MAGIC = 0x354c524cUL;
+
+/// The types of the records, in the upper four bits of the sequence.
+///
+const uint8_t LOG_RECORD_TYPE_MEASUREMENT = 0;
+const uint8_t LOG_RECORD_TYPE_SESSION = 1;
+const uint8_t LOG_RECORD_TYPE_ERROR = 2;
+const uint8_t LOG_RECORD_TYPE_HOURLY = 3;
+const uint8_t LOG_RECORD_TYPE_DAILY = 4;
+const uint8_t LOG_RECORD_TYPE_SESSION_LINK = 5;
+const uint8_t LOG_RECORD_TYPE_SHIFT = 28;
+
+/// The mask for the sequence number in the sequence field.
+///
+const uint32_t LOG_SEQUENCE_MASK = 0x0fffffffUL;
+
+/// The largest number of a record since the format.
+///
+/// Records from before the last format have a sequence number before the
+/// sequence base, which is a very large number relative to it.
+///
+const uint32_t LOG_MAXIMUM_RECORD_NUMBER = LOG_SEQUENCE_MASK >> 1;
+
+/// The number of invalid records in a row, which ends the scan for records.
+///
+/// Single corrupted records are skipped, but a longer run of invalid
+/// records is the end of the log.
+///
+const uint8_t LOG_MAXIMUM_SKIPPED_RECORDS = 16;
+
+
+/// Calculate the CRC-16 for a block of data.
+///
+/// @param data The data to calculate the CRC for.
+/// @param size The number of bytes.
+/// @param crc The CRC of the data in front of this block, to continue it.
+/// @return The CRC-16.
+///
+inline uint16_t getCRC(const void *data, uint8_t size, uint16_t crc = 0xFFFF)
+{
+    const uint8_t *dataPtr = reinterpret_cast<const uint8_t*>(data);
+    for (uint8_t i = 0; i < size; ++i) {
+        crc = _crc16_update(crc, *dataPtr);
+        ++dataPtr;
+    }
+    return crc;
+}
+
+
+/// Calculate the CRC for the record.
+///
+/// The CRC is calculated as CRC-16 over all fields, except the CRC field.
+///
+/// @param record The record to calculate the CRC for.
+/// @return The CRC-16.
+///
+inline uint16_t getCRCForInternalRecord(const InternalLogRecord *record)
+{
+    return getCRC(record, offsetof(InternalLogRecord, crc));
+}
+
+
+/// Get the type of a record.
+///
+inline uint8_t getInternalRecordType(const InternalLogRecord *record)
+{
+    return static_cast<uint8_t>(record->sequence >> LOG_RECORD_TYPE_SHIFT);
+}
+
+
+/// Get the sequence number of a record, without the type.
+///
+inline uint32_t getInternalRecordSequence(const InternalLogRecord *record)
+{
+    return record->sequence & LOG_SEQUENCE_MASK;
+}
+
+
+/// Get the sequence field for a record.
+///
+/// @param type The type of the record.
+/// @param sequence The sequence number, which wraps at the mask.
+///
+inline uint32_t getSequenceField(uint8_t type, uint32_t sequence)
+{
+    return (static_cast<uint32_t>(type) << LOG_RECORD_TYPE_SHIFT) | (sequence & LOG_SEQUENCE_MASK);
+}
+
+
+/// Check if an internal record is valid.
+///
+/// This is true if the record has a known type, all values of a
+/// measurement are in a valid range, an error record has a known
+/// code and the CRC code is valid.
+///
+/// @param record The record to check.
+/// @return true if the record is valid.
+///
+inline bool isInternalRecordValid(const InternalLogRecord *record)
+{
+    const uint8_t type = getInternalRecordType(record);
+    if (type == LOG_RECORD_TYPE_SESSION || type == LOG_RECORD_TYPE_SESSION_LINK) {
+        return getCRCForInternalRecord(record) == record->crc;
+    } else if (type == LOG_RECORD_TYPE_ERROR) {
+        return record->error.code < LOG_ERROR_CODE_COUNT && getCRCForInternalRecord(record) == record->crc;
+    } else if (type != LOG_RECORD_TYPE_MEASUREMENT) {
+        return false; // unknown type.
+    }
+    int16_t values[LogRecordSchema::ChannelCount];
+    memcpy(values, record->values, sizeof(values)); // the values in a packed record can be unaligned.
+    if (!LogRecordSchema::isValid(values)) {
+        return false; // out of range.
+    }
+    const uint16_t crc = getCRCForInternalRecord(record);
+    return crc == record->crc;
+}
+
+
+/// Get the sequence number of a rollup, without the type.
+///
+inline uint32_t getInternalRollupSequence(const InternalLogRollup *rollup)
+{
+    return rollup->sequence & LOG_SEQUENCE_MASK;
+}
+
+
+/// Check if an internal rollup is valid.
+///
+/// This is true if the rollup has the type of its tier and the CRC code is valid.
+///
+/// @param rollup The rollup to check.
+/// @param type The record type of the tier.
+/// @return true if the rollup is valid.
+///
+inline bool isInternalRollupValid(const InternalLogRollup *rollup, uint8_t type)
+{
+    if (static_cast<uint8_t>(rollup->sequence >> LOG_RECORD_TYPE_SHIFT) != type) {
+        return false;
+    }
+    return getCRC(rollup, offsetof(InternalLogRollup, crc)) == rollup->crc;
+}
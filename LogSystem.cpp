@@ -20,14 +20,15 @@
 #include "LogSystem.h"
 
 
+#include "ConfigArea.h"
+#include "InternalLogRecord.h"
 #include "Storage.h"
 
-#include <util/crc16.h>
-
 
 LogRecord::LogRecord()
-    : _dateTime(), _temperature(0.0f), _humidity(0.0f)
-{    
+    : _dateTime()
+{
+    memset(_values, 0, sizeof(_values));
 }
 
 
@@ -36,249 +37,1839 @@ LogRecord::~LogRecord()
 }
 
 
-LogRecord::LogRecord(const DateTime &dateTime, float temperature, float humidity)
-    : _dateTime(dateTime), _temperature(temperature), _humidity(humidity)
+LogRecord::LogRecord(const DateTime &dateTime, const int16_t *values)
+    : _dateTime(dateTime)
 {
-    if (_temperature > 100.0f) {
-        _temperature = 100.0f;
-    }
-    if (_temperature < -273.15f) {
-        _temperature = -273.15f;
-    }
-    if (_humidity > 100.0f) {
-        _humidity = 100.0f;
-    }
-    if (_humidity < 0.0f) {
-        _humidity = 0.0f;
-    }
+    memcpy(_values, values, sizeof(_values));
+    LogRecordSchema::clamp(_values);
+}
+
+
+LogRecord::LogRecord(const DateTime &dateTime, int16_t temperature, int16_t humidity)
+    : _dateTime(dateTime)
+{
+    memset(_values, 0, sizeof(_values));
+    _values[LogChannelTemperature] = temperature;
+    _values[LogChannelHumidity] = humidity;
+    LogRecordSchema::clamp(_values);
 }
 
 
 bool LogRecord::isNull() const
 {
-    return _dateTime.unixtime() == 0 && _humidity == 0.0f && _temperature == 0.0f;
+    if (_dateTime.unixtime() != 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        if (_values[i] != 0) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
 namespace {
     const char WRITE_FORMAT[] PROGMEM = "%04d-%02d-%02d %02d:%02d:%02d";
     const int WRITE_STR_MAXLEN = 32;
-}
-
 
-void LogRecord::writeToSerial() const
+    
+// Write a date/time to the serial.
+//
+void writeDateTimeToSerial(const DateTime &dateTime)
 {
     char timeBuffer[WRITE_STR_MAXLEN];
-    sprintf_P(timeBuffer, WRITE_FORMAT, _dateTime.year(), _dateTime.month(), _dateTime.day(), _dateTime.hour(), _dateTime.minute(), _dateTime.second());
+    sprintf_P(timeBuffer, WRITE_FORMAT, dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second());
     Serial.print(timeBuffer);
-    Serial.print(",");
-    Serial.print(_temperature, 2);
-    Serial.print(",");
-    Serial.println(_humidity, 2);
 }
 
 
-// Anonymous namespace to avoid conflicts.
-namespace {
+// Divide a sum by a count and round to the nearest integer.
+//
+int64_t getRoundedQuotient(int64_t sum, uint32_t count)
+{
+    const int64_t half = count / 2;
+    return (sum < 0 ? sum - half : sum + half) / static_cast<int64_t>(count);
+}
 
 
-// The internal representation of a log record.
+// Get the square root of a value, rounded to the nearest integer.
 //
-struct InternalLogRecord
+uint16_t getSquareRoot(uint32_t value)
 {
-    uint32_t unixtime; // The time as unix timestamp.
-    float humidity; // The humidity value from the sensor.
-    float temperature; // The humidity value from the sensor.
-    uint16_t crc; // The CRC-16 of the record.
-};
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    // The remainder is larger than the root if the value is closer to the next square.
+    if (value > root) {
+        ++root;
+    }
+    return static_cast<uint16_t>(root);
+}
+
+    
+}
+
+
+void LogRecord::writeToSerial() const
+{
+    writeDateTimeToSerial(_dateTime);
+    LogRecordSchema::writeToSerial(_values);
+    Serial.println();
+}
+
+
+LogSession::LogSession(uint32_t recordIndex, const DateTime &startTime, uint32_t interval, uint16_t bootCount)
+    : _recordIndex(recordIndex), _startTime(startTime), _interval(interval), _bootCount(bootCount)
+{
+}
+
+
+LogSession::LogSession()
+    : _recordIndex(0), _startTime(), _interval(0), _bootCount(0)
+{
+}
+
+
+LogSession::~LogSession()
+{
+}
+
+
+void LogSession::writeToSerial() const
+{
+    Serial.print(F("Session start "));
+    writeDateTimeToSerial(_startTime);
+    Serial.print(F(" interval "));
+    Serial.print(_interval);
+    Serial.print(F("s boot "));
+    Serial.println(_bootCount);
+}
+
+
+LogError::LogError(const DateTime &dateTime, Code code, uint8_t attempts)
+    : _dateTime(dateTime), _code(code), _attempts(attempts)
+{
+}
+
+
+LogError::LogError()
+    : _dateTime(), _code(SensorTimeout), _attempts(0)
+{
+}
+
+
+LogError::~LogError()
+{
+}
+
+
+void LogError::writeToSerial() const
+{
+    Serial.print(F("Sensor error "));
+    writeDateTimeToSerial(_dateTime);
+    Serial.print(_code == SensorChecksum ? F(" checksum") : F(" timeout"));
+    Serial.print(F(" attempts "));
+    Serial.println(_attempts);
+}
+
+
+LogRollup::LogRollup(Tier tier)
+    : _tier(tier), _startTime(0), _count(0)
+{
+    memset(_minimum, 0, sizeof(_minimum));
+    memset(_maximum, 0, sizeof(_maximum));
+    memset(_sum, 0, sizeof(_sum));
+}
+
+
+LogRollup::LogRollup()
+    : _tier(Hourly), _startTime(0), _count(0)
+{
+    memset(_minimum, 0, sizeof(_minimum));
+    memset(_maximum, 0, sizeof(_maximum));
+    memset(_sum, 0, sizeof(_sum));
+}
+
+
+LogRollup::~LogRollup()
+{
+}
+
+
+int16_t LogRollup::getMean(uint8_t channel) const
+{
+    if (_count == 0) {
+        return 0;
+    }
+    return static_cast<int16_t>(getRoundedQuotient(_sum[channel], _count));
+}
+
+
+bool LogRollup::isInPeriod(uint32_t unixtime) const
+{
+    return getPeriodStart(_tier, unixtime) == _startTime;
+}
+
+
+void LogRollup::addRecord(const LogRecord &logRecord)
+{
+    if (_count == 0) {
+        _startTime = getPeriodStart(_tier, logRecord.getDateTime().unixtime());
+    }
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        const int16_t value = logRecord.getValue(i);
+        if (_count == 0 || value < _minimum[i]) {
+            _minimum[i] = value;
+        }
+        if (_count == 0 || value > _maximum[i]) {
+            _maximum[i] = value;
+        }
+        _sum[i] += value;
+    }
+    ++_count;
+}
+
+
+void LogRollup::addRollup(const LogRollup &rollup)
+{
+    if (rollup._count == 0) {
+        return;
+    }
+    if (_count == 0) {
+        _startTime = getPeriodStart(_tier, rollup._startTime);
+    }
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        if (_count == 0 || rollup._minimum[i] < _minimum[i]) {
+            _minimum[i] = rollup._minimum[i];
+        }
+        if (_count == 0 || rollup._maximum[i] > _maximum[i]) {
+            _maximum[i] = rollup._maximum[i];
+        }
+        // Use the stored mean, so the result does not change if the rollup is read back from the storage.
+        _sum[i] += static_cast<int64_t>(rollup.getMean(i)) * rollup._count;
+    }
+    _count += rollup._count;
+}
+
+
+void LogRollup::writeToSerial() const
+{
+    writeDateTimeToSerial(getStartTime());
+    Serial.print(',');
+    Serial.print(_count);
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        Serial.print(',');
+        LogRecordSchema::writeValueToSerial(i, _minimum[i]);
+        Serial.print(',');
+        LogRecordSchema::writeValueToSerial(i, getMean(i));
+        Serial.print(',');
+        LogRecordSchema::writeValueToSerial(i, _maximum[i]);
+    }
+    Serial.println();
+}
+
+
+uint32_t LogRollup::getPeriodStart(Tier tier, uint32_t unixtime)
+{
+    const uint32_t period = (tier == Daily ? 86400UL : 3600UL);
+    return unixtime - (unixtime % period);
+}
+
+
+LogStatistics::LogStatistics()
+{
+    reset();
+}
+
+
+LogStatistics::~LogStatistics()
+{
+}
+
+
+void LogStatistics::reset()
+{
+    _count = 0;
+    _isComplete = true;
+    for (uint8_t i = 0; i < ValueCount; ++i) {
+        _minimum[i] = 0;
+        _minimumTime[i] = 0;
+        _maximum[i] = 0;
+        _maximumTime[i] = 0;
+        _sum[i] = 0;
+        _sumOfSquares[i] = 0;
+    }
+    for (uint8_t i = 0; i < LogError::CodeCount; ++i) {
+        _errorCount[i] = 0;
+    }
+}
+
+
+void LogStatistics::addRecord(const LogRecord &logRecord)
+{
+    const uint32_t time = logRecord.getDateTime().unixtime();
+    for (uint8_t i = 0; i < ValueCount; ++i) {
+        const int16_t value = logRecord.getValue(i);
+        if (_count == 0 || value < _minimum[i]) {
+            _minimum[i] = value;
+            _minimumTime[i] = time;
+        }
+        if (_count == 0 || value > _maximum[i]) {
+            _maximum[i] = value;
+            _maximumTime[i] = time;
+        }
+        _sum[i] += value;
+        _sumOfSquares[i] += static_cast<uint32_t>(static_cast<int32_t>(value) * value);
+    }
+    ++_count;
+}
+
+
+void LogStatistics::addError(const LogError &logError)
+{
+    ++_errorCount[logError.getCode()];
+}
+
+
+int16_t LogStatistics::getMean(Value value) const
+{
+    if (_count == 0) {
+        return 0;
+    }
+    return static_cast<int16_t>(getRoundedQuotient(_sum[value], _count));
+}
+
+
+uint16_t LogStatistics::getStandardDeviation(Value value) const
+{
+    if (_count == 0) {
+        return 0;
+    }
+    // The sum of the squared deviations from the rounded mean m is sum(x^2) - 2*m*sum(x) + n*m^2.
+    // The terms are unsigned and may wrap, but the result is exact while it fits into 64 bit,
+    // independent of the number of records. The deviation of the exact mean from m is at most
+    // half a unit and is ignored.
+    const int64_t mean = getMean(value);
+    const uint64_t squaredDeviations = _sumOfSquares[value] + static_cast<uint64_t>(_count) * static_cast<uint64_t>(mean * mean) -
+        static_cast<uint64_t>(2 * mean) * static_cast<uint64_t>(_sum[value]);
+    const uint64_t variance = (squaredDeviations + _count / 2) / _count;
+    return getSquareRoot(variance > 0xffffffffULL ? 0xffffffffUL : static_cast<uint32_t>(variance));
+}
+
+
+void LogStatistics::writeToSerial() const
+{
+    Serial.print(F("Records: "));
+    Serial.print(_count);
+    if (!_isComplete) {
+        Serial.print(F(" (partial, older records were overwritten)"));
+    }
+    Serial.println();
+    Serial.print(F("Sensor errors: timeout "));
+    Serial.print(_errorCount[LogError::SensorTimeout]);
+    Serial.print(F(", checksum "));
+    Serial.println(_errorCount[LogError::SensorChecksum]);
+    if (_count == 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < ValueCount; ++i) {
+        const Value value = static_cast<Value>(i);
+        Serial.print(LogRecordSchema::getName(i));
+        Serial.print(F(": minimum "));
+        LogRecordSchema::writeValueToSerial(i, _minimum[i]);
+        Serial.print(F(" at "));
+        writeDateTimeToSerial(getMinimumTime(value));
+        Serial.print(F(", maximum "));
+        LogRecordSchema::writeValueToSerial(i, _maximum[i]);
+        Serial.print(F(" at "));
+        writeDateTimeToSerial(getMaximumTime(value));
+        Serial.print(F(", mean "));
+        LogRecordSchema::writeValueToSerial(i, getMean(value));
+        Serial.print(F(", standard deviation "));
+        LogRecordSchema::writeValueToSerial(i, static_cast<int16_t>(getStandardDeviation(value)));
+        Serial.println();
+    }
+}
+
+
+// Anonymous namespace to avoid conflicts.
+namespace {
 
     
-inline uint32_t getRecordStart(uint32_t offset, uint32_t index)
+// The number of records converted and written at once by `appendRecords`.
+const uint8_t APPEND_BATCH_SIZE = 4;
+
+// The number of slots for statistics checkpoints.
+const uint8_t STATISTICS_SLOT_COUNT = 2;
+
+// The number of checkpoint areas on a storage which has to be erased, for the statistics and the session index.
+const uint8_t CHECKPOINT_AREA_COUNT = 2;
+
+// The smallest number of erase sectors for the ring of the records on a storage which has to be erased.
+const uint8_t MINIMUM_RING_SECTORS = 8;
+
+// The number of sectors at the start of the ring, which are searched for the first record.
+// Up to two sectors ahead of the log are erased, so the third one has records if the ring is full.
+const uint8_t ERASED_RING_SEARCH_SECTORS = 3;
+
+static_assert(sizeof(InternalLogStatistics) * STATISTICS_SLOT_COUNT <= CONFIG_STATISTICS_SIZE, "The statistics checkpoints do not fit.");
+static_assert(sizeof(InternalSessionIndex) <= CONFIG_SESSION_INDEX_SIZE, "The session index does not fit.");
+static_assert(sizeof(InternalLogStatistics) <= CheckpointArea::MaximumDataSize, "The statistics do not fit into a checkpoint.");
+static_assert(sizeof(InternalSessionIndex) <= CheckpointArea::MaximumDataSize, "The session index does not fit into a checkpoint.");
+static_assert(LogError::CodeCount == LOG_ERROR_CODE_COUNT, "The error codes do not match the storage format.");
+static_assert(CONFIG_KEY_RECORD_END < ConfigStore::KeyCount && CONFIG_KEY_HOURLY_ROLLUP_END < ConfigStore::KeyCount &&
+    CONFIG_KEY_DAILY_ROLLUP_END < ConfigStore::KeyCount, "The keys do not fit into the config store.");
+
+
+inline uint32_t getRecordStart(uint32_t start, uint32_t slot)
 {
-    return offset + (sizeof(InternalLogRecord) * index);
+    return start + (sizeof(InternalLogRecord) * slot);
 }
 
     
 // Read one single internal record from the storage.
 //
 // @param storage The storage to read the record from.
-// @param offset The offset to skip of the storage.
-// @param index The index of the record.
+// @param start The start of the ring of the records.
+// @param slot The slot of the record.
 // @return A copy of the internal record.
 //
-inline InternalLogRecord getInternalRecord(Storage *storage, uint32_t offset, uint32_t index)
+inline InternalLogRecord getInternalRecord(Storage *storage, uint32_t start, uint32_t slot)
 {
     InternalLogRecord record;
-    storage->readBytes(getRecordStart(offset, index), reinterpret_cast<uint8_t*>(&record), sizeof(InternalLogRecord));
+    storage->readBytes(getRecordStart(start, slot), reinterpret_cast<uint8_t*>(&record), sizeof(InternalLogRecord));
     return record;
 }
 
 
-// Write a single internal record to the storage.
+// Get the size of the ring of the records in whole erase sectors.
 //
-// @param storage The storage to write the record to.
-// @param offset The offset to skip of the storage.
-// @param record The record to store.
-// @param index The index of the record.
+// @param capacity The number of slots in the ring.
+// @param eraseSize The size of an erase sector, or 0 if the storage does not have to be erased.
 //
-inline void setInternalRecord(Storage *storage, uint32_t offset, const InternalLogRecord *record, uint32_t index)
+inline uint32_t getRecordRingSize(uint32_t capacity, uint32_t eraseSize)
 {
-    storage->writeBytes(getRecordStart(offset, index), reinterpret_cast<const uint8_t*>(record), sizeof(InternalLogRecord));
+    uint32_t ringSize = sizeof(InternalLogRecord) * capacity;
+    if (eraseSize > 0) {
+        ringSize += (eraseSize - (ringSize % eraseSize)) % eraseSize;
+    }
+    return ringSize;
 }
-    
 
-// Set a record in the storage to zero.
-//
-// @param storage The storage to write the record to.
-// @param offset The offset to skip of the storage.
-// @param index The index of the record to zero.
+
+// Get the record type of the rollups of a tier.
 //
-void zeroInternalRecord(Storage *storage, uint32_t offset, uint32_t index)
+inline uint8_t getRollupType(LogRollup::Tier tier)
 {
-    uint32_t storageIndex = getRecordStart(offset, index);
-    for (uint8_t i = 0; i < sizeof(InternalLogRecord); ++i) {
-        storage->writeByte(storageIndex, 0);
-        ++storageIndex;
-    }
+    return tier == LogRollup::Daily ? LOG_RECORD_TYPE_DAILY : LOG_RECORD_TYPE_HOURLY;
 }
-    
 
-// Check if an internal record is null.
-//
-// This is true if all bytes of the records are null.
-//
-// @param record The record to check.
-// @return true if the record is null.
+
+// Get the key of the end of the ring of a tier in the config store.
 //
-bool isInternalRecordNull(InternalLogRecord *record)
+inline uint8_t getRollupEndKey(LogRollup::Tier tier)
 {
-    uint8_t *recordPtr = reinterpret_cast<uint8_t*>(record);
-    for (uint8_t i = 0; i < sizeof(InternalLogRecord); ++i) {
-        if (*recordPtr != 0) {
-            return false;
-        }
-        ++recordPtr;
-    }
-    return true;
+    return tier == LogRollup::Daily ? CONFIG_KEY_DAILY_ROLLUP_END : CONFIG_KEY_HOURLY_ROLLUP_END;
 }
 
-    
-// Calculate the CRC for the record.
-//
-// The CRC is calculated as CRC-16 while the CRC field is set to 0.
-// All nibbles of the CRC-16 combined by XOR.
+
+// Read one single internal rollup from the storage.
 //
-// @param record The record to calculate the CRC for.
-// @return The 4-bit CRC
+// @param storage The storage to read the rollup from.
+// @param start The start of the ring of the tier.
+// @param slot The slot of the rollup.
+// @return A copy of the internal rollup.
 //
-uint16_t getCRCForInternalRecord(InternalLogRecord *record)
+inline InternalLogRollup getInternalRollup(Storage *storage, uint32_t start, uint32_t slot)
 {
-    uint16_t crc = 0xFFFF;
-    InternalLogRecord recordForCRC = *record;
-    recordForCRC.crc = 0;
-    uint8_t *recordPtr = reinterpret_cast<uint8_t*>(&recordForCRC);
-    for (uint8_t i = 0; i < sizeof(InternalLogRecord); ++i) {
-        crc = _crc16_update(crc, *recordPtr);
-        ++recordPtr;
-    }
-    return crc;
+    InternalLogRollup rollup;
+    storage->readBytes(start + sizeof(InternalLogRollup) * slot, reinterpret_cast<uint8_t*>(&rollup), sizeof(InternalLogRollup));
+    return rollup;
 }
-    
-    
-// Check if an internal record is valid.
-//
-// This is true if all values of the record are in a valid range
-// and the CRC code is valid.
-//
-// @param record The record to check.
-// @return true if the record is valid.
+
+
+// Get the number of rollups for the given part of the log area.
 //
-bool isInternalRecordValid(InternalLogRecord *record)
+inline uint16_t getRollupCapacity(uint32_t size, uint16_t maximum)
 {
-    if (record->humidity < 0.0f ||
-        record->humidity > 100.0f ||
-        record->temperature < -273.15f ||
-        record->temperature > 100.0f) {
-        return false; // out of range.
-    }
-    const uint16_t crc = getCRCForInternalRecord(record);
-    return crc == record->crc;
-}
-    
-    
+    const uint32_t capacity = size / sizeof(InternalLogRollup);
+    return capacity < maximum ? static_cast<uint16_t>(capacity) : maximum;
 }
 
 
-LogSystem::LogSystem(uint32_t reservedForConfig, Storage *storage)
-    : _reservedForConfig(reservedForConfig), _storage(storage), _currentNumberOfRecords(0), _maximumNumberOfRecords(0)
+// Read the records in a ring for `findRingEnd`.
+//
+struct RecordRingReader
 {
-}
+    Storage *storage;
+    uint32_t start;
+    uint32_t sequenceBase;
+    
+    bool read(uint32_t slot, uint32_t &number) const
+    {
+        const InternalLogRecord record = getInternalRecord(storage, start, slot);
+        number = (getInternalRecordSequence(&record) - sequenceBase) & LOG_SEQUENCE_MASK;
+        return isInternalRecordValid(&record);
+    }
+};
 
 
-LogSystem::~LogSystem()
+// Read the rollups in the ring of a tier for `findRingEnd`.
+//
+struct RollupRingReader
 {
-}
+    Storage *storage;
+    uint32_t start;
+    uint32_t sequenceBase;
+    uint8_t type;
+    
+    bool read(uint32_t slot, uint32_t &number) const
+    {
+        const InternalLogRollup rollup = getInternalRollup(storage, start, slot);
+        number = (getInternalRollupSequence(&rollup) - sequenceBase) & LOG_SEQUENCE_MASK;
+        return isInternalRollupValid(&rollup, type);
+    }
+};
 
 
-void LogSystem::begin()
+// Find the end of a ring.
+//
+// The entry with number `n` since the format is written to slot `n % capacity`.
+// If the entry before the stored end is valid, the entries from the stored
+// end on are followed. Otherwise, the lap of the ring is taken from the first
+// valid entry in the first slots, and the entries of this lap are followed
+// from the start of the ring. Corrupted entries are skipped, the ring ends at
+// the first entry from the previous lap or an earlier sequence, or after a
+// longer run of invalid entries.
+//
+// @param reader The reader for the entries, with `bool read(uint32_t slot, uint32_t &number)`.
+// @param capacity The number of slots in the ring.
+// @param storedEnd The end from the config store, or 0 if it is unknown.
+// @return The number of entries written since the format.
+//
+template<typename tReader>
+uint32_t findRingEnd(const tReader &reader, uint32_t capacity, uint32_t storedEnd)
 {
-    // Calculate the maximum number of records.
-    _maximumNumberOfRecords = (_storage->size() - _reservedForConfig) / sizeof(InternalLogRecord);
-    // Scan the storage for valid records.
-    uint32_t index = 0;
-    InternalLogRecord record = getInternalRecord(_storage, _reservedForConfig, index);
-    while (!isInternalRecordNull(&record)) {
-        if (!isInternalRecordValid(&record)) {
+    if (capacity == 0) {
+        return 0;
+    }
+    uint32_t storedNumber;
+    if (storedEnd > 0 && reader.read((storedEnd - 1) % capacity, storedNumber) && storedNumber == storedEnd - 1) {
+        // The stored end can be behind the real one, after an interrupted update.
+        uint32_t end = storedEnd;
+        uint8_t skippedEntries = 0;
+        for (uint32_t next = storedEnd; next < storedEnd - 1 + capacity; ++next) {
+            uint32_t number;
+            if (reader.read(next % capacity, number)) {
+                if (number != next) {
+                    break;
+                }
+                end = next + 1;
+                skippedEntries = 0;
+            } else if (++skippedEntries >= LOG_MAXIMUM_SKIPPED_RECORDS) {
+                break;
+            }
+        }
+        return end;
+    }
+    const uint32_t firstSlots = (capacity < LOG_MAXIMUM_SKIPPED_RECORDS ? capacity : LOG_MAXIMUM_SKIPPED_RECORDS);
+    uint32_t lapStart = 0;
+    bool hasLap = false;
+    for (uint32_t slot = 0; slot < firstSlots && !hasLap; ++slot) {
+        uint32_t number;
+        if (reader.read(slot, number) && number <= LOG_MAXIMUM_RECORD_NUMBER && number % capacity == slot) {
+            lapStart = number - slot;
+            hasLap = true;
+        }
+    }
+    if (!hasLap) {
+        return 0;
+    }
+    uint32_t endSlot = 0;
+    uint8_t skippedEntries = 0;
+    for (uint32_t slot = 0; slot < capacity; ++slot) {
+        uint32_t number;
+        if (reader.read(slot, number)) {
+            if (number != lapStart + slot) {
+                break;
+            }
+            endSlot = slot + 1;
+            skippedEntries = 0;
+        } else if (++skippedEntries >= LOG_MAXIMUM_SKIPPED_RECORDS) {
             break;
         }
-        ++index;
-        record = getInternalRecord(_storage, _reservedForConfig, index);
     }
-    _currentNumberOfRecords = index;
+    return lapStart + endSlot;
 }
 
 
-LogRecord LogSystem::getLogRecord(uint32_t index) const
+// Read the log header and get the sequence base.
+//
+// If the header is damaged, the sequence base is recovered from the
+// first valid record, as if the ring of records is in its first lap.
+// The records of the previous lap are lost in this case.
+//
+// @param storage The storage to read the header from.
+// @param offset The offset of the header.
+// @param recordStart The start of the ring of the records.
+// @return The sequence base.
+//
+uint32_t readSequenceBase(Storage *storage, uint32_t offset, uint32_t recordStart)
 {
-    if (index >= _currentNumberOfRecords) {
-        return LogRecord();
+    InternalLogHeader header;
+    storage->readBytes(offset, reinterpret_cast<uint8_t*>(&header), sizeof(InternalLogHeader));
+    if (header.magic == LOG_HEADER_MAGIC && header.crc == getCRC(&header, offsetof(InternalLogHeader, crc))) {
+        return header.sequenceBase;
     }
-    const InternalLogRecord record = getInternalRecord(_storage, _reservedForConfig, index);
-    return LogRecord(DateTime(record.unixtime), record.temperature, record.humidity);
+    for (uint8_t index = 0; index < LOG_MAXIMUM_SKIPPED_RECORDS; ++index) {
+        const InternalLogRecord record = getInternalRecord(storage, recordStart, index);
+        if (isInternalRecordValid(&record)) {
+            return (getInternalRecordSequence(&record) - index) & LOG_SEQUENCE_MASK;
+        }
+    }
+    return 0;
 }
 
 
-bool LogSystem::appendRecord(const LogRecord &logRecord)
+// Check if a record has the sequence number for the given index.
+//
+inline bool hasExpectedSequence(const InternalLogRecord *record, uint32_t sequenceBase, uint32_t index)
 {
-    if (_currentNumberOfRecords >= _maximumNumberOfRecords) {
-        return false;
-    }
-    // zero the following record if possible
-    if (_currentNumberOfRecords+1 < _maximumNumberOfRecords) {
-        zeroInternalRecord(_storage, _reservedForConfig, _currentNumberOfRecords+1);
-    }
-    // convert the record into the internal structure.
-    InternalLogRecord internalRecord;
-    memset(&internalRecord, 0, sizeof(InternalLogRecord));
-    internalRecord.unixtime = logRecord.getDateTime().unixtime();
-    internalRecord.humidity = logRecord.getHumidity();
-    internalRecord.temperature = logRecord.getTemperature();
-    internalRecord.crc = getCRCForInternalRecord(&internalRecord);
-    setInternalRecord(_storage, _reservedForConfig, &internalRecord, _currentNumberOfRecords);
-    _currentNumberOfRecords++;
-    return true;
+    return getInternalRecordSequence(record) == ((sequenceBase + index) & LOG_SEQUENCE_MASK);
 }
 
 
-void LogSystem::format()
+// Check if a record slot was not written since the last erase.
+//
+bool isErasedRecord(const InternalLogRecord *record)
 {
-    zeroInternalRecord(_storage, _reservedForConfig, 0);
-    zeroInternalRecord(_storage, _reservedForConfig, 1);
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(record);
+    for (uint8_t i = 0; i < sizeof(InternalLogRecord); ++i) {
+        if (data[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
+// The state of a slot in the ring of the records on a storage which has to be erased.
+//
+enum ErasedRingSlot : uint8_t {
+    ErasedRingSlotValid, // The slot has a valid record.
+    ErasedRingSlotErased, // The slot was not written since the last erase.
+    ErasedRingSlotCorrupted, // The slot has a corrupted or partly erased record.
+};
+
+
+// Read the records in a ring on a storage which has to be erased, for `findErasedRing`.
+//
+struct ErasedRingReader
+{
+    Storage *storage;
+    uint32_t start;
+    uint32_t sequenceBase;
+    
+    ErasedRingSlot read(uint32_t slot, uint32_t &number) const
+    {
+        const InternalLogRecord record = getInternalRecord(storage, start, slot);
+        number = (getInternalRecordSequence(&record) - sequenceBase) & LOG_SEQUENCE_MASK;
+        if (isInternalRecordValid(&record)) {
+            return ErasedRingSlotValid;
+        }
+        return isErasedRecord(&record) ? ErasedRingSlotErased : ErasedRingSlotCorrupted;
+    }
+};
 
 
+// The records found in a ring on a storage which has to be erased.
+//
+struct ErasedRing
+{
+    uint32_t first; // The number of the first record since the format.
+    uint32_t end; // The number of records written since the format.
+};
+
+
+// Check if a slot holds a record of the given lap of the ring.
+//
+// Corrupted records are skipped, the first valid or erased slot behind them
+// decides. A run of corrupted records up to the end of the ring belongs to
+// the lap, a longer run in the middle of the ring does not.
+//
+bool isInLap(const ErasedRingReader &reader, uint32_t capacity, uint32_t lapStart, uint32_t slot)
+{
+    uint32_t next = slot;
+    for (; next < capacity && next - slot < LOG_MAXIMUM_SKIPPED_RECORDS; ++next) {
+        uint32_t number;
+        const ErasedRingSlot state = reader.read(next, number);
+        if (state == ErasedRingSlotValid) {
+            return number == lapStart + next;
+        } else if (state == ErasedRingSlotErased) {
+            return false;
+        }
+    }
+    return next >= capacity;
+}
+
+
+// Find the border of the records of a lap in a range of slots, with a binary search.
+//
+// @param isLapFirst If the records of the lap are at the start of the range, otherwise at its end.
+// @return The first slot behind the records of the lap, or the first slot of the lap.
+//
+uint32_t findLapBorder(const ErasedRingReader &reader, uint32_t capacity, uint32_t lapStart, uint32_t low, uint32_t high, bool isLapFirst)
+{
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (isInLap(reader, capacity, lapStart, middle) == isLapFirst) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+// Find the records in the ring on a storage which has to be erased.
+//
+// The record with number `n` since the format is written to slot `n % capacity`.
+// The sectors ahead of the log are erased before it is written, so the log is
+// followed by a gap of erased slots, and then by the oldest records from the
+// previous lap. The lap of the records at the start of the ring is taken from
+// the first valid record in the first sectors. One binary search finds the end
+// of this lap at the gap, another one the first record of the previous lap
+// behind the gap. Corrupted records from an interrupted write keep their place.
+//
+// @param reader The reader for the records.
+// @param capacity The number of slots in the ring.
+// @param eraseSize The size of an erase sector.
+// @return The first and the end of the records.
+//
+ErasedRing findErasedRing(const ErasedRingReader &reader, uint32_t capacity, uint32_t eraseSize)
+{
+    ErasedRing ring = {0, 0};
+    uint32_t lapStart = 0;
+    uint32_t startSlot = 0;
+    bool hasLap = false;
+    for (uint8_t sector = 0; sector < ERASED_RING_SEARCH_SECTORS && !hasLap; ++sector) {
+        // Start with the first slot which is completely in the sector.
+        const uint32_t sectorSlot = (eraseSize * sector + sizeof(InternalLogRecord) - 1) / sizeof(InternalLogRecord);
+        for (uint32_t slot = sectorSlot; slot < capacity && slot - sectorSlot < LOG_MAXIMUM_SKIPPED_RECORDS; ++slot) {
+            uint32_t number;
+            const ErasedRingSlot state = reader.read(slot, number);
+            if (state == ErasedRingSlotValid && number <= LOG_MAXIMUM_RECORD_NUMBER && number % capacity == slot) {
+                lapStart = number - slot;
+                // The records in front of it were removed with the erased sectors.
+                startSlot = (sector == 0 ? 0 : slot);
+                hasLap = true;
+                break;
+            } else if (state != ErasedRingSlotCorrupted) {
+                break;
+            }
+        }
+    }
+    if (!hasLap) {
+        return ring;
+    }
+    uint32_t endSlot = findLapBorder(reader, capacity, lapStart, startSlot, capacity, true);
+    // An interrupted write leaves corrupted records in front of an erased slot,
+    // as the slot behind each write is erased first. A partly erased record
+    // of the previous lap is no part of the log.
+    uint32_t number;
+    for (uint32_t slot = endSlot; slot - endSlot < LOG_MAXIMUM_SKIPPED_RECORDS; ++slot) {
+        if (slot == capacity) {
+            endSlot = slot;
+            break;
+        }
+        const ErasedRingSlot state = reader.read(slot, number);
+        if (state == ErasedRingSlotErased) {
+            endSlot = slot;
+            break;
+        } else if (state != ErasedRingSlotCorrupted) {
+            break;
+        }
+    }
+    ring.first = lapStart + startSlot;
+    ring.end = lapStart + endSlot;
+    if (startSlot == 0 && lapStart >= capacity) {
+        // The records of the previous lap behind the gap are the oldest ones.
+        // The first of them can be partly erased with the gap.
+        const uint32_t previousLapStart = lapStart - capacity;
+        uint32_t firstSlot = findLapBorder(reader, capacity, previousLapStart, endSlot, capacity, false);
+        const uint32_t lapBorder = firstSlot;
+        while (firstSlot < capacity && firstSlot - lapBorder < LOG_MAXIMUM_SKIPPED_RECORDS &&
+            reader.read(firstSlot, number) != ErasedRingSlotValid) {
+            ++firstSlot;
+        }
+        if (firstSlot < capacity) {
+            ring.first = previousLapStart + firstSlot;
+        }
+    }
+    return ring;
+}
+
+
+static_assert(LogRecordView::RecordSize == sizeof(InternalLogRecord), "The size of a record view does not match the storage format.");
+
+
+// Get the type of a record for a view.
+//
+// @param record The record to check.
+// @param sequenceBase The sequence base of the log.
+// @param number The number of the record since the format.
+//
+LogRecordView::Type getViewType(const InternalLogRecord *record, uint32_t sequenceBase, uint32_t number)
+{
+    if (!isInternalRecordValid(record) || !hasExpectedSequence(record, sequenceBase, number)) {
+        return LogRecordView::Corrupted;
+    }
+    switch (getInternalRecordType(record)) {
+    case LOG_RECORD_TYPE_MEASUREMENT:
+        return LogRecordView::Measurement;
+    case LOG_RECORD_TYPE_SESSION:
+        return LogRecordView::Session;
+    case LOG_RECORD_TYPE_ERROR:
+        return LogRecordView::Error;
+    case LOG_RECORD_TYPE_SESSION_LINK:
+        return LogRecordView::SessionLink;
+    default:
+        return LogRecordView::Corrupted;
+    }
+}
+
+
+}
+
+
+LogRecordView::LogRecordView()
+    : _index(0), _type(Corrupted)
+{
+    memset(_data, 0, sizeof(_data));
+}
+
+
+LogRecordView::~LogRecordView()
+{
+}
+
+
+uint32_t LogRecordView::getUnixtime() const
+{
+    return reinterpret_cast<const InternalLogRecord*>(_data)->unixtime;
+}
+
+
+int16_t LogRecordView::getValue(uint8_t channel) const
+{
+    int16_t value;
+    memcpy(&value, _data + offsetof(InternalLogRecord, values) + sizeof(int16_t) * channel, sizeof(int16_t));
+    return value;
+}
+
+
+LogRecord LogRecordView::getLogRecord() const
+{
+    if (_type != Measurement) {
+        return LogRecord();
+    }
+    int16_t values[LogRecordSchema::ChannelCount];
+    memcpy(values, _data + offsetof(InternalLogRecord, values), sizeof(values));
+    return LogRecord(DateTime(getUnixtime()), values);
+}
+
+
+LogSession LogRecordView::getSession() const
+{
+    if (_type != Session) {
+        return LogSession();
+    }
+    const InternalLogRecord *record = reinterpret_cast<const InternalLogRecord*>(_data);
+    return LogSession(_index, DateTime(record->unixtime), static_cast<uint32_t>(record->session.interval) * LOG_SESSION_INTERVAL_UNIT, record->session.bootCount);
+}
+
+
+LogError LogRecordView::getError() const
+{
+    if (_type != Error) {
+        return LogError();
+    }
+    const InternalLogRecord *record = reinterpret_cast<const InternalLogRecord*>(_data);
+    return LogError(DateTime(record->unixtime), static_cast<LogError::Code>(record->error.code), record->error.attempts);
+}
+
+
+void LogRecordView::writeToSerial() const
+{
+    switch (_type) {
+    case Measurement:
+        getLogRecord().writeToSerial();
+        break;
+    case Session:
+        getSession().writeToSerial();
+        break;
+    case Error:
+        getError().writeToSerial();
+        break;
+    default:
+        break;
+    }
+}
+
+
+LogCursor::LogCursor(const LogSystem *logSystem, uint32_t first, uint32_t end)
+    : _logSystem(logSystem), _index(first), _end(end), _bufferIndex(0), _bufferCount(0), _view()
+{
+    if (_end > _logSystem->_currentNumberOfRecords) {
+        _end = _logSystem->_currentNumberOfRecords;
+    }
+    load();
+}
+
+
+LogCursor::~LogCursor()
+{
+}
+
+
+void LogCursor::next()
+{
+    if (isAtEnd()) {
+        return;
+    }
+    ++_index;
+    load();
+}
+
+
+void LogCursor::load()
+{
+    if (isAtEnd()) {
+        return;
+    }
+    const uint32_t number = _logSystem->getRecordNumber(_index);
+    if (_index < _bufferIndex || _index >= _bufferIndex + _bufferCount) {
+        // Read ahead until the end of the range, or the end of the ring.
+        const uint32_t slot = _logSystem->getRecordSlot(number);
+        uint32_t count = _end - _index;
+        if (count > LR_LOG_CURSOR_READ_AHEAD) {
+            count = LR_LOG_CURSOR_READ_AHEAD;
+        }
+        if (count > _logSystem->_maximumNumberOfRecords - slot) {
+            count = _logSystem->_maximumNumberOfRecords - slot;
+        }
+        _logSystem->_storage->readBytes(getRecordStart(_logSystem->_recordStart, slot), _buffer, LogRecordView::RecordSize * count);
+        _bufferIndex = _index;
+        _bufferCount = static_cast<uint8_t>(count);
+    }
+    memcpy(_view._data, _buffer + LogRecordView::RecordSize * (_index - _bufferIndex), LogRecordView::RecordSize);
+    _view._index = _index;
+    _view._type = getViewType(reinterpret_cast<const InternalLogRecord*>(_view._data), _logSystem->_sequenceBase, number);
+}
+
+
+LogSystem::LogSystem(uint32_t reservedForConfig, Storage *storage)
+    : _reservedForConfig(reservedForConfig), _storage(storage), _firstRecord(0), _currentNumberOfRecords(0), _maximumNumberOfRecords(0), _sequenceBase(0),
+    _statistics(), _isStatisticsValid(false), _statisticsRecordCount(0), _statisticsSlot(0),
+    _isSessionIndexValid(false), _sessionCount(0), _lastSessionRecord(0), _bootCount(0), _erasedEnd(0), _configStore(storage),
+    _recordStart(0), _statisticsArea(storage), _sessionIndexArea(storage)
+{
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        _maximumNumberOfRollups[tier] = 0;
+        _rollupEnd[tier] = 0;
+        _currentRollup[tier] = LogRollup(static_cast<LogRollup::Tier>(tier));
+    }
+}
+
+
+LogSystem::~LogSystem()
+{
+}
+
+
+void LogSystem::begin()
+{
+    // A small storage has no config store, which keeps its space for the log.
+    const uint32_t configAreaSize = getConfigAreaSize(_storage->size());
+    if (_reservedForConfig > configAreaSize) {
+        _reservedForConfig = configAreaSize;
+    }
+    // Calculate the maximum number of records and rollups.
+    const uint32_t eraseSize = _storage->eraseSize();
+    const Layout layout = getLayout(_storage->size(), _reservedForConfig, eraseSize);
+    _maximumNumberOfRecords = layout.recordCount;
+    _recordStart = layout.recordStart;
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        _maximumNumberOfRollups[tier] = layout.rollupCount[tier];
+        _rollupEnd[tier] = 0;
+    }
+    _sequenceBase = readSequenceBase(_storage, _reservedForConfig, _recordStart);
+    _configStore.begin(CONFIG_STORE_OFFSET, hasConfigStoreArea() ? CONFIG_STORE_SIZE : 0);
+    const bool hasCheckpointAreas = (isAppendOnly() && _maximumNumberOfRecords > 0);
+    _statisticsArea.begin(layout.checkpointStart, hasCheckpointAreas ? sizeof(InternalLogStatistics) : 0);
+    _sessionIndexArea.begin(layout.checkpointStart + CheckpointArea::SectorCount * eraseSize, hasCheckpointAreas ? sizeof(InternalSessionIndex) : 0);
+    _firstRecord = 0;
+    _currentNumberOfRecords = 0;
+    if (isAppendOnly()) {
+        const ErasedRingReader recordReader = {_storage, _recordStart, _sequenceBase};
+        const ErasedRing ring = (_maximumNumberOfRecords > 0 ? findErasedRing(recordReader, _maximumNumberOfRecords, eraseSize) : ErasedRing{0, 0});
+        _firstRecord = ring.first;
+        _currentNumberOfRecords = ring.end - ring.first;
+        // The sectors of the slot behind the last record were erased before the last
+        // record was written, and nothing was written to them since.
+        _erasedEnd = getRecordEnd(ring.end);
+        _erasedEnd += (eraseSize - (_erasedEnd % eraseSize)) % eraseSize;
+    } else {
+        const RecordRingReader recordReader = {_storage, _recordStart, _sequenceBase};
+        const uint32_t recordEnd = findRingEnd(recordReader, _maximumNumberOfRecords, _configStore.getValue(CONFIG_KEY_RECORD_END));
+        _currentNumberOfRecords = (recordEnd < _maximumNumberOfRecords ? recordEnd : _maximumNumberOfRecords);
+        _firstRecord = recordEnd - _currentNumberOfRecords;
+        for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+            const LogRollup::Tier rollupTier = static_cast<LogRollup::Tier>(tier);
+            const RollupRingReader rollupReader = {_storage, getRollupStart(rollupTier), _sequenceBase, getRollupType(rollupTier)};
+            _rollupEnd[tier] = findRingEnd(rollupReader, _maximumNumberOfRollups[tier], _configStore.getValue(getRollupEndKey(rollupTier)));
+        }
+    }
+    readStatistics();
+    readSessionIndex();
+    restoreCurrentRollups();
+}
+
+
+LogSystem::Layout LogSystem::getLayout(uint32_t storageSize, uint32_t reservedForConfig, uint32_t eraseSize)
+{
+    Layout layout;
+    memset(&layout, 0, sizeof(Layout));
+    layout.recordStart = reservedForConfig + sizeof(InternalLogHeader);
+    if (storageSize < layout.recordStart) {
+        return layout;
+    }
+    if (eraseSize > 0) {
+        // The checkpoint areas start with the sector behind the header, followed
+        // by the ring of the records in whole sectors. There are no rollups.
+        layout.checkpointStart = layout.recordStart + (eraseSize - (layout.recordStart % eraseSize)) % eraseSize;
+        layout.recordStart = layout.checkpointStart + CHECKPOINT_AREA_COUNT * CheckpointArea::SectorCount * eraseSize;
+        if (storageSize >= layout.recordStart + MINIMUM_RING_SECTORS * eraseSize) {
+            layout.recordCount = (storageSize - layout.recordStart) / eraseSize * eraseSize / sizeof(InternalLogRecord);
+        }
+        return layout;
+    }
+    uint32_t logSize = storageSize - layout.recordStart;
+    // The rings of the rollups are placed at the end of the storage.
+    layout.rollupCount[LogRollup::Hourly] = getRollupCapacity(logSize / LR_LOG_HOURLY_TIER_PART, LR_LOG_HOURLY_TIER_MAXIMUM);
+    layout.rollupCount[LogRollup::Daily] = getRollupCapacity(logSize / LR_LOG_DAILY_TIER_PART, LR_LOG_DAILY_TIER_MAXIMUM);
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        logSize -= sizeof(InternalLogRollup) * layout.rollupCount[tier];
+    }
+    layout.recordCount = logSize / sizeof(InternalLogRecord);
+    return layout;
+}
+
+
+LogRecord LogSystem::getLogRecord(uint32_t index) const
+{
+    if (index >= _currentNumberOfRecords) {
+        return LogRecord();
+    }
+    const uint32_t number = getRecordNumber(index);
+    const InternalLogRecord record = getInternalRecord(_storage, _recordStart, getRecordSlot(number));
+    if (!isInternalRecordValid(&record) || !hasExpectedSequence(&record, _sequenceBase, number)) {
+        return LogRecord(); // corrupted record.
+    }
+    if (getInternalRecordType(&record) != LOG_RECORD_TYPE_MEASUREMENT) {
+        return LogRecord();
+    }
+    int16_t values[LogRecordSchema::ChannelCount];
+    memcpy(values, record.values, sizeof(values));
+    return LogRecord(DateTime(record.unixtime), values);
+}
+
+
+LogCursor LogSystem::getRecords(uint32_t first, uint32_t end) const
+{
+    return LogCursor(this, first, end);
+}
+
+
+LogCursor LogSystem::getRecords() const
+{
+    return LogCursor(this, 0, _currentNumberOfRecords);
+}
+
+
+bool LogSystem::appendRecord(const LogRecord &logRecord)
+{
+    return appendRecords(&logRecord, 1);
+}
+
+
+bool LogSystem::appendRecords(const LogRecord *logRecords, uint8_t count)
+{
+    if (!hasSpaceFor(count)) {
+        return false;
+    }
+    InternalLogRecord internalRecords[APPEND_BATCH_SIZE];
+    while (count > 0) {
+        const uint32_t number = totalNumberOfRecords();
+        const uint32_t slot = getRecordSlot(number);
+        uint8_t batchSize = (count < APPEND_BATCH_SIZE ? count : APPEND_BATCH_SIZE);
+        if (batchSize > _maximumNumberOfRecords - slot) {
+            batchSize = static_cast<uint8_t>(_maximumNumberOfRecords - slot); // The batch ends at the end of the ring.
+        }
+        // The slot behind the batch has to stay erased, it marks the end of the log.
+        eraseUntil(getRecordEnd(number + batchSize));
+        // convert the records into the internal structure.
+        for (uint8_t i = 0; i < batchSize; ++i) {
+            InternalLogRecord &internalRecord = internalRecords[i];
+            internalRecord.unixtime = logRecords[i].getDateTime().unixtime();
+            internalRecord.sequence = getSequenceField(LOG_RECORD_TYPE_MEASUREMENT, _sequenceBase + number + i);
+            memcpy(internalRecord.values, logRecords[i].getValues(), sizeof(internalRecord.values));
+            internalRecord.crc = getCRCForInternalRecord(&internalRecord);
+            if (_isStatisticsValid) {
+                _statistics.addRecord(logRecords[i]);
+            }
+            addToRollups(logRecords[i]);
+        }
+        _storage->writeBytes(getRecordStart(_recordStart, slot),
+            reinterpret_cast<const uint8_t*>(internalRecords), sizeof(InternalLogRecord) * batchSize);
+        addWrittenRecords(batchSize);
+        checkpointStatistics();
+        logRecords += batchSize;
+        count -= batchSize;
+    }
+    return true;
+}
+
+
+bool LogSystem::appendError(const LogError &logError)
+{
+    if (!hasSpaceFor(1)) {
+        return false;
+    }
+    const uint32_t number = totalNumberOfRecords();
+    InternalLogRecord errorRecord;
+    memset(&errorRecord, 0, sizeof(InternalLogRecord));
+    errorRecord.unixtime = logError.getDateTime().unixtime();
+    errorRecord.sequence = getSequenceField(LOG_RECORD_TYPE_ERROR, _sequenceBase + number);
+    errorRecord.error.code = logError.getCode();
+    errorRecord.error.attempts = logError.getAttempts();
+    errorRecord.crc = getCRCForInternalRecord(&errorRecord);
+    eraseUntil(getRecordEnd(number + 1));
+    _storage->writeBytes(getRecordStart(_recordStart, getRecordSlot(number)), reinterpret_cast<const uint8_t*>(&errorRecord), sizeof(InternalLogRecord));
+    addWrittenRecords(1);
+    if (_isStatisticsValid) {
+        _statistics.addError(logError);
+    }
+    checkpointStatistics();
+    return true;
+}
+
+
+bool LogSystem::appendSession(const DateTime &startTime, uint32_t interval)
+{
+    if (!hasSpaceFor(2)) {
+        return false;
+    }
+    if (!_isSessionIndexValid) {
+        rebuildSessionIndex();
+    }
+    ++_bootCount;
+    const uint32_t number = totalNumberOfRecords();
+    // Update the index first. If the session records are not written,
+    // the last entry of the index does not point to a linked session record.
+    if (hasSessionIndexArea()) {
+        InternalSessionIndex index;
+        if (!loadSessionIndex(&index)) {
+            memset(&index, 0, sizeof(InternalSessionIndex));
+        }
+        index.bootCount = _bootCount;
+        index.sessionCount = _sessionCount + 1;
+        index.sessionStart[_sessionCount % LOG_SESSION_INDEX_SIZE] = number;
+        writeSessionIndex(&index);
+    }
+    InternalLogRecord sessionRecords[2];
+    memset(sessionRecords, 0, sizeof(sessionRecords));
+    InternalLogRecord &sessionRecord = sessionRecords[0];
+    sessionRecord.unixtime = startTime.unixtime();
+    sessionRecord.sequence = getSequenceField(LOG_RECORD_TYPE_SESSION, _sequenceBase + number);
+    sessionRecord.session.bootCount = _bootCount;
+    sessionRecord.session.interval = static_cast<uint16_t>((interval + LOG_SESSION_INTERVAL_UNIT - 1) / LOG_SESSION_INTERVAL_UNIT);
+    sessionRecord.crc = getCRCForInternalRecord(&sessionRecord);
+    // The link record behind the session record chains it to the previous session.
+    InternalLogRecord &linkRecord = sessionRecords[1];
+    linkRecord.unixtime = sessionRecord.unixtime;
+    linkRecord.sequence = getSequenceField(LOG_RECORD_TYPE_SESSION_LINK, _sequenceBase + number + 1);
+    linkRecord.sessionLink.session = _sessionCount;
+    if (_sessionCount > 0 && number - _lastSessionRecord <= 0xffffu) {
+        linkRecord.sessionLink.previousDistance = static_cast<uint16_t>(number - _lastSessionRecord);
+    }
+    linkRecord.crc = getCRCForInternalRecord(&linkRecord);
+    for (uint8_t i = 0; i < 2; ++i) {
+        eraseUntil(getRecordEnd(number + i + 1));
+        _storage->writeBytes(getRecordStart(_recordStart, getRecordSlot(number + i)), reinterpret_cast<const uint8_t*>(&sessionRecords[i]), sizeof(InternalLogRecord));
+    }
+    addWrittenRecords(2);
+    _lastSessionRecord = number;
+    ++_sessionCount;
+    checkpointStatistics();
+    return true;
+}
+
+
+uint16_t LogSystem::currentNumberOfSessions()
+{
+    if (!_isSessionIndexValid) {
+        rebuildSessionIndex();
+    }
+    return _sessionCount;
+}
+
+
+LogSession LogSystem::getSession(uint16_t session)
+{
+    if (session >= currentNumberOfSessions()) {
+        return LogSession();
+    }
+    // Start with the session in the index, or the oldest one in the index
+    // for an older session, and follow the links back to the session.
+    uint16_t linkedSession = _sessionCount - 1;
+    uint32_t recordNumber = _lastSessionRecord;
+    if (_sessionIndexArea.isEnabled()) {
+        InternalSessionIndex index;
+        if (loadSessionIndex(&index)) {
+            linkedSession = static_cast<uint16_t>(_sessionCount - session <= LOG_SESSION_INDEX_SIZE ? session : _sessionCount - LOG_SESSION_INDEX_SIZE);
+            recordNumber = index.sessionStart[linkedSession % LOG_SESSION_INDEX_SIZE];
+        }
+    } else if (hasSessionIndexArea()) {
+        linkedSession = static_cast<uint16_t>(_sessionCount - session <= LOG_SESSION_INDEX_SIZE ? session : _sessionCount - LOG_SESSION_INDEX_SIZE);
+        _storage->readBytes(CONFIG_SESSION_INDEX_OFFSET + offsetof(InternalSessionIndex, sessionStart) + sizeof(uint32_t) * (linkedSession % LOG_SESSION_INDEX_SIZE),
+            reinterpret_cast<uint8_t*>(&recordNumber), sizeof(uint32_t));
+    }
+    InternalSessionLinkData link;
+    while (readSessionLink(recordNumber, link) && link.session == linkedSession) {
+        if (linkedSession == session) {
+            return getSessionAtRecord(recordNumber - _firstRecord);
+        }
+        if (link.previousDistance == 0 || link.previousDistance > recordNumber - _firstRecord) {
+            break; // The previous session record was overwritten.
+        }
+        recordNumber -= link.previousDistance;
+        --linkedSession;
+    }
+    return LogSession();
+}
+
+
+uint32_t LogSystem::getSessionEnd(uint16_t session)
+{
+    const LogSession nextSession = getSession(session + 1);
+    if (nextSession.isNull()) {
+        return _currentNumberOfRecords;
+    }
+    return nextSession.getRecordIndex();
+}
+
+
+LogSession LogSystem::getSessionAtRecord(uint32_t index) const
+{
+    if (index >= _currentNumberOfRecords) {
+        return LogSession();
+    }
+    const uint32_t number = getRecordNumber(index);
+    const InternalLogRecord record = getInternalRecord(_storage, _recordStart, getRecordSlot(number));
+    if (!isInternalRecordValid(&record) || !hasExpectedSequence(&record, _sequenceBase, number) ||
+        getInternalRecordType(&record) != LOG_RECORD_TYPE_SESSION) {
+        return LogSession();
+    }
+    return LogSession(index, DateTime(record.unixtime), static_cast<uint32_t>(record.session.interval) * LOG_SESSION_INTERVAL_UNIT, record.session.bootCount);
+}
+
+
+bool LogSystem::readSessionLink(uint32_t number, InternalSessionLinkData &link) const
+{
+    if (number < _firstRecord || number + 1 >= totalNumberOfRecords()) {
+        return false;
+    }
+    const InternalLogRecord record = getInternalRecord(_storage, _recordStart, getRecordSlot(number + 1));
+    if (!isInternalRecordValid(&record) || !hasExpectedSequence(&record, _sequenceBase, number + 1) ||
+        getInternalRecordType(&record) != LOG_RECORD_TYPE_SESSION_LINK) {
+        return false;
+    }
+    link = record.sessionLink;
+    return true;
+}
+
+
+LogError LogSystem::getErrorAtRecord(uint32_t index) const
+{
+    if (index >= _currentNumberOfRecords) {
+        return LogError();
+    }
+    const uint32_t number = getRecordNumber(index);
+    const InternalLogRecord record = getInternalRecord(_storage, _recordStart, getRecordSlot(number));
+    if (!isInternalRecordValid(&record) || !hasExpectedSequence(&record, _sequenceBase, number) ||
+        getInternalRecordType(&record) != LOG_RECORD_TYPE_ERROR) {
+        return LogError();
+    }
+    return LogError(DateTime(record.unixtime), static_cast<LogError::Code>(record.error.code), record.error.attempts);
+}
+
+
+const LogStatistics& LogSystem::getStatistics()
+{
+    if (!_isStatisticsValid) {
+        rebuildStatistics();
+    }
+    return _statistics;
+}
+
+
+uint16_t LogSystem::currentNumberOfRollups(LogRollup::Tier tier) const
+{
+    if (_rollupEnd[tier] < _maximumNumberOfRollups[tier]) {
+        return static_cast<uint16_t>(_rollupEnd[tier]);
+    }
+    return _maximumNumberOfRollups[tier];
+}
+
+
+LogRollup LogSystem::getRollup(LogRollup::Tier tier, uint32_t index) const
+{
+    const uint16_t count = currentNumberOfRollups(tier);
+    if (index >= count) {
+        return LogRollup();
+    }
+    const uint32_t number = _rollupEnd[tier] - count + index;
+    const InternalLogRollup rollup = getInternalRollup(_storage, getRollupStart(tier), number % _maximumNumberOfRollups[tier]);
+    if (!isInternalRollupValid(&rollup, getRollupType(tier)) ||
+        getInternalRollupSequence(&rollup) != ((_sequenceBase + number) & LOG_SEQUENCE_MASK)) {
+        return LogRollup(); // corrupted rollup.
+    }
+    LogRollup logRollup(tier);
+    logRollup._startTime = rollup.unixtime;
+    logRollup._count = rollup.count;
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        const InternalRollupValues values = rollup.values[i];
+        logRollup._minimum[i] = values.minimum;
+        logRollup._maximum[i] = values.maximum;
+        logRollup._sum[i] = static_cast<int64_t>(values.mean) * rollup.count;
+    }
+    return logRollup;
+}
+
+
+LogRollup LogSystem::getCurrentRollup(LogRollup::Tier tier) const
+{
+    // The current periods of the shorter tiers are added to a tier when they end.
+    LogRollup logRollup = _currentRollup[tier];
+    for (uint8_t shorterTier = tier; shorterTier > 0; --shorterTier) {
+        logRollup.addRollup(_currentRollup[shorterTier - 1]);
+    }
+    return logRollup;
+}
+
+
+void LogSystem::format()
+{
+    // Start a new sequence behind all sequence numbers in use. This turns
+    // all existing records into records from an earlier sequence. There
+    // are never more rollups than records, so this includes the rollups.
+    _sequenceBase = (_sequenceBase + totalNumberOfRecords() + _maximumNumberOfRecords) & LOG_SEQUENCE_MASK;
+    const Layout layout = getLayout(_storage->size(), _reservedForConfig, _storage->eraseSize());
+    _firstRecord = 0;
+    _currentNumberOfRecords = 0;
+    _maximumNumberOfRecords = layout.recordCount;
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        _maximumNumberOfRollups[tier] = layout.rollupCount[tier];
+        _rollupEnd[tier] = 0;
+        _currentRollup[tier] = LogRollup(static_cast<LogRollup::Tier>(tier));
+    }
+    if (isAppendOnly()) {
+        // Erase the sector of the header, and the sectors for the first record.
+        _storage->eraseSector(_reservedForConfig);
+        _erasedEnd = 0;
+        eraseUntil(getRecordEnd(0));
+    }
+    InternalLogHeader header;
+    header.magic = LOG_HEADER_MAGIC;
+    header.sequenceBase = _sequenceBase;
+    header.crc = getCRC(&header, offsetof(InternalLogHeader, crc));
+    _storage->writeBytes(_reservedForConfig, reinterpret_cast<const uint8_t*>(&header), sizeof(InternalLogHeader));
+    _configStore.setValue(CONFIG_KEY_RECORD_END, 0);
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        _configStore.setValue(getRollupEndKey(static_cast<LogRollup::Tier>(tier)), 0);
+    }
+    _statistics.reset();
+    _isStatisticsValid = true;
+    writeStatistics();
+    // The boot count is kept, all sessions are removed.
+    if (!_isSessionIndexValid) {
+        rebuildSessionIndex();
+    }
+    InternalSessionIndex index;
+    memset(&index, 0, sizeof(InternalSessionIndex));
+    index.bootCount = _bootCount;
+    _sessionCount = 0;
+    _lastSessionRecord = 0;
+    writeSessionIndex(&index);
+}
+
+
+bool LogSystem::eraseAhead()
+{
+    if (!isAppendOnly() || _maximumNumberOfRecords == 0) {
+        return false;
+    }
+    // Keep one sector erased ahead of the sectors needed for the next record.
+    const uint32_t end = getRecordEnd(totalNumberOfRecords() + 1) + _storage->eraseSize();
+    if (_erasedEnd >= end) {
+        return false;
+    }
+    eraseUntil(_erasedEnd + 1);
+    return true;
+}
+
+
+bool LogSystem::isAppendOnly() const
+{
+    return _storage->eraseSize() != 0;
+}
+
+
+void LogSystem::eraseUntil(uint32_t end)
+{
+    if (!isAppendOnly() || _maximumNumberOfRecords == 0) {
+        return;
+    }
+    const uint32_t eraseSize = _storage->eraseSize();
+    const uint32_t ringSize = getRecordRingSize(_maximumNumberOfRecords, eraseSize);
+    while (_erasedEnd < end) {
+        _storage->eraseSector(_recordStart + (_erasedEnd % ringSize));
+        _erasedEnd += eraseSize - (_erasedEnd % eraseSize);
+        // Remove the records of the previous lap, which started in the erased sector.
+        while (_currentNumberOfRecords > 0 && _erasedEnd > ringSize &&
+            getRecordEnd(_firstRecord) - sizeof(InternalLogRecord) < _erasedEnd - ringSize) {
+            ++_firstRecord;
+            --_currentNumberOfRecords;
+        }
+    }
+}
+
+
+uint32_t LogSystem::getRecordEnd(uint32_t number) const
+{
+    if (_maximumNumberOfRecords == 0) {
+        return 0;
+    }
+    return (number / _maximumNumberOfRecords) * getRecordRingSize(_maximumNumberOfRecords, _storage->eraseSize()) +
+        getRecordStart(0, getRecordSlot(number) + 1);
+}
+
+
+bool LogSystem::hasSpaceFor(uint8_t count) const
+{
+    return count <= _maximumNumberOfRecords; // The oldest records are overwritten.
+}
+
+
+void LogSystem::addWrittenRecords(uint8_t count)
+{
+    _currentNumberOfRecords += count;
+    if (_currentNumberOfRecords > _maximumNumberOfRecords) {
+        _firstRecord += _currentNumberOfRecords - _maximumNumberOfRecords;
+        _currentNumberOfRecords = _maximumNumberOfRecords;
+    }
+    if (totalNumberOfRecords() - _configStore.getValue(CONFIG_KEY_RECORD_END) >= LR_LOG_END_STORE_INTERVAL) {
+        _configStore.setValue(CONFIG_KEY_RECORD_END, totalNumberOfRecords());
+    }
+}
+
+
+uint32_t LogSystem::getRollupStart(LogRollup::Tier tier) const
+{
+    // The ring of the longest tier is at the end of the storage.
+    uint32_t start = _storage->size();
+    for (uint8_t longerTier = LogRollup::TierCount; longerTier > tier; --longerTier) {
+        start -= sizeof(InternalLogRollup) * _maximumNumberOfRollups[longerTier - 1];
+    }
+    return start;
+}
+
+
+void LogSystem::addToRollups(const LogRecord &logRecord)
+{
+    if (isAppendOnly()) {
+        return; // There are no rollups on a storage which has to be erased.
+    }
+    const uint32_t time = logRecord.getDateTime().unixtime();
+    LogRollup &hourlyRollup = _currentRollup[LogRollup::Hourly];
+    LogRollup &dailyRollup = _currentRollup[LogRollup::Daily];
+    // Close the hour first, as it is part of the day.
+    if (!hourlyRollup.isNull() && !hourlyRollup.isInPeriod(time)) {
+        writeRollup(hourlyRollup);
+        dailyRollup.addRollup(hourlyRollup);
+        hourlyRollup = LogRollup(LogRollup::Hourly);
+    }
+    if (!dailyRollup.isNull() && !dailyRollup.isInPeriod(time)) {
+        writeRollup(dailyRollup);
+        dailyRollup = LogRollup(LogRollup::Daily);
+    }
+    hourlyRollup.addRecord(logRecord);
+}
+
+
+void LogSystem::writeRollup(const LogRollup &rollup)
+{
+    const LogRollup::Tier tier = rollup.getTier();
+    if (_maximumNumberOfRollups[tier] == 0) {
+        return;
+    }
+    const uint32_t number = _rollupEnd[tier];
+    InternalLogRollup internalRollup;
+    internalRollup.unixtime = rollup._startTime;
+    internalRollup.sequence = getSequenceField(getRollupType(tier), _sequenceBase + number);
+    internalRollup.count = rollup._count;
+    for (uint8_t i = 0; i < LogRecordSchema::ChannelCount; ++i) {
+        InternalRollupValues values;
+        values.minimum = rollup._minimum[i];
+        values.mean = rollup.getMean(i);
+        values.maximum = rollup._maximum[i];
+        internalRollup.values[i] = values;
+    }
+    internalRollup.crc = getCRC(&internalRollup, offsetof(InternalLogRollup, crc));
+    _storage->writeBytes(getRollupStart(tier) + sizeof(InternalLogRollup) * (number % _maximumNumberOfRollups[tier]),
+        reinterpret_cast<const uint8_t*>(&internalRollup), sizeof(InternalLogRollup));
+    ++_rollupEnd[tier];
+    if (_rollupEnd[tier] - _configStore.getValue(getRollupEndKey(tier)) >= LR_LOG_END_STORE_INTERVAL) {
+        _configStore.setValue(getRollupEndKey(tier), _rollupEnd[tier]);
+    }
+}
+
+
+void LogSystem::restoreCurrentRollups()
+{
+    LogRollup &hourlyRollup = _currentRollup[LogRollup::Hourly];
+    LogRollup &dailyRollup = _currentRollup[LogRollup::Daily];
+    hourlyRollup = LogRollup(LogRollup::Hourly);
+    dailyRollup = LogRollup(LogRollup::Daily);
+    if (isAppendOnly()) {
+        return;
+    }
+    // Add the records of the latest hour, if it has no rollup yet. A rollup
+    // is written before the first record of the next period.
+    const uint16_t hourlyCount = currentNumberOfRollups(LogRollup::Hourly);
+    const LogRollup lastHourlyRollup = getRollup(LogRollup::Hourly, hourlyCount - 1);
+    for (uint32_t index = _currentNumberOfRecords; index > 0; --index) {
+        const LogRecord logRecord = getLogRecord(index - 1);
+        if (logRecord.isNull()) {
+            continue;
+        }
+        const uint32_t time = logRecord.getDateTime().unixtime();
+        if (hourlyRollup.isNull()) {
+            if (!lastHourlyRollup.isNull() && LogRollup::getPeriodStart(LogRollup::Hourly, time) <= lastHourlyRollup._startTime) {
+                break;
+            }
+        } else if (!hourlyRollup.isInPeriod(time)) {
+            break;
+        }
+        hourlyRollup.addRecord(logRecord);
+    }
+    // Add the hourly rollups of the latest day, if it has no rollup yet.
+    uint32_t dayStart;
+    if (!hourlyRollup.isNull()) {
+        dayStart = LogRollup::getPeriodStart(LogRollup::Daily, hourlyRollup._startTime);
+    } else if (!lastHourlyRollup.isNull()) {
+        dayStart = LogRollup::getPeriodStart(LogRollup::Daily, lastHourlyRollup._startTime);
+    } else {
+        return;
+    }
+    const LogRollup lastDailyRollup = getRollup(LogRollup::Daily, currentNumberOfRollups(LogRollup::Daily) - 1);
+    if (!lastDailyRollup.isNull() && dayStart <= lastDailyRollup._startTime) {
+        return;
+    }
+    for (uint16_t index = hourlyCount; index > 0; --index) {
+        const LogRollup logRollup = getRollup(LogRollup::Hourly, index - 1);
+        if (logRollup.isNull()) {
+            continue;
+        }
+        if (LogRollup::getPeriodStart(LogRollup::Daily, logRollup._startTime) != dayStart) {
+            break;
+        }
+        dailyRollup.addRollup(logRollup);
+    }
+}
+
+
+bool LogSystem::hasConfigStoreArea() const
+{
+    if (isAppendOnly()) {
+        return false; // The entries are rewritten in place.
+    }
+    return _reservedForConfig >= CONFIG_STORE_OFFSET + CONFIG_STORE_SIZE;
+}
+
+
+bool LogSystem::hasStatisticsArea() const
+{
+    if (isAppendOnly()) {
+        return _statisticsArea.isEnabled(); // The checkpoints are appended.
+    }
+    return _reservedForConfig >= CONFIG_STATISTICS_OFFSET + CONFIG_STATISTICS_SIZE;
+}
+
+
+void LogSystem::readStatistics()
+{
+    _statistics.reset();
+    _isStatisticsValid = false;
+    _statisticsRecordCount = 0;
+    _statisticsSlot = 0;
+    if (!hasStatisticsArea()) {
+        return;
+    }
+    // Use the valid checkpoint of the current sequence with the most records.
+    InternalLogStatistics checkpoint;
+    memset(&checkpoint, 0, sizeof(InternalLogStatistics));
+    // The checkpoint area keeps the previous checkpoint itself.
+    const uint8_t slotCount = (_statisticsArea.isEnabled() ? 1 : STATISTICS_SLOT_COUNT);
+    for (uint8_t slot = 0; slot < slotCount; ++slot) {
+        InternalLogStatistics candidate;
+        if (_statisticsArea.isEnabled()) {
+            if (!_statisticsArea.read(reinterpret_cast<uint8_t*>(&candidate))) {
+                continue;
+            }
+        } else {
+            _storage->readBytes(CONFIG_STATISTICS_OFFSET + sizeof(InternalLogStatistics) * slot, reinterpret_cast<uint8_t*>(&candidate), sizeof(InternalLogStatistics));
+        }
+        if (candidate.crc != getCRC(&candidate, offsetof(InternalLogStatistics, crc)) ||
+            candidate.sequenceBase != _sequenceBase ||
+            candidate.recordCount > totalNumberOfRecords()) {
+            continue;
+        }
+        if (!_isStatisticsValid || candidate.recordCount > checkpoint.recordCount) {
+            checkpoint = candidate;
+            _isStatisticsValid = true;
+            _statisticsSlot = (slot + 1) % STATISTICS_SLOT_COUNT;
+        }
+    }
+    if (_isStatisticsValid && checkpoint.recordCount < _firstRecord) {
+        _isStatisticsValid = false; // Records after the checkpoint were overwritten.
+    }
+    if (!_isStatisticsValid) {
+        return; // Rebuild the statistics if they are requested.
+    }
+    _statistics._count = checkpoint.count;
+    _statistics._isComplete = (checkpoint.isComplete != 0);
+    for (uint8_t i = 0; i < LogStatistics::ValueCount; ++i) {
+        const InternalValueStatistics &values = checkpoint.values[i];
+        _statistics._minimum[i] = values.minimum;
+        _statistics._minimumTime[i] = values.minimumTime;
+        _statistics._maximum[i] = values.maximum;
+        _statistics._maximumTime[i] = values.maximumTime;
+        _statistics._sum[i] = values.sum;
+        _statistics._sumOfSquares[i] = values.sumOfSquares;
+    }
+    for (uint8_t i = 0; i < LogError::CodeCount; ++i) {
+        _statistics._errorCount[i] = checkpoint.errorCount[i];
+    }
+    _statisticsRecordCount = checkpoint.recordCount;
+    // Add the records written after the checkpoint.
+    for (const LogRecordView &view : getRecords(checkpoint.recordCount - _firstRecord, _currentNumberOfRecords)) {
+        addToStatistics(view);
+    }
+}
+
+
+void LogSystem::writeStatistics()
+{
+    _statisticsRecordCount = totalNumberOfRecords();
+    if (!hasStatisticsArea()) {
+        return;
+    }
+    InternalLogStatistics checkpoint;
+    checkpoint.sequenceBase = _sequenceBase;
+    checkpoint.recordCount = _statisticsRecordCount;
+    checkpoint.count = _statistics._count;
+    for (uint8_t i = 0; i < LogStatistics::ValueCount; ++i) {
+        InternalValueStatistics &values = checkpoint.values[i];
+        values.minimum = _statistics._minimum[i];
+        values.minimumTime = _statistics._minimumTime[i];
+        values.maximum = _statistics._maximum[i];
+        values.maximumTime = _statistics._maximumTime[i];
+        values.sum = _statistics._sum[i];
+        values.sumOfSquares = _statistics._sumOfSquares[i];
+    }
+    for (uint8_t i = 0; i < LogError::CodeCount; ++i) {
+        checkpoint.errorCount[i] = _statistics._errorCount[i];
+    }
+    checkpoint.isComplete = (_statistics._isComplete ? 1 : 0);
+    checkpoint.crc = getCRC(&checkpoint, offsetof(InternalLogStatistics, crc));
+    if (_statisticsArea.isEnabled()) {
+        _statisticsArea.write(reinterpret_cast<const uint8_t*>(&checkpoint));
+        return;
+    }
+    // Write the slot which does not hold the latest checkpoint, an interrupted write keeps the other one.
+    _storage->writeBytes(CONFIG_STATISTICS_OFFSET + sizeof(InternalLogStatistics) * _statisticsSlot, reinterpret_cast<const uint8_t*>(&checkpoint), sizeof(InternalLogStatistics));
+    _statisticsSlot = (_statisticsSlot + 1) % STATISTICS_SLOT_COUNT;
+}
+
+
+void LogSystem::checkpointStatistics()
+{
+    // A checkpoint at least four times for each lap keeps the records after the
+    // latest two checkpoints in the ring, even if the last write was interrupted.
+    uint32_t interval = _maximumNumberOfRecords / 4;
+    if (interval > LR_LOG_STATISTICS_CHECKPOINT_INTERVAL) {
+        interval = LR_LOG_STATISTICS_CHECKPOINT_INTERVAL;
+    }
+    if (_isStatisticsValid && totalNumberOfRecords() - _statisticsRecordCount >= interval) {
+        writeStatistics();
+    }
+}
+
+
+void LogSystem::rebuildStatistics()
+{
+    _statistics.reset();
+    // The records before the first one in the ring are lost.
+    _statistics._isComplete = (_firstRecord == 0);
+    for (const LogRecordView &view : getRecords()) {
+        addToStatistics(view);
+    }
+    _isStatisticsValid = true;
+    writeStatistics();
+}
+
+
+void LogSystem::addToStatistics(const LogRecordView &view)
+{
+    if (view.getType() == LogRecordView::Measurement) {
+        _statistics.addRecord(view.getLogRecord());
+    } else if (view.getType() == LogRecordView::Error) {
+        _statistics.addError(view.getError());
+    }
+}
+
+
+bool LogSystem::hasSessionIndexArea() const
+{
+    if (isAppendOnly()) {
+        return _sessionIndexArea.isEnabled(); // The index is appended.
+    }
+    return _reservedForConfig >= CONFIG_SESSION_INDEX_OFFSET + CONFIG_SESSION_INDEX_SIZE;
+}
+
+
+bool LogSystem::loadSessionIndex(InternalSessionIndex *index) const
+{
+    if (_sessionIndexArea.isEnabled()) {
+        return _sessionIndexArea.read(reinterpret_cast<uint8_t*>(index));
+    }
+    if (!hasSessionIndexArea()) {
+        return false;
+    }
+    _storage->readBytes(CONFIG_SESSION_INDEX_OFFSET, reinterpret_cast<uint8_t*>(index), sizeof(InternalSessionIndex));
+    return true;
+}
+
+
+void LogSystem::readSessionIndex()
+{
+    _isSessionIndexValid = false;
+    _sessionCount = 0;
+    _bootCount = 0;
+    InternalSessionIndex index;
+    if (!loadSessionIndex(&index)) {
+        return;
+    }
+    if (index.crc != getCRC(&index, offsetof(InternalSessionIndex, crc)) || index.sequenceBase != _sequenceBase) {
+        return; // Rebuild the index if it is used.
+    }
+    if (index.sessionCount > 0) {
+        // The latest session has to exist, otherwise the last update was interrupted.
+        // A session record which was overwritten in the ring can not be checked.
+        const uint32_t recordNumber = index.sessionStart[(index.sessionCount - 1) % LOG_SESSION_INDEX_SIZE];
+        if (recordNumber >= totalNumberOfRecords()) {
+            return;
+        }
+        if (recordNumber >= _firstRecord) {
+            const LogSession logSession = getSessionAtRecord(recordNumber - _firstRecord);
+            InternalSessionLinkData link;
+            if (logSession.isNull() || logSession.getBootCount() != index.bootCount ||
+                !readSessionLink(recordNumber, link) || link.session != index.sessionCount - 1) {
+                return;
+            }
+        }
+        _lastSessionRecord = recordNumber;
+    }
+    _sessionCount = index.sessionCount;
+    _bootCount = index.bootCount;
+    _isSessionIndexValid = true;
+}
+
+
+void LogSystem::rebuildSessionIndex()
+{
+    InternalSessionIndex index;
+    memset(&index, 0, sizeof(InternalSessionIndex));
+    // Keep the boot count of a valid index from before the last format.
+    if (loadSessionIndex(&index) && index.crc != getCRC(&index, offsetof(InternalSessionIndex, crc))) {
+        index.bootCount = 0;
+    }
+    _bootCount = index.bootCount;
+    _sessionCount = 0;
+    _lastSessionRecord = 0;
+    for (const LogRecordView &view : getRecords()) {
+        if (view.getType() == LogRecordView::Session) {
+            const LogSession logSession = view.getSession();
+            // The link keeps the numbers of the sessions, even if older sessions
+            // were overwritten. A session without a valid link has no number.
+            const uint32_t recordNumber = getRecordNumber(view.getIndex());
+            InternalSessionLinkData link;
+            if (readSessionLink(recordNumber, link)) {
+                index.sessionStart[link.session % LOG_SESSION_INDEX_SIZE] = recordNumber;
+                _sessionCount = link.session + 1;
+                _lastSessionRecord = recordNumber;
+            }
+            if (logSession.getBootCount() > _bootCount) {
+                _bootCount = logSession.getBootCount();
+            }
+        }
+    }
+    index.bootCount = _bootCount;
+    index.sessionCount = _sessionCount;
+    writeSessionIndex(&index);
+    _isSessionIndexValid = true;
+}
+
+
+void LogSystem::writeSessionIndex(InternalSessionIndex *index)
+{
+    if (!hasSessionIndexArea()) {
+        return;
+    }
+    index->sequenceBase = _sequenceBase;
+    index->crc = getCRC(index, offsetof(InternalSessionIndex, crc));
+    if (_sessionIndexArea.isEnabled()) {
+        _sessionIndexArea.write(reinterpret_cast<const uint8_t*>(index));
+        return;
+    }
+    _storage->writeBytes(CONFIG_SESSION_INDEX_OFFSET, reinterpret_cast<const uint8_t*>(index), sizeof(InternalSessionIndex));
+}
+
 
 
 
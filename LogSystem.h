@@ -20,25 +20,113 @@
 //
 
 
+#include "CheckpointArea.h"
+#include "ConfigStore.h"
+#include "RecordSchema.h"
+#include "Storage.h"
+
 #include <Arduino.h>
 #include <RTClib.h>
 
 
-class Storage;
+struct InternalSessionIndex;
+struct InternalSessionLinkData;
+class LogSystem;
+
+
+/// The number of appended records after which the statistics are checkpointed.
+///
+/// On a SD card, each checkpoint writes the block with the configuration
+/// area and the block with the end of the log again. A ring with less
+/// than four times this number of records is checkpointed more often.
+///
+#ifdef LR_STORAGE_BLOCK
+#define LR_LOG_STATISTICS_CHECKPOINT_INTERVAL 256
+#else
+#define LR_LOG_STATISTICS_CHECKPOINT_INTERVAL 16
+#endif
+
+
+/// The number of appended records after which the end of the log is stored.
+///
+/// The end is kept in the config store, so `begin()` does not have to scan
+/// the whole ring. On a SD card, each update writes the block with the
+/// configuration area again. The same interval applies to the rollups of
+/// each tier.
+///
+#ifdef LR_STORAGE_BLOCK
+#define LR_LOG_END_STORE_INTERVAL 256
+#else
+#define LR_LOG_END_STORE_INTERVAL 1
+#endif
+
+
+/// The part of the log area used for the hourly rollups, as divisor.
+///
+/// With 4, a quarter of the log area is used for the hourly rollups.
+/// On a storage which has to be erased, like a flash chip, there are no
+/// rollups, and the records use the whole log area.
+///
+#define LR_LOG_HOURLY_TIER_PART 4
+
+/// The maximum number of hourly rollups, which is one year.
+///
+#define LR_LOG_HOURLY_TIER_MAXIMUM 8784
+
+/// The part of the log area used for the daily rollups, as divisor.
+///
+#define LR_LOG_DAILY_TIER_PART 8
+
+/// The maximum number of daily rollups, which is ten years.
+///
+#define LR_LOG_DAILY_TIER_MAXIMUM 3660
+
+
+/// The number of records a log cursor reads at once.
+///
+/// The records are buffered in the cursor. The host tools, which work
+/// with an image in memory, read larger blocks.
+///
+#ifdef LR_STORAGE_IMAGE
+#define LR_LOG_CURSOR_READ_AHEAD 64
+#else
+#define LR_LOG_CURSOR_READ_AHEAD 4
+#endif
 
 
 /// A single log record.
 ///
+/// The values of the record are declared by `LogRecordSchema`.
+///
 class LogRecord
 {
+public:
+    /// The maximum length of a record as text, including the line break.
+    ///
+    static const uint8_t MaximumTextLength = 19 + LogRecordSchema::MaximumTextLength + 2;
+    
 public:
     /// Create a new log record using the given values.
     ///
+    /// All values are fixed point numbers in the units of their channel.
+    /// Values out of range are clamped.
+    ///
+    /// @param dateTime The time of the record.
+    /// @param values The values for all channels of `LogRecordSchema`.
+    ///
+    LogRecord(const DateTime &dateTime, const int16_t *values);
+    
+    /// Create a new log record using the given values.
+    ///
+    /// All values are fixed point numbers with one decimal place, as they
+    /// are delivered by the sensor. Values out of range are clamped.
+    /// Additional channels of the schema are set to zero.
+    ///
     /// @param dateTime The time of the record.
-    /// @param temperature The temperature in celsius.
-    /// @param humidity The humidity as percentage 0-100.
+    /// @param temperature The temperature in 1/10 celsius.
+    /// @param humidity The humidity in 1/10 percent, 0-1000.
     ///
-    LogRecord(const DateTime &dateTime, float temperature, float humidity);
+    LogRecord(const DateTime &dateTime, int16_t temperature, int16_t humidity);
 
     /// Create a special null record.
     ///
@@ -59,37 +147,602 @@ public:
     ///
     inline DateTime getDateTime() const { return _dateTime; }
     
-    /// Get the temperature of the record in celsius.
+    /// Get the value of a channel in its fixed point units.
     ///
-    inline float getTemperature() const { return _temperature; }
+    inline int16_t getValue(uint8_t channel) const { return _values[channel]; }
     
-    /// Get the humidity of the record in percent 0-100.
+    /// Get the values of all channels.
     ///
-    inline float getHumidity() const { return _humidity; }
+    inline const int16_t* getValues() const { return _values; }
+    
+    /// Get the temperature of the record in 1/10 celsius.
+    ///
+    inline int16_t getTemperature() const { return _values[LogChannelTemperature]; }
+    
+    /// Get the humidity of the record in 1/10 percent, 0-1000.
+    ///
+    inline int16_t getHumidity() const { return _values[LogChannelHumidity]; }
     
     /// Write this record to the serial interface.
     ///
-    /// The format is: date/time, temperature, humidity
-    /// Example: 2015-08-22 12:42:21,80,25
+    /// The format is: date/time, followed by the values of all channels.
+    /// Example: 2015-08-22 12:42:21,21.5,45.0
     ///
     void writeToSerial() const;
     
 private:
     DateTime _dateTime;
-    float _temperature;
-    float _humidity;
+    int16_t _values[LogRecordSchema::ChannelCount];
+};
+
+
+/// A logging session.
+///
+/// Each time the logger starts logging, a session record is written
+/// in front of the records of the session.
+///
+class LogSession
+{
+public:
+    /// Create a new session.
+    ///
+    /// @param recordIndex The index of the session record in the log.
+    /// @param startTime The time the session started.
+    /// @param interval The interval of the session in seconds.
+    /// @param bootCount The number of times the logger started logging.
+    ///
+    LogSession(uint32_t recordIndex, const DateTime &startTime, uint32_t interval, uint16_t bootCount);
+    
+    /// Create a null session.
+    ///
+    LogSession();
+    
+    /// dtor
+    ///
+    ~LogSession();
+    
+public:
+    /// Check if this is a null session.
+    ///
+    inline bool isNull() const { return _interval == 0; }
+    
+    /// Get the index of the session record in the log.
+    ///
+    /// The records of the session follow the session record.
+    ///
+    inline uint32_t getRecordIndex() const { return _recordIndex; }
+    
+    /// Get the time the session started.
+    ///
+    inline DateTime getStartTime() const { return _startTime; }
+    
+    /// Get the interval of the session in seconds.
+    ///
+    inline uint32_t getInterval() const { return _interval; }
+    
+    /// Get the number of times the logger started logging.
+    ///
+    inline uint16_t getBootCount() const { return _bootCount; }
+    
+    /// Write this session to the serial interface.
+    ///
+    /// Example: Session start 2015-08-22 12:42:21 interval 600s boot 7
+    ///
+    void writeToSerial() const;
+    
+private:
+    uint32_t _recordIndex;
+    DateTime _startTime;
+    uint32_t _interval;
+    uint16_t _bootCount;
+};
+
+
+/// An error while logging.
+///
+/// If the sensor could not be read, an error record is written in
+/// place of the measurement, and logging continues.
+///
+class LogError
+{
+public:
+    /// The error codes.
+    ///
+    enum Code : uint8_t {
+        SensorTimeout = 0, ///< The sensor did not answer.
+        SensorChecksum = 1 ///< The data from the sensor did not match the checksum.
+    };
+    
+    /// The number of error codes.
+    ///
+    static const uint8_t CodeCount = 2;
+    
+public:
+    /// Create a new error.
+    ///
+    /// @param dateTime The time of the error.
+    /// @param code The error code.
+    /// @param attempts The number of failed attempts.
+    ///
+    LogError(const DateTime &dateTime, Code code, uint8_t attempts);
+    
+    /// Create a null error.
+    ///
+    LogError();
+    
+    /// dtor
+    ///
+    ~LogError();
+    
+public:
+    /// Check if this is a null error.
+    ///
+    inline bool isNull() const { return _attempts == 0; }
+    
+    /// Get the time of the error.
+    ///
+    inline DateTime getDateTime() const { return _dateTime; }
+    
+    /// Get the error code.
+    ///
+    inline Code getCode() const { return _code; }
+    
+    /// Get the number of failed attempts.
+    ///
+    inline uint8_t getAttempts() const { return _attempts; }
+    
+    /// Write this error to the serial interface.
+    ///
+    /// Example: Sensor error 2015-08-22 12:42:21 timeout attempts 3
+    ///
+    void writeToSerial() const;
+    
+private:
+    DateTime _dateTime;
+    Code _code;
+    uint8_t _attempts;
+};
+
+
+/// The minimum, mean and maximum of the values in one period.
+///
+/// The log system rolls the records up into hourly rollups, and the
+/// hourly rollups into daily rollups. A daily rollup uses the mean of
+/// each hour as the value of all records of the hour.
+///
+class LogRollup
+{
+public:
+    /// The tiers of rollups, with the length of their period.
+    ///
+    enum Tier : uint8_t {
+        Hourly = 0, ///< One rollup for each hour.
+        Daily = 1 ///< One rollup for each day.
+    };
+    
+    /// The number of tiers.
+    ///
+    static const uint8_t TierCount = 2;
+    
+public:
+    /// Create an empty rollup of the given tier.
+    ///
+    /// The period starts with the first added record.
+    ///
+    LogRollup(Tier tier);
+    
+    /// Create a null rollup.
+    ///
+    LogRollup();
+    
+    /// dtor
+    ///
+    ~LogRollup();
+    
+public:
+    /// Check if this is a null rollup, without any records.
+    ///
+    inline bool isNull() const { return _count == 0; }
+    
+    /// Get the tier of the rollup.
+    ///
+    inline Tier getTier() const { return _tier; }
+    
+    /// Get the start of the period.
+    ///
+    inline DateTime getStartTime() const { return DateTime(_startTime); }
+    
+    /// Get the number of records in the period.
+    ///
+    inline uint32_t getCount() const { return _count; }
+    
+    /// Get the minimum of a channel in its fixed point units.
+    ///
+    inline int16_t getMinimum(uint8_t channel) const { return _minimum[channel]; }
+    
+    /// Get the rounded mean of a channel in its fixed point units.
+    ///
+    int16_t getMean(uint8_t channel) const;
+    
+    /// Get the maximum of a channel in its fixed point units.
+    ///
+    inline int16_t getMaximum(uint8_t channel) const { return _maximum[channel]; }
+    
+    /// Check if a time is in the period of this rollup.
+    ///
+    bool isInPeriod(uint32_t unixtime) const;
+    
+    /// Add a record to the rollup.
+    ///
+    void addRecord(const LogRecord &logRecord);
+    
+    /// Add a rollup of a shorter period.
+    ///
+    /// The mean of the rollup is used as value for all its records.
+    ///
+    void addRollup(const LogRollup &rollup);
+    
+    /// Write this rollup to the serial interface.
+    ///
+    /// The format is: start of the period, number of records, followed by
+    /// the minimum, mean and maximum of all channels.
+    /// Example: 2015-08-22 12:00:00,6,21.2,21.5,21.9,44.0,45.1,46.0
+    ///
+    void writeToSerial() const;
+    
+    /// Get the start of the period of a tier, which includes the given time.
+    ///
+    static uint32_t getPeriodStart(Tier tier, uint32_t unixtime);
+    
+private:
+    friend class LogSystem;
+    
+    Tier _tier;
+    uint32_t _startTime;
+    uint32_t _count;
+    int16_t _minimum[LogRecordSchema::ChannelCount];
+    int16_t _maximum[LogRecordSchema::ChannelCount];
+    int64_t _sum[LogRecordSchema::ChannelCount];
+};
+
+
+/// Running statistics for the values of the log.
+///
+/// The statistics keep exact integer sums of the values and their squares,
+/// the mean and standard deviation are calculated from them when read.
+///
+class LogStatistics
+{
+public:
+    /// The values with statistics, the channels of `LogRecordSchema`.
+    ///
+    enum Value {
+        Temperature = LogChannelTemperature,
+        Humidity = LogChannelHumidity
+    };
+    
+    /// The number of values.
+    ///
+    static const uint8_t ValueCount = LogRecordSchema::ChannelCount;
+    
+public:
+    /// Create empty statistics.
+    ///
+    LogStatistics();
+    
+    /// dtor
+    ///
+    ~LogStatistics();
+    
+public:
+    /// Remove all records from the statistics.
+    ///
+    void reset();
+    
+    /// Add a record to the statistics.
+    ///
+    void addRecord(const LogRecord &logRecord);
+    
+    /// Add an error to the statistics.
+    ///
+    void addError(const LogError &logError);
+    
+    /// Get the number of records in the statistics.
+    ///
+    inline uint32_t getCount() const { return _count; }
+    
+    /// Check if the statistics include all records since the format.
+    ///
+    /// The statistics are only partial, if they were rebuilt after the
+    /// ring overwrote records which were not in a checkpoint.
+    ///
+    inline bool isComplete() const { return _isComplete; }
+    
+    /// Get the number of errors with the given code.
+    ///
+    inline uint32_t getErrorCount(LogError::Code code) const { return _errorCount[code]; }
+    
+    /// Get the minimum of a value in the fixed point units of the channel.
+    ///
+    inline int16_t getMinimum(Value value) const { return _minimum[value]; }
+    
+    /// Get the time of the first record with the minimum of a value.
+    ///
+    inline DateTime getMinimumTime(Value value) const { return DateTime(_minimumTime[value]); }
+    
+    /// Get the maximum of a value in the fixed point units of the channel.
+    ///
+    inline int16_t getMaximum(Value value) const { return _maximum[value]; }
+    
+    /// Get the time of the first record with the maximum of a value.
+    ///
+    inline DateTime getMaximumTime(Value value) const { return DateTime(_maximumTime[value]); }
+    
+    /// Get the rounded mean of a value in the fixed point units of the channel.
+    ///
+    int16_t getMean(Value value) const;
+    
+    /// Get the rounded standard deviation of a value in the fixed point units of the channel.
+    ///
+    uint16_t getStandardDeviation(Value value) const;
+    
+    /// Write the statistics to the serial interface.
+    ///
+    void writeToSerial() const;
+    
+private:
+    friend class LogSystem;
+    
+    uint32_t _count;
+    bool _isComplete;
+    int16_t _minimum[ValueCount];
+    uint32_t _minimumTime[ValueCount];
+    int16_t _maximum[ValueCount];
+    uint32_t _maximumTime[ValueCount];
+    int64_t _sum[ValueCount];
+    uint64_t _sumOfSquares[ValueCount];
+    uint32_t _errorCount[LogError::CodeCount];
+};
+
+
+/// A view of a single record, as it is stored in the log.
+///
+/// The view keeps the raw record. The values are only decoded if they
+/// are requested, which makes a sequential scan of the log cheap.
+///
+class LogRecordView
+{
+public:
+    /// The types of records.
+    ///
+    enum Type : uint8_t {
+        Measurement, ///< A record with values.
+        Session, ///< A session record.
+        Error, ///< An error record.
+        SessionLink, ///< The link record behind a session record.
+        Corrupted ///< A record with an invalid CRC or sequence number.
+    };
+    
+    /// The size of a stored record in bytes.
+    ///
+    static const uint8_t RecordSize = 10 + 2 * (LogRecordSchema::ChannelCount < 2 ? 2 : LogRecordSchema::ChannelCount);
+    
+public:
+    /// Create a view of a corrupted record.
+    ///
+    LogRecordView();
+    
+    /// dtor
+    ///
+    ~LogRecordView();
+    
+public:
+    /// Get the type of the record.
+    ///
+    inline Type getType() const { return _type; }
+    
+    /// Get the index of the record in the log.
+    ///
+    inline uint32_t getIndex() const { return _index; }
+    
+    /// Check if this is a record with values.
+    ///
+    inline bool isMeasurement() const { return _type == Measurement; }
+    
+    /// Get the time of the record as unix timestamp.
+    ///
+    uint32_t getUnixtime() const;
+    
+    /// Get the time of the record.
+    ///
+    inline DateTime getDateTime() const { return DateTime(getUnixtime()); }
+    
+    /// Get the value of a channel in its fixed point units.
+    ///
+    /// Only valid for a measurement.
+    ///
+    int16_t getValue(uint8_t channel) const;
+    
+    /// Get the record.
+    ///
+    /// @return The record, or a null record if this is no measurement.
+    ///
+    LogRecord getLogRecord() const;
+    
+    /// Get the session.
+    ///
+    /// @return The session, or a null session if this is no session record.
+    ///
+    LogSession getSession() const;
+    
+    /// Get the error.
+    ///
+    /// @return The error, or a null error if this is no error record.
+    ///
+    LogError getError() const;
+    
+    /// Write the record, session or error to the serial interface.
+    ///
+    /// Nothing is written for a corrupted record.
+    ///
+    void writeToSerial() const;
+    
+private:
+    friend class LogCursor;
+    
+    uint8_t _data[RecordSize]; ///< The raw record.
+    uint32_t _index;
+    Type _type;
+};
+
+
+/// A cursor to read a range of records in order.
+///
+/// The cursor reads `LR_LOG_CURSOR_READ_AHEAD` records at once, and checks
+/// each record once, as it moves to it. Use it like this:
+///
+///     for (const LogRecordView &view : logSystem.getRecords()) {
+///         view.writeToSerial();
+///     }
+///
+/// The log must not be changed while a cursor is used.
+///
+class LogCursor
+{
+public:
+    /// The iterator for a range-based for loop.
+    ///
+    /// All iterators of a cursor move the cursor, the end is reached if
+    /// the cursor is at the end.
+    ///
+    class Iterator
+    {
+    public:
+        inline explicit Iterator(LogCursor *cursor) : _cursor(cursor) {}
+        inline const LogRecordView& operator*() const { return _cursor->getView(); }
+        inline Iterator& operator++() { _cursor->next(); return *this; }
+        inline bool operator!=(const Iterator&) const { return !_cursor->isAtEnd(); }
+        
+    private:
+        LogCursor *_cursor;
+    };
+    
+public:
+    /// Create a cursor at the first record of a range.
+    ///
+    /// @param logSystem The log system to read.
+    /// @param first The index of the first record.
+    /// @param end The index after the last record.
+    ///
+    LogCursor(const LogSystem *logSystem, uint32_t first, uint32_t end);
+    
+    /// dtor
+    ///
+    ~LogCursor();
+    
+public:
+    /// Check if the cursor is behind the last record of the range.
+    ///
+    inline bool isAtEnd() const { return _index >= _end; }
+    
+    /// Get the view of the current record.
+    ///
+    inline const LogRecordView& getView() const { return _view; }
+    
+    /// Move to the next record.
+    ///
+    void next();
+    
+    /// Get the iterator for a range-based for loop.
+    ///
+    inline Iterator begin() { return Iterator(this); }
+    
+    /// Get the end iterator for a range-based for loop.
+    ///
+    inline Iterator end() { return Iterator(this); }
+    
+private:
+    /// Read the current record into the view, and fill the buffer if necessary.
+    ///
+    void load();
+    
+private:
+    const LogSystem *_logSystem;
+    uint32_t _index; ///< The index of the current record.
+    uint32_t _end; ///< The index after the last record.
+    uint32_t _bufferIndex; ///< The index of the first record in the buffer.
+    uint8_t _bufferCount; ///< The number of records in the buffer.
+    uint8_t _buffer[LogRecordView::RecordSize * LR_LOG_CURSOR_READ_AHEAD]; ///< The raw records read ahead.
+    LogRecordView _view; ///< The view of the current record.
 };
 
 
 /// The log system to write and read all sensor data.
 ///
+/// The log area starts with a small header, followed by the records. Every
+/// record is protected with a CRC and carries a sequence number. A record
+/// is committed with a single write, the sequence numbers separate the
+/// current records from the ones written before the last format.
+///
+/// The records are written to a ring. If the ring is full, the oldest
+/// record is overwritten, and the index of all records moves by one.
+/// At the end of the log area are two more rings, with hourly and daily
+/// rollups of the measurements. The rollups are calculated on append,
+/// so a long deployment keeps the latest records, and the history of
+/// months in the rollups.
+///
+/// A failed measurement is written as an error record, the errors are
+/// counted in the statistics.
+///
+/// A session record is written each time logging starts. The latest
+/// sessions are indexed in the configuration area, so the start of a
+/// session is found without scanning the log.
+///
+/// The log system keeps statistics for all records since the format,
+/// including the records which were overwritten in the ring. They are
+/// checkpointed in the configuration area, if the reserved area is
+/// large enough, at least four times for each lap of the ring. If no
+/// checkpoint is valid, they are rebuilt from the records in the ring,
+/// and are marked as partial if the ring already overwrote records.
+///
+/// On a storage larger than `CONFIG_SMALL_STORAGE_SIZE`, the end of the
+/// records and of the rollups are kept in the config store of the
+/// configuration area. At start, the log is only read from the
+/// stored end on, as long as the last record before it is valid. Otherwise
+/// the whole ring is scanned.
+///
+/// On a storage which has to be erased, like a flash chip, no byte is
+/// written twice. The records are written to sectors which were erased
+/// ahead of the log. At the end of the storage, the ring continues with
+/// the first sector, and erasing it removes its oldest records. At start,
+/// the end of the log is found with a binary search. The statistics and
+/// the session index are appended to two `CheckpointArea`s behind the
+/// header, instead of the configuration area.
+///
+/// There are no hourly and daily rollups on a storage which has to be
+/// erased. Each tier would need its own ring of sectors with an erased
+/// gap, and its own search at start. The records use the whole log area
+/// instead, and can be aggregated on the host.
+///
 class LogSystem
 {
+public:
+    /// The partition of a storage into the rings.
+    ///
+    struct Layout
+    {
+        uint32_t recordCount; ///< The number of records in the ring of the records.
+        uint16_t rollupCount[LogRollup::TierCount]; ///< The number of rollups in the ring of each tier.
+        uint32_t recordStart; ///< The offset of the ring of the records.
+        uint32_t checkpointStart; ///< The offset of the checkpoint areas, on a storage which has to be erased.
+    };
+    
 public:
     /// Create a new log system instance.
     ///
     /// @param reservedForConfig The number of bytes reserved for the configuration
-    ///    at the start the storage area.
+    ///    at the start the storage area. On a small storage, this is limited to
+    ///    the size from `getConfigAreaSize()` by `begin()`.
     /// @param storage The storage to use for the log system.
     ///
     LogSystem(uint32_t reservedForConfig, Storage *storage);
@@ -101,42 +754,338 @@ public:
 public:
     /// Initialize the log system
     ///
+    /// This scans the storage for the end of the log and of the rollups,
+    /// from the ends in the config store on, if they are valid.
+    /// Corrupted records are skipped and do not end the log. On a storage
+    /// which has to be erased, a binary search finds the end of the log
+    /// at the erased records ahead of it, and the start of its oldest
+    /// records behind them.
+    /// The rollups of the current hour and day are restored from the
+    /// latest records.
+    ///
     void begin();
     
+    /// Get the partition of a storage into the rings.
+    ///
+    /// @param storageSize The size of the storage.
+    /// @param reservedForConfig The number of bytes reserved for the configuration.
+    /// @param eraseSize The size of an erase sector, or 0 if the storage does not have to be erased.
+    ///
+    static Layout getLayout(uint32_t storageSize, uint32_t reservedForConfig, uint32_t eraseSize);
+    
     /// Get the maximum number of records for the given storage.
     ///
     inline uint32_t maximumNumberOfRecords() const { return _maximumNumberOfRecords; }
     
     /// Get the number of records currently in the storage.
     ///
+    /// This includes corrupted records, which return a null record.
+    ///
     inline uint32_t currentNumberOfRecords() const { return _currentNumberOfRecords; }
     
+    /// Get the number of records written since the last format.
+    ///
+    /// This includes the records overwritten in the ring.
+    ///
+    inline uint32_t totalNumberOfRecords() const { return _firstRecord + _currentNumberOfRecords; }
+    
     /// Read a record from the storage.
     ///
+    /// To read many records in order, use a cursor from `getRecords()`.
+    ///
+    /// @return The record, or a null record if the record is corrupted
+    ///    or a session record.
+    ///
     LogRecord getLogRecord(uint32_t index) const;
     
+    /// Get a cursor for a range of records.
+    ///
+    /// @param first The index of the first record.
+    /// @param end The index after the last record.
+    ///
+    LogCursor getRecords(uint32_t first, uint32_t end) const;
+    
+    /// Get a cursor for all records.
+    ///
+    LogCursor getRecords() const;
+    
     /// Append a record to the storage.
     ///
-    /// This will first zero the record (index+1) if possible, before
-    /// writing the given record to (index).
+    /// The record is written with its sequence number in one single write.
+    /// An interrupted write leaves a record with an invalid CRC, which
+    /// is overwritten on the next append. On a storage which has to be
+    /// erased, the corrupted record is kept.
+    ///
+    /// If the record starts a new hour or day, the rollups of the last
+    /// period are written first.
     ///
     /// @param logRecord The record to append.
     /// @return true on success, false if the storage is full.
     ///
     bool appendRecord(const LogRecord &logRecord);
     
+    /// Append a number of records to the storage.
+    ///
+    /// The records are written in a few larger writes. If the storage has
+    /// no space for all records, no record is written. An interrupted write
+    /// keeps all records written before the interruption.
+    ///
+    /// @param logRecords The records to append, ordered by time.
+    /// @param count The number of records.
+    /// @return true on success, false if the storage is full.
+    ///
+    bool appendRecords(const LogRecord *logRecords, uint8_t count);
+    
+    /// Append an error record to the storage.
+    ///
+    /// The error record takes the place of the measurement which failed.
+    ///
+    /// @param logError The error to append.
+    /// @return true on success, false if the storage is full.
+    ///
+    bool appendError(const LogError &logError);
+    
+    /// Start a new session.
+    ///
+    /// This writes a session record and its link record, which are
+    /// followed by the records of the session.
+    ///
+    /// @param startTime The start time of the session.
+    /// @param interval The interval of the session in seconds.
+    /// @return true on success, false if the storage is full.
+    ///
+    bool appendSession(const DateTime &startTime, uint32_t interval);
+    
+    /// Get the number of sessions in the log.
+    ///
+    /// This includes the sessions with overwritten session records, if
+    /// the session index is used.
+    ///
+    uint16_t currentNumberOfSessions();
+    
+    /// Get a session.
+    ///
+    /// The session is found with the session index, and older sessions
+    /// by following the links from the oldest session in the index back.
+    /// The link record of each session stores its number, a session with
+    /// a different number, or a corrupted link, ends the search.
+    ///
+    /// @param session The number of the session, starting with 0.
+    /// @return The session, or a null session if there is no such session,
+    ///    or its session record was overwritten.
+    ///
+    LogSession getSession(uint16_t session);
+    
+    /// Get the index of the record after the last record of a session.
+    ///
+    uint32_t getSessionEnd(uint16_t session);
+    
+    /// Read the session record at the given index.
+    ///
+    /// @return The session, or a null session if there is no session record.
+    ///
+    LogSession getSessionAtRecord(uint32_t index) const;
+    
+    /// Read the error record at the given index.
+    ///
+    /// @return The error, or a null error if there is no error record.
+    ///
+    LogError getErrorAtRecord(uint32_t index) const;
+    
+    /// Get the statistics for all records.
+    ///
+    /// The statistics include the number of errors for each code, and the
+    /// records overwritten in the ring. If there was no valid checkpoint,
+    /// the statistics are rebuilt from the records in the storage on the
+    /// first call.
+    ///
+    const LogStatistics& getStatistics();
+    
+    /// Get the maximum number of rollups of a tier for the given storage.
+    ///
+    /// This is 0 on a storage which has to be erased, which has no rollups.
+    ///
+    inline uint16_t maximumNumberOfRollups(LogRollup::Tier tier) const { return _maximumNumberOfRollups[tier]; }
+    
+    /// Get the number of rollups of a tier currently in the storage.
+    ///
+    /// This includes corrupted rollups, which return a null rollup.
+    ///
+    uint16_t currentNumberOfRollups(LogRollup::Tier tier) const;
+    
+    /// Read a rollup from the storage.
+    ///
+    /// @param tier The tier of the rollup.
+    /// @param index The index of the rollup, starting with the oldest one.
+    /// @return The rollup, or a null rollup if the rollup is corrupted.
+    ///
+    LogRollup getRollup(LogRollup::Tier tier, uint32_t index) const;
+    
+    /// Get the rollup of the current period, which is not written yet.
+    ///
+    /// On a storage which has to be erased, this is always a null rollup.
+    ///
+    /// @return The rollup, or a null rollup if there are no records in the current period.
+    ///
+    LogRollup getCurrentRollup(LogRollup::Tier tier) const;
+    
     /// Format the storage.
     ///
-    /// This will set the initial two records of the storage area to zero.
-    /// It is enough to initialize the storage with minimum number of writes.
+    /// This writes a new header which starts a new sequence. All existing
+    /// records and rollups are ignored from now on, without erasing them. On a storage
+    /// which has to be erased, the sector of the header and the sectors for
+    /// the first record are erased.
     ///
     void format();
     
+    /// Erase the storage ahead of the log.
+    ///
+    /// Call this while the logger is idle, so appending records rarely has
+    /// to wait for an erase. Erases at most one sector per call, and does
+    /// nothing on storages which can be overwritten.
+    ///
+    /// @return true if a sector was erased.
+    ///
+    bool eraseAhead();
+    
+private:
+    friend class LogCursor;
+    
+    /// Check if the storage has to be erased before it is written.
+    ///
+    bool isAppendOnly() const;
+    
+    /// Erase the sectors behind the erased area of the ring, up to the given position.
+    ///
+    /// The records in the erased sectors are removed from the start of the log.
+    ///
+    /// @param end The position in the ring, see `getRecordEnd()`.
+    ///
+    void eraseUntil(uint32_t end);
+    
+    /// Get the end of a record, as position in the ring which grows with each lap.
+    ///
+    /// The position of a record with the number `n` since the format is
+    /// `n / capacity` times the size of the ring in whole erase sectors,
+    /// plus the end of its slot.
+    ///
+    uint32_t getRecordEnd(uint32_t number) const;
+    
+    /// Check if the given number of records can be appended.
+    ///
+    bool hasSpaceFor(uint8_t count) const;
+    
+    /// Count records as written, and move the start of the ring behind the overwritten ones.
+    ///
+    void addWrittenRecords(uint8_t count);
+    
+    /// Get the number of a record since the format, which is read with the given index.
+    ///
+    inline uint32_t getRecordNumber(uint32_t index) const { return _firstRecord + index; }
+    
+    /// Get the slot in the ring for the record with the given number since the format.
+    ///
+    inline uint32_t getRecordSlot(uint32_t number) const { return number % _maximumNumberOfRecords; }
+    
+    /// Get the start of the ring of a tier in the storage.
+    ///
+    uint32_t getRollupStart(LogRollup::Tier tier) const;
+    
+    /// Add a record to the rollups, and write the rollups of the periods which ended before it.
+    ///
+    void addToRollups(const LogRecord &logRecord);
+    
+    /// Write a rollup at the end of the ring of its tier.
+    ///
+    void writeRollup(const LogRollup &rollup);
+    
+    /// Restore the rollups of the current periods from the records and the hourly rollups.
+    ///
+    void restoreCurrentRollups();
+    
+
+    /// Check if the reserved area is large enough for the config store.
+    ///
+    bool hasConfigStoreArea() const;
+    
+    /// Check if there is an area for the statistics checkpoints.
+    ///
+    bool hasStatisticsArea() const;
+    
+    /// Read the latest valid statistics checkpoint and add the records after it.
+    ///
+    void readStatistics();
+    
+    /// Write a statistics checkpoint.
+    ///
+    void writeStatistics();
+    
+    /// Write a statistics checkpoint, if enough records were appended since the last one.
+    ///
+    void checkpointStatistics();
+    
+    /// Rebuild the statistics from all records in the ring.
+    ///
+    void rebuildStatistics();
+    
+    /// Add a record to the statistics, if it is a measurement or an error.
+    ///
+    void addToStatistics(const LogRecordView &view);
+    
+    /// Check if there is an area for the session index.
+    ///
+    bool hasSessionIndexArea() const;
+    
+    /// Read the link record behind a session record.
+    ///
+    /// @param number The number of the session record since the format.
+    /// @param link The link data, if the link record is valid.
+    /// @return true if there is a valid link record.
+    ///
+    bool readSessionLink(uint32_t number, InternalSessionLinkData &link) const;
+    
+    /// Read the session index from the configuration area, or its checkpoint area.
+    ///
+    /// @param index The buffer for the index.
+    /// @return false if there is no index.
+    ///
+    bool loadSessionIndex(InternalSessionIndex *index) const;
+    
+    /// Read and check the session index.
+    ///
+    void readSessionIndex();
+    
+    /// Rebuild the session index from all records.
+    ///
+    void rebuildSessionIndex();
+    
+    /// Set the CRC of the session index and write it.
+    ///
+    void writeSessionIndex(InternalSessionIndex *index);
+    
 private:
     uint32_t _reservedForConfig;
     Storage *_storage;
+    uint32_t _firstRecord; ///< The number of the first record in the ring since the format.
     uint32_t _currentNumberOfRecords;
     uint32_t _maximumNumberOfRecords;
+    uint32_t _sequenceBase;
+    LogStatistics _statistics; ///< The statistics for all records.
+    bool _isStatisticsValid; ///< If the statistics include all records in the ring.
+    uint32_t _statisticsRecordCount; ///< The number of records since the format in the last checkpoint.
+    uint8_t _statisticsSlot; ///< The slot for the next checkpoint.
+    bool _isSessionIndexValid; ///< If the session index includes all sessions.
+    uint16_t _sessionCount; ///< The number of sessions in the log.
+    uint32_t _lastSessionRecord; ///< The number of the record of the latest session since the format.
+    uint16_t _bootCount; ///< The number of times the logger started logging.
+    uint32_t _erasedEnd; ///< The end of the erased area behind the log as position in the ring, if the storage has to be erased.
+    uint16_t _maximumNumberOfRollups[LogRollup::TierCount]; ///< The size of the ring of each tier.
+    uint32_t _rollupEnd[LogRollup::TierCount]; ///< The number of rollups of each tier since the format.
+    LogRollup _currentRollup[LogRollup::TierCount]; ///< The rollups of the current periods.
+    ConfigStore _configStore; ///< The store for the ends of the rings.
+    uint32_t _recordStart; ///< The offset of the ring of the records.
+    CheckpointArea _statisticsArea; ///< The statistics checkpoints, if the storage has to be erased.
+    CheckpointArea _sessionIndexArea; ///< The session index, if the storage has to be erased.
 };
 
 
@@ -22,6 +22,7 @@
 
 
 ModeSelector::ModeSelector()
+    : _selectedValue(0)
 {
 }
 
@@ -34,6 +35,64 @@ ModeSelector::~ModeSelector()
 namespace {
     
     
+// The number of selector codes, from the four pins of the BCD DIL.
+const uint8_t SELECTOR_CODE_COUNT = 16;
+
+// Flags for the selector codes.
+const uint8_t FLAG_ADAPTIVE = 0x01; // The interval adapts to the rate of change.
+const uint8_t FLAG_BURST = 0x02; // Events are captured in bursts.
+
+// The texts of the intervals.
+const char TEXT_NONE[] PROGMEM = "Unknown";
+const char TEXT_10S[] PROGMEM = "10s";
+const char TEXT_30S[] PROGMEM = "30s";
+const char TEXT_1M[] PROGMEM = "1m";
+const char TEXT_10M[] PROGMEM = "10m";
+const char TEXT_1H[] PROGMEM = "1h";
+const char TEXT_4H[] PROGMEM = "4h";
+const char TEXT_8H[] PROGMEM = "8h";
+const char TEXT_24H[] PROGMEM = "24h";
+const char TEXT_ADAPTIVE_10M[] PROGMEM = "adaptive up to 10m";
+const char TEXT_ADAPTIVE_1H[] PROGMEM = "adaptive up to 1h";
+const char TEXT_ADAPTIVE_24H[] PROGMEM = "adaptive up to 24h";
+const char TEXT_BURST_10M[] PROGMEM = "10m with bursts";
+const char TEXT_BURST_1H[] PROGMEM = "1h with bursts";
+
+    
+// The definition of one selector code.
+struct ModeDefinition
+{
+    uint8_t mode; // The ModeSelector::Mode.
+    uint8_t flags; // The flags for the code.
+    uint32_t interval; // The interval in seconds.
+    const char *text; // The interval as text, in flash memory.
+};
+
+    
+// The definitions of all selector codes, indexed by the code.
+const ModeDefinition MODE_DEFINITIONS[] PROGMEM = {
+    {ModeSelector::Log, 0, 10, TEXT_10S}, // 0
+    {ModeSelector::Log, 0, 30, TEXT_30S}, // 1
+    {ModeSelector::Log, 0, 60, TEXT_1M}, // 2
+    {ModeSelector::Log, 0, 600, TEXT_10M}, // 3
+    {ModeSelector::Log, 0, 3600, TEXT_1H}, // 4
+    {ModeSelector::Log, 0, 14400, TEXT_4H}, // 5
+    {ModeSelector::Log, 0, 28800, TEXT_8H}, // 6
+    {ModeSelector::Log, 0, 86400, TEXT_24H}, // 7
+    {ModeSelector::Read, 0, 10, TEXT_NONE}, // 8
+    {ModeSelector::Format, 0, 10, TEXT_NONE}, // 9
+    {ModeSelector::Command, 0, 10, TEXT_NONE}, // 10
+    {ModeSelector::Log, FLAG_ADAPTIVE, 600, TEXT_ADAPTIVE_10M}, // 11
+    {ModeSelector::Log, FLAG_ADAPTIVE, 3600, TEXT_ADAPTIVE_1H}, // 12
+    {ModeSelector::Log, FLAG_ADAPTIVE, 86400, TEXT_ADAPTIVE_24H}, // 13
+    {ModeSelector::Log, FLAG_BURST, 600, TEXT_BURST_10M}, // 14
+    {ModeSelector::Log, FLAG_BURST, 3600, TEXT_BURST_1H}, // 15
+};
+
+static_assert(sizeof(MODE_DEFINITIONS) / sizeof(ModeDefinition) == SELECTOR_CODE_COUNT,
+    "There has to be one definition for each selector code.");
+
+    
 uint8_t getSelectedValue()
 {
     uint8_t result = 0;
@@ -51,6 +110,15 @@ uint8_t getSelectedValue()
     }
     return result;
 }
+
+    
+// Read the definition of a selector code from flash memory.
+inline ModeDefinition getDefinition(uint8_t value)
+{
+    ModeDefinition definition;
+    memcpy_P(&definition, &MODE_DEFINITIONS[value], sizeof(ModeDefinition));
+    return definition;
+}
     
     
 }
@@ -69,47 +137,31 @@ void ModeSelector::begin()
 
 ModeSelector::Mode ModeSelector::getMode()
 {
-    if (_selectedValue < 8) {
-        return Log;
-    } else if (_selectedValue == 8) {
-        return Read;
-    } else if (_selectedValue == 9) {
-        return Format;
-    } else {
-        return Read; // This should never happen.
-    }
+    return static_cast<Mode>(getDefinition(_selectedValue).mode);
 }
 
 
 uint32_t ModeSelector::getInterval()
 {
-    switch (_selectedValue) {
-        case 0: return 10; // 10s
-        case 1: return 30; // 30s
-        case 2: return 60; // 1m
-        case 3: return 600; // 10m
-        case 4: return 3600; // 1h
-        case 5: return 14400; // 4h
-        case 6: return 28800; // 8h
-        case 7: return 86400; // 24h
-        default: return 10;
-    }
+    return getDefinition(_selectedValue).interval;
 }
 
 
-String ModeSelector::getIntervalText()
+bool ModeSelector::isAdaptive()
 {
-    switch (_selectedValue) {
-        case 0: return String(F("10s"));
-        case 1: return String(F("30s"));
-        case 2: return String(F("1m"));
-        case 3: return String(F("10m"));
-        case 4: return String(F("1h"));
-        case 5: return String(F("4h"));
-        case 6: return String(F("8h"));
-        case 7: return String(F("24h"));
-        default: return String(F("Unknown"));
-    }
+    return (getDefinition(_selectedValue).flags & FLAG_ADAPTIVE) != 0;
+}
+
+
+bool ModeSelector::isBurst()
+{
+    return (getDefinition(_selectedValue).flags & FLAG_BURST) != 0;
+}
+
+
+const __FlashStringHelper* ModeSelector::getIntervalText()
+{
+    return reinterpret_cast<const __FlashStringHelper*>(getDefinition(_selectedValue).text);
 }
 
 
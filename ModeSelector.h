@@ -44,6 +44,15 @@
 /// 7 = Log values - 24h interval.
 /// 8 = Read records and send them to serial.
 /// 9 = Format storage. All data will be lost.
+/// 10 = Wait for commands from serial.
+/// 11 = Log values - adaptive interval, up to 10m.
+/// 12 = Log values - adaptive interval, up to 1h.
+/// 13 = Log values - adaptive interval, up to 24h.
+/// 14 = Log values - 10m interval, with bursts on events.
+/// 15 = Log values -  1h interval, with bursts on events.
+///
+/// The codes are defined in a table in flash memory, which has
+/// an entry for each of the 16 codes.
 ///
 class ModeSelector
 {
@@ -51,7 +60,8 @@ public:
     enum Mode {
         Log,
         Read,
-        Format
+        Format,
+        Command
     };
     
 public:
@@ -74,11 +84,23 @@ public:
     
     /// Get the selected interval in seconds.
     ///
+    /// For an adaptive interval, this is the longest interval.
+    ///
     uint32_t getInterval();
     
+    /// Check if the interval adapts to the rate of change.
+    ///
+    bool isAdaptive();
+    
+    /// Check if events are captured in bursts.
+    ///
+    bool isBurst();
+    
     /// Get the selected interval as text.
     ///
-    String getIntervalText();
+    /// @return The text in flash memory, to use with `Serial.print()`.
+    ///
+    const __FlashStringHelper* getIntervalText();
     
 private:
     uint8_t _selectedValue;
@@ -0,0 +1,170 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "PhaseTrace.h"
+
+
+#ifdef LR_PHASE_TRACE
+
+
+#include <util/crc16.h>
+
+
+// Anonymous namespace to avoid conflicts.
+namespace {
+    
+
+#ifdef LR_PHASE_TRACE_PERSIST
+// The persisted trace starts with the number of entries since the start,
+// followed by the entries, oldest first, and the CRC-16 of both.
+const uint32_t TRACE_ENTRIES_OFFSET = CONFIG_PHASE_TRACE_OFFSET + sizeof(uint32_t);
+const uint32_t TRACE_CRC_OFFSET = TRACE_ENTRIES_OFFSET + sizeof(PhaseTrace::Entry) * LR_PHASE_TRACE_SIZE;
+
+static_assert(TRACE_CRC_OFFSET + sizeof(uint16_t) <= CONFIG_PHASE_TRACE_OFFSET + CONFIG_PHASE_TRACE_SIZE, "The phase trace does not fit.");
+
+    
+// Update a CRC-16 with a block of data.
+//
+uint16_t updateCRC(uint16_t crc, const void *data, uint16_t size)
+{
+    const uint8_t *dataPtr = reinterpret_cast<const uint8_t*>(data);
+    for (uint16_t i = 0; i < size; ++i) {
+        crc = _crc16_update(crc, dataPtr[i]);
+    }
+    return crc;
+}
+#endif
+
+    
+}
+
+
+PhaseTrace::PhaseTrace(Storage *storage)
+    : _storage(storage), _next(0), _count(0), _totalCount(0)
+#ifdef LR_PHASE_TRACE_OUTPUT
+    , _unsentCount(0)
+#endif
+{
+}
+
+
+PhaseTrace::~PhaseTrace()
+{
+}
+
+
+void PhaseTrace::add(Phase phase, uint32_t start, uint16_t value)
+{
+    Entry &entry = _entries[_next];
+    entry.start = start;
+    entry.end = micros();
+    entry.value = value;
+    entry.phase = phase;
+    ++_totalCount;
+    if (_count < LR_PHASE_TRACE_SIZE) {
+        ++_count;
+    }
+#ifdef LR_PHASE_TRACE_OUTPUT
+    if (_unsentCount < LR_PHASE_TRACE_SIZE) {
+        ++_unsentCount;
+    }
+#endif
+    if (++_next >= LR_PHASE_TRACE_SIZE) {
+        _next = 0;
+#ifdef LR_PHASE_TRACE_PERSIST
+        // The ring is full and in order, write it at once.
+        const uint32_t persistStart = micros();
+        persist();
+        add(Persist, persistStart, sizeof(uint32_t) + sizeof(_entries) + sizeof(uint16_t));
+#endif
+    }
+}
+
+
+#ifdef LR_PHASE_TRACE_OUTPUT
+void PhaseTrace::writeUnsentEntryToSerial()
+{
+    if (_unsentCount == 0) {
+        return;
+    }
+    writeEntryToSerial(_entries[(_next + LR_PHASE_TRACE_SIZE - _unsentCount) % LR_PHASE_TRACE_SIZE]);
+    --_unsentCount;
+}
+#endif
+
+
+void PhaseTrace::writeEntryToSerial(const Entry &entry)
+{
+    Serial.print(F("Trace "));
+    switch (entry.phase) {
+        case Clock: Serial.print(F("clock")); break;
+        case Sensor: Serial.print(F("sensor")); break;
+        case Write: Serial.print(F("write")); break;
+        case Sleep: Serial.print(F("sleep")); break;
+        case Persist: Serial.print(F("persist")); break;
+        default: Serial.print(F("output")); break;
+    }
+    Serial.print(' ');
+    Serial.print(entry.start);
+    Serial.print(' ');
+    Serial.print(entry.end - entry.start);
+    Serial.print(' ');
+    Serial.println(entry.value);
+}
+
+
+#ifdef LR_PHASE_TRACE_PERSIST
+void PhaseTrace::writePersistedToSerial() const
+{
+    uint32_t totalCount;
+    _storage->readBytes(CONFIG_PHASE_TRACE_OFFSET, reinterpret_cast<uint8_t*>(&totalCount), sizeof(uint32_t));
+    uint16_t crc = updateCRC(0xffff, &totalCount, sizeof(uint32_t));
+    for (uint8_t i = 0; i < LR_PHASE_TRACE_SIZE; ++i) {
+        Entry entry;
+        _storage->readBytes(TRACE_ENTRIES_OFFSET + sizeof(Entry) * i, reinterpret_cast<uint8_t*>(&entry), sizeof(Entry));
+        crc = updateCRC(crc, &entry, sizeof(Entry));
+    }
+    uint16_t storedCRC;
+    _storage->readBytes(TRACE_CRC_OFFSET, reinterpret_cast<uint8_t*>(&storedCRC), sizeof(uint16_t));
+    if (crc != storedCRC) {
+        Serial.println(F("No persisted trace."));
+        return;
+    }
+    Serial.print(F("Persisted trace, entries since start: "));
+    Serial.println(totalCount);
+    for (uint8_t i = 0; i < LR_PHASE_TRACE_SIZE; ++i) {
+        Entry entry;
+        _storage->readBytes(TRACE_ENTRIES_OFFSET + sizeof(Entry) * i, reinterpret_cast<uint8_t*>(&entry), sizeof(Entry));
+        writeEntryToSerial(entry);
+    }
+}
+
+
+void PhaseTrace::persist()
+{
+    uint16_t crc = updateCRC(0xffff, &_totalCount, sizeof(uint32_t));
+    crc = updateCRC(crc, _entries, sizeof(_entries));
+    _storage->writeBytes(CONFIG_PHASE_TRACE_OFFSET, reinterpret_cast<const uint8_t*>(&_totalCount), sizeof(uint32_t));
+    _storage->writeBytes(TRACE_ENTRIES_OFFSET, reinterpret_cast<const uint8_t*>(_entries), sizeof(_entries));
+    _storage->writeBytes(TRACE_CRC_OFFSET, reinterpret_cast<const uint8_t*>(&crc), sizeof(uint16_t));
+}
+#endif
+
+
+#endif
@@ -0,0 +1,170 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "ConfigArea.h"
+#include "Storage.h"
+
+#include <Arduino.h>
+
+
+// Uncomment to trace the time of the phases of each sample.
+//#define LR_PHASE_TRACE
+
+/// The number of entries in the trace ring.
+///
+#define LR_PHASE_TRACE_SIZE 16
+
+
+#if defined(LR_PHASE_TRACE_PERSIST) && !defined(LR_PHASE_TRACE)
+#error "LR_PHASE_TRACE_PERSIST needs LR_PHASE_TRACE."
+#endif
+#if defined(LR_PHASE_TRACE_PERSIST) && defined(LR_STORAGE_FLASH)
+#error "LR_PHASE_TRACE_PERSIST rewrites the configuration area, which is not possible on a flash chip."
+#endif
+
+// The trace is sent to the serial interface, if it is not persisted.
+#if defined(LR_PHASE_TRACE) && !defined(LR_PHASE_TRACE_PERSIST)
+#define LR_PHASE_TRACE_OUTPUT
+#endif
+
+
+#ifdef LR_PHASE_TRACE
+
+
+/// A trace of the phases of the logger.
+///
+/// Each entry is the time of one phase, like reading the sensor or writing
+/// the storage. The times are read from `micros()`, which is driven by
+/// timer 0 and stops in power-save mode. So the times only advance while
+/// the processor is awake, and the start-up time after a wake-up is not
+/// included. The latest entries are kept in a ring in RAM.
+///
+/// The logger only runs in logging mode, so the entries are sent to the
+/// serial interface, once half of the ring was not sent yet. The application
+/// sends them before it enters power-save mode, line by line, and waits
+/// for free space in the transmit buffer in idle mode. With
+/// `LR_PHASE_TRACE_PERSIST`, the ring is written to the configuration area
+/// instead, each time it is full, so it can be read in command mode with
+/// `t`. Both outputs are traced as well. As the persisted trace rewrites the
+/// same bytes every few samples, use it for measurements on the bench only.
+///
+/// All calls are placed in `#ifdef LR_PHASE_TRACE` blocks, so the trace
+/// compiles to nothing if it is disabled.
+///
+class PhaseTrace
+{
+public:
+    /// The traced phases.
+    ///
+    enum Phase : uint8_t {
+        Clock = 0, ///< Reading the time from the RTC.
+        Sensor = 1, ///< Reading the sensor, including the retries. The value is the number of reads.
+        Write = 2, ///< Writing the records to the storage. The value is the number of new records.
+        Sleep = 3, ///< Sleeping in power-save mode. The value is the number of wake-ups.
+        Persist = 4, ///< Writing the trace to the configuration area.
+        Output = 5 ///< Writing the trace to the serial interface. The value is the number of entries.
+    };
+    
+    /// The number of phases.
+    ///
+    static const uint8_t PhaseCount = 6;
+    
+    /// The maximum length of an entry as text, including the line end.
+    ///
+    /// "Trace persist 4294967295 4294967295 65535\r\n"
+    ///
+    static const uint8_t MaximumTextLength = 43;
+    
+    /// One entry of the trace.
+    ///
+    struct Entry {
+        uint32_t start; ///< The start of the phase in microseconds.
+        uint32_t end; ///< The end of the phase in microseconds.
+        uint16_t value; ///< A count for the phase, see `Phase`.
+        uint8_t phase; ///< The phase.
+    } __attribute__((packed));
+    
+public:
+    /// Create a new trace.
+    ///
+    /// @param storage The storage to persist the trace.
+    ///
+    PhaseTrace(Storage *storage);
+    
+    /// dtor
+    ///
+    ~PhaseTrace();
+    
+public:
+    /// Add a phase which ends now.
+    ///
+    /// @param phase The phase.
+    /// @param start The start of the phase, from `micros()`.
+    /// @param value A count for the phase.
+    ///
+    void add(Phase phase, uint32_t start, uint16_t value);
+    
+#ifdef LR_PHASE_TRACE_OUTPUT
+    /// Get the number of entries, which were not sent yet.
+    ///
+    inline uint8_t getUnsentCount() const { return _unsentCount; }
+    
+    /// Send the oldest entry, which was not sent yet.
+    ///
+    /// The entry is a line: `Trace <phase> <start> <duration> <value>`,
+    /// with the times in microseconds.
+    ///
+    void writeUnsentEntryToSerial();
+#endif
+    
+#ifdef LR_PHASE_TRACE_PERSIST
+    /// Write the persisted entries to the serial interface.
+    ///
+    /// Uses the same format as `writeUnsentEntryToSerial()`.
+    ///
+    void writePersistedToSerial() const;
+#endif
+    
+private:
+    /// Write a single entry to the serial interface.
+    ///
+    static void writeEntryToSerial(const Entry &entry);
+    
+#ifdef LR_PHASE_TRACE_PERSIST
+    /// Write all entries to the configuration area.
+    ///
+    void persist();
+#endif
+    
+private:
+    Storage *_storage;
+    Entry _entries[LR_PHASE_TRACE_SIZE]; ///< The ring of entries.
+    uint8_t _next; ///< The index for the next entry.
+    uint8_t _count; ///< The number of entries in the ring.
+    uint32_t _totalCount; ///< The number of entries since the start.
+#ifdef LR_PHASE_TRACE_OUTPUT
+    uint8_t _unsentCount; ///< The number of the latest entries, which were not sent yet.
+#endif
+};
+
+
+#endif
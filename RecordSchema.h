@@ -0,0 +1,261 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <Arduino.h>
+
+
+// A record schema declares the value channels of a log record at compile
+// time. The storage layout, the range checks and the text format of the
+// records are generated from this declaration.
+
+
+/// The scale of a fixed point value with the given number of decimal places.
+///
+constexpr uint16_t getDecimalScale(uint8_t decimals)
+{
+    return decimals == 0 ? 1 : 10 * getDecimalScale(decimals - 1);
+}
+
+
+/// The number of decimal digits of a value.
+///
+constexpr uint8_t getDigitCount(uint32_t value)
+{
+    return value < 10 ? 1 : 1 + getDigitCount(value / 10);
+}
+
+
+/// The length of a fixed point value as text.
+///
+constexpr uint8_t getFixedPointTextLength(int32_t value, uint8_t decimals)
+{
+    return (value < 0 ? 1 : 0) + getDigitCount(static_cast<uint32_t>(value < 0 ? -value : value) / getDecimalScale(decimals)) +
+        (decimals > 0 ? 1 + decimals : 0);
+}
+
+
+/// Write a fixed point value to the serial interface.
+///
+/// @tparam tDecimals The number of decimal places of the value.
+/// @param value The value in fixed point units.
+///
+template<uint8_t tDecimals>
+void writeFixedPointToSerial(int16_t value)
+{
+    uint16_t magnitude = static_cast<uint16_t>(value);
+    if (value < 0) {
+        Serial.print('-');
+        magnitude = static_cast<uint16_t>(0u - magnitude);
+    }
+    const uint16_t scale = getDecimalScale(tDecimals);
+    Serial.print(static_cast<unsigned int>(magnitude / scale));
+    if (tDecimals > 0) {
+        Serial.print('.');
+        uint16_t fraction = magnitude % scale;
+        for (uint16_t digit = scale / 10; digit > 0; digit /= 10) {
+            Serial.print(static_cast<char>('0' + fraction / digit));
+            fraction %= digit;
+        }
+    }
+}
+
+
+/// A value channel of a log record.
+///
+/// A channel is stored as 16-bit fixed point value. Declare a channel
+/// as a struct derived from this template, which adds the name:
+///
+/// ```
+/// struct PressureChannel : public RecordChannel<3000, 11000, 1> {
+///     static inline const __FlashStringHelper* getName() { return F("Pressure"); }
+/// };
+/// ```
+///
+/// @tparam tMinimum The minimum valid value in fixed point units.
+/// @tparam tMaximum The maximum valid value in fixed point units.
+/// @tparam tDecimals The number of decimal places of the fixed point value.
+///
+template<int16_t tMinimum, int16_t tMaximum, uint8_t tDecimals>
+struct RecordChannel
+{
+    static_assert(tMinimum <= tMaximum, "The minimum of a channel has to be less or equal to the maximum.");
+    static_assert(tDecimals <= 4, "A channel can have at most four decimal places.");
+    
+    static const int16_t Minimum = tMinimum; ///< The minimum valid value.
+    static const int16_t Maximum = tMaximum; ///< The maximum valid value.
+    static const uint8_t Decimals = tDecimals; ///< The number of decimal places.
+    
+    /// The maximum length of a value as text.
+    ///
+    static const uint8_t MaximumTextLength = getFixedPointTextLength(tMinimum, tDecimals) > getFixedPointTextLength(tMaximum, tDecimals) ?
+        getFixedPointTextLength(tMinimum, tDecimals) : getFixedPointTextLength(tMaximum, tDecimals);
+    
+    /// Check if a value is in the valid range.
+    ///
+    static inline bool isValid(int16_t value) {
+        return value >= tMinimum && value <= tMaximum;
+    }
+    
+    /// Clamp a value to the valid range.
+    ///
+    static inline int16_t clamp(int16_t value) {
+        return value < tMinimum ? tMinimum : (value > tMaximum ? tMaximum : value);
+    }
+    
+    /// Write a value to the serial interface.
+    ///
+    static inline void writeToSerial(int16_t value) {
+        writeFixedPointToSerial<tDecimals>(value);
+    }
+};
+
+
+/// The schema of a log record, as a list of channels.
+///
+/// All functions are expanded at compile time into code for each channel,
+/// functions with a channel index are folded if the index is a constant.
+///
+template<typename... tChannels>
+struct RecordSchema;
+
+
+/// The end of the channel list.
+///
+template<>
+struct RecordSchema<>
+{
+    static const uint8_t ChannelCount = 0;
+    static const uint8_t MaximumTextLength = 0;
+    
+    static inline bool isValid(const int16_t*) { return true; }
+    static inline void clamp(int16_t*) {}
+    static inline void writeToSerial(const int16_t*) {}
+    static constexpr int16_t getMinimum(uint8_t) { return 0; }
+    static constexpr int16_t getMaximum(uint8_t) { return 0; }
+    static constexpr uint8_t getDecimals(uint8_t) { return 0; }
+    static inline const __FlashStringHelper* getName(uint8_t) { return 0; }
+    static inline void writeValueToSerial(uint8_t, int16_t) {}
+};
+
+
+/// A list of channels.
+///
+template<typename tChannel, typename... tChannels>
+struct RecordSchema<tChannel, tChannels...>
+{
+    typedef RecordSchema<tChannels...> Next;
+    
+    /// The number of channels in the schema.
+    ///
+    static const uint8_t ChannelCount = 1 + Next::ChannelCount;
+    
+    /// The maximum length of all values as text, as written by `writeToSerial`.
+    ///
+    static const uint8_t MaximumTextLength = 1 + tChannel::MaximumTextLength + Next::MaximumTextLength;
+    
+    /// Check if all values are in the valid range of their channel.
+    ///
+    static inline bool isValid(const int16_t *values) {
+        return tChannel::isValid(values[0]) && Next::isValid(values + 1);
+    }
+    
+    /// Clamp all values to the valid range of their channel.
+    ///
+    static inline void clamp(int16_t *values) {
+        values[0] = tChannel::clamp(values[0]);
+        Next::clamp(values + 1);
+    }
+    
+    /// Write all values to the serial interface, each with a leading comma.
+    ///
+    static inline void writeToSerial(const int16_t *values) {
+        Serial.print(',');
+        tChannel::writeToSerial(values[0]);
+        Next::writeToSerial(values + 1);
+    }
+    
+    /// Get the minimum valid value of a channel.
+    ///
+    static constexpr int16_t getMinimum(uint8_t index) {
+        return index == 0 ? tChannel::Minimum : Next::getMinimum(index - 1);
+    }
+    
+    /// Get the maximum valid value of a channel.
+    ///
+    static constexpr int16_t getMaximum(uint8_t index) {
+        return index == 0 ? tChannel::Maximum : Next::getMaximum(index - 1);
+    }
+    
+    /// Get the number of decimal places of a channel.
+    ///
+    static constexpr uint8_t getDecimals(uint8_t index) {
+        return index == 0 ? tChannel::Decimals : Next::getDecimals(index - 1);
+    }
+    
+    /// Get the name of a channel.
+    ///
+    static inline const __FlashStringHelper* getName(uint8_t index) {
+        return index == 0 ? tChannel::getName() : Next::getName(index - 1);
+    }
+    
+    /// Write the value of a channel to the serial interface.
+    ///
+    static inline void writeValueToSerial(uint8_t index, int16_t value) {
+        if (index == 0) {
+            tChannel::writeToSerial(value);
+        } else {
+            Next::writeValueToSerial(index - 1, value);
+        }
+    }
+};
+
+
+// The schema of the log records.
+//
+// Changing the channels changes the storage format, so the magic of the
+// log header in `InternalLogRecord.h` has to change as well.
+
+
+/// The temperature in 1/10 celsius.
+///
+struct TemperatureChannel : public RecordChannel<-2731, 1000, 1> {
+    static inline const __FlashStringHelper* getName() { return F("Temperature"); }
+};
+
+/// The relative humidity in 1/10 percent.
+///
+struct HumidityChannel : public RecordChannel<0, 1000, 1> {
+    static inline const __FlashStringHelper* getName() { return F("Humidity"); }
+};
+
+
+/// The channels of a log record, in the order of the storage and the text format.
+///
+typedef RecordSchema<TemperatureChannel, HumidityChannel> LogRecordSchema;
+
+
+/// The index of the channels in a log record.
+///
+enum LogChannel : uint8_t {
+    LogChannelTemperature = 0,
+    LogChannelHumidity = 1
+};
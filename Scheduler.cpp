@@ -0,0 +1,100 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Scheduler.h"
+
+
+Scheduler::Scheduler()
+    : _taskCount(0)
+{
+}
+
+
+Scheduler::~Scheduler()
+{
+}
+
+
+uint8_t Scheduler::addTask(TaskFunction function, void *context, uint32_t period, uint32_t deadline)
+{
+    if (_taskCount >= LR_SCHEDULER_MAXIMUM_TASKS) {
+        return InvalidTask;
+    }
+    Task &task = _tasks[_taskCount];
+    task.function = function;
+    task.context = context;
+    task.period = period;
+    task.deadline = deadline;
+    return _taskCount++;
+}
+
+
+void Scheduler::setPeriod(uint8_t task, uint32_t period)
+{
+    if (task < _taskCount) {
+        _tasks[task].period = period;
+    }
+}
+
+
+void Scheduler::setDeadline(uint8_t task, uint32_t deadline)
+{
+    if (task < _taskCount) {
+        _tasks[task].deadline = deadline;
+    }
+}
+
+
+uint32_t Scheduler::getNextDeadline() const
+{
+    uint32_t result = NoDeadline;
+    for (uint8_t i = 0; i < _taskCount; ++i) {
+        if (_tasks[i].deadline < result) {
+            result = _tasks[i].deadline;
+        }
+    }
+    return result;
+}
+
+
+void Scheduler::runDueTasks(uint32_t currentTime)
+{
+    for (uint8_t i = 0; i < _taskCount; ++i) {
+        Task &task = _tasks[i];
+        if (task.deadline > currentTime) {
+            continue;
+        }
+        const uint32_t deadline = task.deadline;
+        task.function(task.context);
+        if (task.deadline != deadline) {
+            continue; // The task set its own deadline.
+        }
+        if (task.period == 0) {
+            task.deadline = NoDeadline;
+        } else {
+            task.deadline += task.period;
+            if (task.deadline <= currentTime) {
+                // Skip the missed deadlines, but stay in the period.
+                task.deadline += ((currentTime - task.deadline) / task.period + 1) * task.period;
+            }
+        }
+    }
+}
+
+
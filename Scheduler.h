@@ -0,0 +1,116 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <Arduino.h>
+
+
+/// The maximum number of tasks of the scheduler.
+///
+#define LR_SCHEDULER_MAXIMUM_TASKS 4
+
+
+/// A simple cooperative scheduler for periodic tasks.
+///
+/// Each task has a period and a deadline, in seconds of the real time
+/// clock. There is no tick: the application asks for the earliest
+/// deadline, sleeps until then and runs all tasks which are due. The
+/// tasks are stored in a fixed table, without dynamic allocation.
+///
+class Scheduler
+{
+public:
+    /// The function of a task.
+    ///
+    /// @param context The context which was passed to `addTask()`.
+    ///
+    typedef void (*TaskFunction)(void *context);
+    
+    /// The value returned by `addTask()` if there is no space for another task.
+    ///
+    static const uint8_t InvalidTask = 0xff;
+    
+    /// The deadline of a task which will never run again.
+    ///
+    static const uint32_t NoDeadline = 0xffffffffUL;
+    
+public:
+    /// ctor
+    ///
+    Scheduler();
+    
+    /// dtor
+    ///
+    ~Scheduler();
+    
+public:
+    /// Add a new task.
+    ///
+    /// @param function The function to call.
+    /// @param context The context for the function.
+    /// @param period The period in seconds, 0 for a task which runs once.
+    /// @param deadline The time to run the task the first time, as unix time.
+    /// @return The index of the task, or `InvalidTask` if the table is full.
+    ///
+    uint8_t addTask(TaskFunction function, void *context, uint32_t period, uint32_t deadline);
+    
+    /// Change the period of a task.
+    ///
+    /// If this is called while the task runs, the next deadline uses the new period.
+    ///
+    void setPeriod(uint8_t task, uint32_t period);
+    
+    /// Change the next deadline of a task.
+    ///
+    void setDeadline(uint8_t task, uint32_t deadline);
+    
+    /// Get the earliest deadline of all tasks.
+    ///
+    /// @return The earliest deadline, or `NoDeadline` if no task has to run.
+    ///
+    uint32_t getNextDeadline() const;
+    
+    /// Run all tasks which are due.
+    ///
+    /// The next deadline of a task is the following one in its period, which
+    /// keeps the timing stable. Deadlines which passed while other tasks were
+    /// running are skipped.
+    ///
+    /// @param currentTime The current time as unix time.
+    ///
+    void runDueTasks(uint32_t currentTime);
+    
+private:
+    /// A single task.
+    ///
+    struct Task {
+        TaskFunction function; ///< The function to call.
+        void *context; ///< The context for the function.
+        uint32_t period; ///< The period in seconds, or 0.
+        uint32_t deadline; ///< The next time to run the task.
+    };
+    
+private:
+    Task _tasks[LR_SCHEDULER_MAXIMUM_TASKS]; ///< The table with all tasks.
+    uint8_t _taskCount; ///< The number of tasks in the table.
+};
+
+
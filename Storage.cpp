@@ -20,14 +20,59 @@
 #include "Storage.h"
 
 
-#ifdef LR_STORAGE_FRAM
+#if defined(LR_STORAGE_IMAGE)
+#include <string.h>
+#elif defined(LR_STORAGE_FLASH)
+#include <SPI.h>
+#elif defined(LR_STORAGE_BLOCK)
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+#ifdef LR_STORAGE_BLOCK_FILE
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <SD.h>
+#endif
+#elif defined(LR_STORAGE_FRAM)
+#include "I2CBus.h"
 #include <Wire.h>
 #else
 #include <EEPROM.h>
 #endif
 
 
+#if defined(LR_STORAGE_IMAGE)
+namespace {
+    
+    
+uint8_t *defaultImage = 0; // The image for new storages.
+uint32_t defaultImageSize = 0; // The size of the image for new storages.
+uint32_t defaultEraseSize = 0; // The erase sector size for new storages.
+thread_local uint64_t transferredBytes = 0; // The number of bytes read and written by all storages of this thread.
+thread_local uint64_t eraseCount = 0; // The number of sectors erased by all storages of this thread.
+thread_local uint64_t eraseViolations = 0; // The number of writes to bytes which were not erased.
+thread_local uint64_t readCount = 0; // The number of reads by all storages of this thread.
+thread_local uint64_t transferCount = 0; // The number of bus transfers of a FRAM chip for all storages of this thread.
+
+    
+}
+#endif
+
+
 Storage::Storage()
+#if defined(LR_STORAGE_IMAGE)
+    : _image(defaultImage), _imageSize(defaultImageSize), _eraseSize(defaultEraseSize)
+#elif defined(LR_STORAGE_FLASH)
+    : _size(0)
+#elif defined(LR_STORAGE_BLOCK)
+    : _blockIndex(InvalidBlock), _isBlockChanged(false), _blockCount(0), _blockReads(0), _blockWrites(0)
+#elif defined(LR_STORAGE_FRAM)
+    : _chipCount(0), _chipSizeShift(0)
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    , _cacheStart(InvalidCacheStart), _cacheHits(0), _cacheMisses(0)
+#endif
+#endif
 {
 }
 
@@ -37,31 +82,681 @@ Storage::~Storage()
 }
 
 
-#ifdef LR_STORAGE_FRAM
+#if defined(LR_STORAGE_IMAGE)
+
+
+void Storage::setImage(uint8_t *image, uint32_t size, uint32_t eraseSize)
+{
+    _image = image;
+    _imageSize = size;
+    _eraseSize = eraseSize;
+}
+
+
+void Storage::setDefaultImage(uint8_t *image, uint32_t size, uint32_t eraseSize)
+{
+    defaultImage = image;
+    defaultImageSize = size;
+    defaultEraseSize = eraseSize;
+}
+
+
+uint64_t Storage::getTransferredBytes()
+{
+    return transferredBytes;
+}
+
+
+uint64_t Storage::getReadCount()
+{
+    return readCount;
+}
+
+
+uint64_t Storage::getTransferCount()
+{
+    return transferCount;
+}
+
+
+uint64_t Storage::getEraseCount()
+{
+    return eraseCount;
+}
+
+
+uint64_t Storage::getEraseViolations()
+{
+    return eraseViolations;
+}
+
+
+bool Storage::begin()
+{
+    return _image != 0;
+}
+
+
+uint32_t Storage::size()
+{
+    return _imageSize;
+}
+
+
+void Storage::writeByte(uint32_t index, uint8_t data)
+{
+    writeBytes(index, &data, 1);
+}
+
+
+void Storage::writeBytes(uint32_t firstIndex, const uint8_t *data, uint32_t size)
+{
+    if (_eraseSize == 0) {
+        memcpy(_image + firstIndex, data, size);
+    } else {
+        // Like a flash chip, a write can only clear bits.
+        for (uint32_t i = 0; i < size; ++i) {
+            uint8_t &target = _image[firstIndex + i];
+            if ((target & data[i]) != data[i]) {
+                ++eraseViolations;
+            }
+            target &= data[i];
+        }
+    }
+    transferredBytes += size;
+    transferCount += (size + ImageTransferSize - 1) / ImageTransferSize;
+}
+
+
+uint32_t Storage::eraseSize() const
+{
+    return _eraseSize;
+}
+
+
+void Storage::eraseSector(uint32_t index)
+{
+    if (_eraseSize == 0) {
+        return;
+    }
+    const uint32_t sectorStart = index - (index % _eraseSize);
+    memset(_image + sectorStart, 0xff, _eraseSize);
+    ++eraseCount;
+}
+
+
+uint8_t Storage::readByte(uint32_t index)
+{
+    ++transferredBytes;
+    ++readCount;
+    ++transferCount;
+    return _image[index];
+}
+
+
+void Storage::readBytes(uint32_t firstIndex, uint8_t *data, uint32_t size)
+{
+    memcpy(data, _image + firstIndex, size);
+    transferredBytes += size;
+    ++readCount;
+    transferCount += (size + ImageTransferSize - 1) / ImageTransferSize;
+}
+
+
+#elif defined(LR_STORAGE_FLASH)
+
+
+/// The commands of the W25Q series flash chips.
+///
+const uint8_t W25Q_WRITE_ENABLE = 0x06;
+const uint8_t W25Q_READ_STATUS = 0x05;
+const uint8_t W25Q_READ_DATA = 0x03;
+const uint8_t W25Q_PAGE_PROGRAM = 0x02;
+const uint8_t W25Q_SECTOR_ERASE = 0x20;
+const uint8_t W25Q_RELEASE_POWER_DOWN = 0xab;
+const uint8_t W25Q_READ_JEDEC_ID = 0x9f;
+
+/// The busy bit in the status register.
+///
+const uint8_t W25Q_STATUS_BUSY = 0x01;
+
+/// The size of a page, a single program command can not cross a page boundary.
+///
+const uint16_t W25Q_PAGE_SIZE = 256;
+
+/// The size of the smallest erasable sector.
+///
+const uint16_t W25Q_SECTOR_SIZE = 4096;
+
+/// The supported range for the capacity code in the JEDEC ID.
+///
+/// The capacity code is the power of two of the size in bytes.
+/// 0x11 = 128KB (W25Q10), 0x14 = 1MB (W25Q80), 0x18 = 16MB (W25Q128).
+/// Larger chips need 4 byte addresses, which are not supported.
+///
+const uint8_t W25Q_CAPACITY_MINIMUM = 0x11;
+const uint8_t W25Q_CAPACITY_MAXIMUM = 0x18;
+
+/// The settings for the SPI bus.
+///
+const SPISettings W25Q_SPI_SETTINGS(8000000, MSBFIRST, SPI_MODE0);
+
+
+bool Storage::begin()
+{
+    pinMode(LR_STORAGE_FLASH_CS_PIN, OUTPUT);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.begin();
+    // Wake the chip, in case it was left in power down mode.
+    SPI.beginTransaction(W25Q_SPI_SETTINGS);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+    SPI.transfer(W25Q_RELEASE_POWER_DOWN);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+    delayMicroseconds(5);
+    SPI.beginTransaction(W25Q_SPI_SETTINGS);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+    SPI.transfer(W25Q_READ_JEDEC_ID);
+    const uint8_t manufacturerID = SPI.transfer(0);
+    SPI.transfer(0); // The memory type is not relevant.
+    const uint8_t capacity = SPI.transfer(0);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+    if (manufacturerID == 0x00 || manufacturerID == 0xff ||
+        capacity < W25Q_CAPACITY_MINIMUM ||
+        capacity > W25Q_CAPACITY_MAXIMUM) {
+        Serial.println(F("Problem with flash: Unknown manufacturer or capacity."));
+        return false;
+    }
+    _size = static_cast<uint32_t>(1) << capacity;
+    return true;
+}
+
+
+uint32_t Storage::size()
+{
+    return _size;
+}
+
+
+void Storage::waitUntilReady()
+{
+    SPI.beginTransaction(W25Q_SPI_SETTINGS);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+    SPI.transfer(W25Q_READ_STATUS);
+    while ((SPI.transfer(0) & W25Q_STATUS_BUSY) != 0) {
+        // The status register is sent continuously.
+    }
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+}
+
+
+void Storage::beginCommand(uint8_t command, uint32_t index)
+{
+    SPI.beginTransaction(W25Q_SPI_SETTINGS);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+    SPI.transfer(command);
+    SPI.transfer(static_cast<uint8_t>(index>>16));
+    SPI.transfer(static_cast<uint8_t>(index>>8));
+    SPI.transfer(static_cast<uint8_t>(index&0xff));
+}
+
+
+void Storage::writeByte(uint32_t index, uint8_t data)
+{
+    writeBytes(index, &data, 1);
+}
+
+
+void Storage::writeBytes(uint32_t firstIndex, const uint8_t *data, uint32_t size)
+{
+    while (size > 0) {
+        uint32_t blockSize = W25Q_PAGE_SIZE - (firstIndex & (W25Q_PAGE_SIZE-1));
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        waitUntilReady();
+        SPI.beginTransaction(W25Q_SPI_SETTINGS);
+        digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+        SPI.transfer(W25Q_WRITE_ENABLE);
+        digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+        SPI.endTransaction();
+        beginCommand(W25Q_PAGE_PROGRAM, firstIndex);
+        for (uint16_t i = 0; i < blockSize; ++i) {
+            SPI.transfer(data[i]);
+        }
+        // The chip starts programming the page if the chip select goes high.
+        digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+        SPI.endTransaction();
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
+    }
+}
+
+
+uint8_t Storage::readByte(uint32_t index)
+{
+    uint8_t data;
+    readBytes(index, &data, 1);
+    return data;
+}
+
+
+void Storage::readBytes(uint32_t firstIndex, uint8_t *data, uint32_t size)
+{
+    // A read command can stream the whole chip, there are no boundaries.
+    waitUntilReady();
+    beginCommand(W25Q_READ_DATA, firstIndex);
+    for (uint32_t i = 0; i < size; ++i) {
+        data[i] = SPI.transfer(0);
+    }
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+}
+
+
+uint32_t Storage::eraseSize() const
+{
+    return W25Q_SECTOR_SIZE;
+}
+
+
+void Storage::eraseSector(uint32_t index)
+{
+    waitUntilReady();
+    SPI.beginTransaction(W25Q_SPI_SETTINGS);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, LOW);
+    SPI.transfer(W25Q_WRITE_ENABLE);
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+    beginCommand(W25Q_SECTOR_ERASE, index);
+    // The erase runs in the background, the next access waits for it.
+    digitalWrite(LR_STORAGE_FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+}
+
+
+#elif defined(LR_STORAGE_BLOCK)
+
+
+/// The number of blocks at the end of the card, which are used for the journal.
+///
+/// The first block keeps a copy of the last written block, the second
+/// block starts with the journal header.
+///
+const uint8_t BLOCK_JOURNAL_SIZE = 2;
+
+/// The magic for a valid journal header, "LRJ1".
+///
+const uint32_t BLOCK_JOURNAL_MAGIC = 0x314a524c;
+
+/// The maximum number of blocks, to keep all byte indexes in 32 bit.
+///
+const uint32_t BLOCK_MAXIMUM_COUNT = 0x800000;
+
+
+namespace {
+
+    
+// The header of the journal.
+//
+struct BlockJournalHeader {
+    uint32_t magic; // The magic to detect a journal.
+    uint32_t block; // The index of the block in the journal.
+    uint16_t blockCRC; // The CRC-16 of the block in the journal.
+    uint16_t crc; // The CRC-16 of the header fields before.
+};
+
+    
+// Calculate the CRC-16 of a block.
+//
+uint16_t getBlockCRC(const void *data, uint16_t size)
+{
+    uint16_t crc = 0xffff;
+    const uint8_t *dataPtr = reinterpret_cast<const uint8_t*>(data);
+    for (uint16_t i = 0; i < size; ++i) {
+        crc = _crc16_update(crc, dataPtr[i]);
+    }
+    return crc;
+}
+
+    
+#ifdef LR_STORAGE_BLOCK_FILE
+int blockFile = -1; // The file which replaces the card.
+uint32_t powerLossWrites = 0xffffffff; // The number of block writes until the simulated power loss.
+uint16_t powerLossBytes = 0; // The number of bytes of the interrupted block write.
+
+
+bool beginCard(uint32_t *blockCount)
+{
+    struct stat status;
+    if (blockFile < 0 || fstat(blockFile, &status) != 0) {
+        return false;
+    }
+    *blockCount = static_cast<uint32_t>(status.st_size / Storage::BlockSize);
+    return true;
+}
+
+
+void readBlockFromCard(uint32_t block, uint8_t *data)
+{
+    if (pread(blockFile, data, Storage::BlockSize, static_cast<off_t>(block) * Storage::BlockSize) != Storage::BlockSize) {
+        memset(data, 0, Storage::BlockSize);
+    }
+}
+
+
+void writeBlockToCard(uint32_t block, const uint8_t *data)
+{
+    uint16_t size = Storage::BlockSize;
+    if (powerLossWrites != 0xffffffff) {
+        if (powerLossWrites == 0) {
+            size = powerLossBytes;
+            powerLossBytes = 0; // All following writes are lost.
+        } else {
+            --powerLossWrites;
+        }
+    }
+    if (size > 0) {
+        // Like a failed write to the card, a failed write is ignored.
+        const ssize_t result = pwrite(blockFile, data, size, static_cast<off_t>(block) * Storage::BlockSize);
+        (void)result;
+    }
+}
+#else
+Sd2Card card; // The SD card, only the raw block access of the SD library is used.
+
+
+bool beginCard(uint32_t *blockCount)
+{
+    if (!card.init(SPI_HALF_SPEED, LR_STORAGE_BLOCK_CS_PIN)) {
+        return false;
+    }
+    *blockCount = card.cardSize();
+    return true;
+}
+
+
+inline void readBlockFromCard(uint32_t block, uint8_t *data)
+{
+    card.readBlock(block, data);
+}
+
+
+inline void writeBlockToCard(uint32_t block, const uint8_t *data)
+{
+    card.writeBlock(block, data);
+}
+#endif
+
+    
+}
+
+
+#ifdef LR_STORAGE_BLOCK_FILE
+
+
+void Storage::setBlockFile(int file)
+{
+    blockFile = file;
+}
+
+
+void Storage::setPowerLoss(uint32_t blockWrites, uint16_t tornBytes)
+{
+    powerLossWrites = blockWrites;
+    powerLossBytes = tornBytes;
+}
+
+
+#endif
+
+
+bool Storage::begin()
+{
+    _blockIndex = InvalidBlock;
+    _isBlockChanged = false;
+    uint32_t blockCount = 0;
+    if (!beginCard(&blockCount) || blockCount <= BLOCK_JOURNAL_SIZE) {
+        Serial.println(F("Problem with SD card: No card or unknown card type."));
+        return false;
+    }
+    if (blockCount > BLOCK_MAXIMUM_COUNT) {
+        blockCount = BLOCK_MAXIMUM_COUNT;
+    }
+    _blockCount = blockCount - BLOCK_JOURNAL_SIZE;
+    recoverJournal();
+    return true;
+}
+
+
+uint32_t Storage::size()
+{
+    return _blockCount * BlockSize;
+}
+
+
+void Storage::recoverJournal()
+{
+    BlockJournalHeader header;
+    readBlockFromCard(_blockCount + 1, _block);
+    ++_blockReads;
+    memcpy(&header, _block, sizeof(BlockJournalHeader));
+    if (header.magic != BLOCK_JOURNAL_MAGIC ||
+        header.crc != getBlockCRC(&header, offsetof(BlockJournalHeader, crc)) ||
+        header.block >= _blockCount) {
+        return; // No journal.
+    }
+    // Usually, the block was completely written after the journal.
+    readBlockFromCard(header.block, _block);
+    ++_blockReads;
+    if (getBlockCRC(_block, BlockSize) != header.blockCRC) {
+        // The write of the block was interrupted, copy it from the journal.
+        readBlockFromCard(_blockCount, _block);
+        ++_blockReads;
+        if (getBlockCRC(_block, BlockSize) != header.blockCRC) {
+            return; // The journal itself was interrupted, the old block is unchanged.
+        }
+        writeBlockToCard(header.block, _block);
+        ++_blockWrites;
+    }
+    _blockIndex = header.block;
+}
+
+
+void Storage::loadBlock(uint32_t block, bool isOverwritten)
+{
+    if (block == _blockIndex) {
+        return;
+    }
+    flush();
+    if (!isOverwritten) {
+        readBlockFromCard(block, _block);
+        ++_blockReads;
+    }
+    _blockIndex = block;
+}
+
+
+void Storage::flush()
+{
+    if (!_isBlockChanged) {
+        return;
+    }
+    // Write a copy of the block and a header to the journal, before the
+    // block is written to its place. The header replaces the start of the
+    // buffered block while it is written, to save a second buffer.
+    BlockJournalHeader header;
+    header.magic = BLOCK_JOURNAL_MAGIC;
+    header.block = _blockIndex;
+    header.blockCRC = getBlockCRC(_block, BlockSize);
+    header.crc = getBlockCRC(&header, offsetof(BlockJournalHeader, crc));
+    writeBlockToCard(_blockCount, _block);
+    uint8_t blockStart[sizeof(BlockJournalHeader)];
+    memcpy(blockStart, _block, sizeof(BlockJournalHeader));
+    memcpy(_block, &header, sizeof(BlockJournalHeader));
+    writeBlockToCard(_blockCount + 1, _block);
+    memcpy(_block, blockStart, sizeof(BlockJournalHeader));
+    writeBlockToCard(_blockIndex, _block);
+    _blockWrites += 3;
+    _isBlockChanged = false;
+}
+
+
+void Storage::writeByte(uint32_t index, uint8_t data)
+{
+    writeBytes(index, &data, 1);
+}
+
+
+void Storage::writeBytes(uint32_t firstIndex, const uint8_t *data, uint32_t size)
+{
+    while (size > 0) {
+        const uint16_t blockOffset = static_cast<uint16_t>(firstIndex % BlockSize);
+        uint32_t blockSize = BlockSize - blockOffset;
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        loadBlock(firstIndex / BlockSize, blockSize == BlockSize);
+        memcpy(_block + blockOffset, data, blockSize);
+        _isBlockChanged = true;
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
+    }
+}
+
+
+uint8_t Storage::readByte(uint32_t index)
+{
+    loadBlock(index / BlockSize, false);
+    return _block[index % BlockSize];
+}
+
+
+void Storage::readBytes(uint32_t firstIndex, uint8_t *data, uint32_t size)
+{
+    while (size > 0) {
+        const uint16_t blockOffset = static_cast<uint16_t>(firstIndex % BlockSize);
+        uint32_t blockSize = BlockSize - blockOffset;
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        loadBlock(firstIndex / BlockSize, false);
+        memcpy(data, _block + blockOffset, blockSize);
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
+    }
+}
+
+
+#elif defined(LR_STORAGE_FRAM)
 
 
 /// The address of the FRAM chip in the I2C bus.
 ///
 /// The address is 1010AAA where AAA is the custom address which can
-/// be set with the pins on the chip.
+/// be set with the pins on the chip. Chips with more than 64KB use the
+/// lowest one or two address bits as the highest bits of the memory address.
 ///
 const uint8_t MB85RC_ADDRESS = B1010000;
 
+/// The reserved address to read the device ID from the chips.
+///
+const uint8_t MB85RC_DEVICE_ID_ADDRESS = 0xf8>>1;
 
-bool Storage::begin()
+/// The manufacturer ID for Fujitsu.
+///
+const uint16_t MB85RC_MANUFACTURER_ID = 0x00a;
+
+/// The supported range for the density code in the product ID.
+///
+/// The density code is the power of two of the size in KB.
+/// 0x3 = 8KB (MB85RC64), 0x5 = 32KB (MB85RC256), 0x7 = 128KB (MB85RC1M), 0x8 = 256KB.
+///
+const uint8_t MB85RC_DENSITY_MINIMUM = 0x3;
+const uint8_t MB85RC_DENSITY_MAXIMUM = 0x8;
+
+/// The maximum number of bytes in a single write transfer.
+///
+/// This is limited by the buffer of the Wire library, minus the two
+/// bytes of the memory address.
+///
+const uint8_t MB85RC_MAXIMUM_WRITE = BUFFER_LENGTH-2;
+
+/// The maximum number of bytes in a single read transfer.
+///
+const uint8_t MB85RC_MAXIMUM_READ = BUFFER_LENGTH;
+
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+static_assert((LR_STORAGE_READ_CACHE_SIZE & (LR_STORAGE_READ_CACHE_SIZE-1)) == 0, "The cache size has to be a power of two.");
+static_assert(LR_STORAGE_READ_CACHE_SIZE >= 8 && LR_STORAGE_READ_CACHE_SIZE <= 128, "The cache size has to be between 8 and 128 bytes.");
+#endif
+
+
+namespace {
+
+    
+// Read the size of a chip from its device ID.
+//
+// @param slot The custom address of the chip (0-7).
+// @return The size of the chip as power of two, or 0 if there is no known chip at this address.
+//
+uint8_t readChipSizeShift(uint8_t slot)
 {
-    // Read the manufacturer ID and product ID to make sure the FRAM is available.
-    Wire.beginTransmission(0xf8>>1);
-    Wire.write(MB85RC_ADDRESS<<1);
-    Wire.endTransmission(false);
-    Wire.requestFrom(0xf8>>1, 3);
+    Wire.beginTransmission(MB85RC_DEVICE_ID_ADDRESS);
+    Wire.write((MB85RC_ADDRESS|slot)<<1);
+    if (Wire.endTransmission(false) != 0) {
+        return 0;
+    }
+    if (Wire.requestFrom(MB85RC_DEVICE_ID_ADDRESS, static_cast<uint8_t>(3)) != 3) {
+        return 0;
+    }
     const uint8_t id0 = Wire.read();
     const uint8_t id1 = Wire.read();
-    const uint8_t id2 = Wire.read();
+    Wire.read(); // The lower bits of the product ID are not relevant.
     const uint16_t manufacturerID = (id0<<4)+(id1>>4);
-    const uint16_t productID = ((id1&0x0f)<<8)+id2;
-    // Check the both IDs
-    if (manufacturerID != 0x00a || productID != 0x510) {
+    const uint8_t density = (id1&0x0f);
+    if (manufacturerID != MB85RC_MANUFACTURER_ID ||
+        density < MB85RC_DENSITY_MINIMUM ||
+        density > MB85RC_DENSITY_MAXIMUM) {
+        return 0;
+    }
+    return density + 10;
+}
+
+    
+}
+
+
+bool Storage::begin()
+{
+    // Detect all chips on the bus. The chips have to be of the same type
+    // and have to use consecutive addresses, starting with address 0.
+    // They are presented as one linear memory area.
+    _chipCount = 0;
+    _chipSizeShift = 0;
+    I2CBus::select(I2CBus::Fram);
+    uint8_t slot = 0;
+    while (slot < 8) {
+        const uint8_t chipSizeShift = readChipSizeShift(slot);
+        if (chipSizeShift == 0) {
+            break;
+        }
+        if (_chipCount == 0) {
+            _chipSizeShift = chipSizeShift;
+        } else if (chipSizeShift != _chipSizeShift) {
+            Serial.println(F("Problem with FRAM: Mixed chip types."));
+            return false;
+        }
+        ++_chipCount;
+        // Large chips occupy more than one address.
+        slot += (_chipSizeShift > 16) ? (1<<(_chipSizeShift-16)) : 1;
+    }
+    if (_chipCount == 0) {
         Serial.println("Problem with FRAM: Unknown manufacturer or product ID.");
         return false;
     }
@@ -71,15 +766,41 @@ bool Storage::begin()
 
 uint32_t Storage::size()
 {
-    return 32768; // 32KB
+    return static_cast<uint32_t>(_chipCount) << _chipSizeShift;
+}
+
+
+uint8_t Storage::getDeviceAddress(uint32_t index) const
+{
+    // Chips are placed at consecutive addresses, large chips use the lower
+    // address bits for the highest bits of the memory address. Therefore
+    // the device address is simply the upper part of the linear index.
+    if (_chipSizeShift >= 16) {
+        return MB85RC_ADDRESS + static_cast<uint8_t>(index>>16);
+    } else {
+        return MB85RC_ADDRESS + static_cast<uint8_t>(index>>_chipSizeShift);
+    }
+}
+
+
+uint32_t Storage::getBytesToBoundary(uint32_t index) const
+{
+    // A single transfer has to stay in the 64KB window of one device address.
+    const uint8_t boundaryShift = (_chipSizeShift >= 16) ? 16 : _chipSizeShift;
+    const uint32_t boundarySize = static_cast<uint32_t>(1) << boundaryShift;
+    return boundarySize - (index & (boundarySize-1));
 }
 
 
 void Storage::writeByte(uint32_t index, uint8_t data)
 {
-    Wire.beginTransmission(MB85RC_ADDRESS);
-    Wire.write(index>>8);
-    Wire.write(index&0xff);
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    invalidateCache(index, 1);
+#endif
+    I2CBus::select(I2CBus::Fram);
+    Wire.beginTransmission(getDeviceAddress(index));
+    Wire.write(static_cast<uint8_t>(index>>8));
+    Wire.write(static_cast<uint8_t>(index&0xff));
     Wire.write(data);
     Wire.endTransmission();
 }
@@ -87,41 +808,130 @@ void Storage::writeByte(uint32_t index, uint8_t data)
 
 void Storage::writeBytes(uint32_t firstIndex, const uint8_t *data, uint32_t size)
 {
-    Wire.beginTransmission(MB85RC_ADDRESS);
-    Wire.write(static_cast<uint8_t>(firstIndex>>8));
-    Wire.write(static_cast<uint8_t>(firstIndex&0xff));
-    for (uint32_t i = 0; i < size; ++i) {
-        Wire.write(data[i]);
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    invalidateCache(firstIndex, size);
+#endif
+    I2CBus::select(I2CBus::Fram);
+    while (size > 0) {
+        uint32_t blockSize = getBytesToBoundary(firstIndex);
+        if (blockSize > MB85RC_MAXIMUM_WRITE) {
+            blockSize = MB85RC_MAXIMUM_WRITE;
+        }
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        Wire.beginTransmission(getDeviceAddress(firstIndex));
+        Wire.write(static_cast<uint8_t>(firstIndex>>8));
+        Wire.write(static_cast<uint8_t>(firstIndex&0xff));
+        Wire.write(data, static_cast<uint8_t>(blockSize));
+        Wire.endTransmission();
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
     }
-    Wire.endTransmission();
 }
 
 
 uint8_t Storage::readByte(uint32_t index)
 {
-    Wire.beginTransmission(MB85RC_ADDRESS);
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    uint8_t data;
+    readBytesFromCache(index, &data, 1);
+    return data;
+#else
+    I2CBus::select(I2CBus::Fram);
+    const uint8_t deviceAddress = getDeviceAddress(index);
+    Wire.beginTransmission(deviceAddress);
     Wire.write(static_cast<uint8_t>(index>>8));
     Wire.write(static_cast<uint8_t>(index&0xff));
     Wire.endTransmission();
-    Wire.requestFrom(MB85RC_ADDRESS, static_cast<uint8_t>(1));
+    Wire.requestFrom(deviceAddress, static_cast<uint8_t>(1));
     return Wire.read();
+#endif
 }
 
 
 void Storage::readBytes(uint32_t firstIndex, uint8_t *data, uint32_t size)
 {
-    // reads >0xff will not work.
-    Wire.beginTransmission(MB85RC_ADDRESS);
-    Wire.write(static_cast<uint8_t>(firstIndex>>8));
-    Wire.write(static_cast<uint8_t>(firstIndex&0xff));
-    Wire.endTransmission();
-    Wire.requestFrom(MB85RC_ADDRESS, static_cast<uint8_t>(size));
-    for (uint32_t i = 0; i < size; ++i) {
-        data[i] = Wire.read();
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    // Large reads gain nothing from the cache.
+    if (size < LR_STORAGE_READ_CACHE_SIZE) {
+        readBytesFromCache(firstIndex, data, size);
+        return;
+    }
+#endif
+    readBytesFromChip(firstIndex, data, size);
+}
+
+
+void Storage::readBytesFromChip(uint32_t firstIndex, uint8_t *data, uint32_t size)
+{
+    I2CBus::select(I2CBus::Fram);
+    while (size > 0) {
+        uint32_t blockSize = getBytesToBoundary(firstIndex);
+        if (blockSize > MB85RC_MAXIMUM_READ) {
+            blockSize = MB85RC_MAXIMUM_READ;
+        }
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        const uint8_t deviceAddress = getDeviceAddress(firstIndex);
+        Wire.beginTransmission(deviceAddress);
+        Wire.write(static_cast<uint8_t>(firstIndex>>8));
+        Wire.write(static_cast<uint8_t>(firstIndex&0xff));
+        Wire.endTransmission();
+        Wire.requestFrom(deviceAddress, static_cast<uint8_t>(blockSize));
+        for (uint8_t i = 0; i < blockSize; ++i) {
+            data[i] = Wire.read();
+        }
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
+    }
+}
+
+
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+
+
+void Storage::readBytesFromCache(uint32_t firstIndex, uint8_t *data, uint32_t size)
+{
+    while (size > 0) {
+        const uint32_t pageStart = firstIndex & ~static_cast<uint32_t>(LR_STORAGE_READ_CACHE_SIZE-1);
+        if (pageStart != _cacheStart) {
+            // Load the whole page. This prefetches the following bytes for sequential reads.
+            readBytesFromChip(pageStart, _cache, LR_STORAGE_READ_CACHE_SIZE);
+            _cacheStart = pageStart;
+            ++_cacheMisses;
+        } else {
+            ++_cacheHits;
+        }
+        const uint8_t pageOffset = static_cast<uint8_t>(firstIndex - pageStart);
+        uint32_t blockSize = LR_STORAGE_READ_CACHE_SIZE - pageOffset;
+        if (blockSize > size) {
+            blockSize = size;
+        }
+        memcpy(data, _cache + pageOffset, blockSize);
+        firstIndex += blockSize;
+        data += blockSize;
+        size -= blockSize;
     }
 }
 
 
+void Storage::invalidateCache(uint32_t firstIndex, uint32_t size)
+{
+    if (_cacheStart != InvalidCacheStart &&
+        firstIndex < _cacheStart + LR_STORAGE_READ_CACHE_SIZE &&
+        firstIndex + size > _cacheStart) {
+        _cacheStart = InvalidCacheStart;
+    }
+}
+
+
+#endif
+
+
 #else
 
 
@@ -168,3 +978,33 @@ void Storage::readBytes(uint32_t firstIndex, uint8_t *data, uint32_t size)
 
 #endif
 
+
+#if !defined(LR_STORAGE_IMAGE) && !defined(LR_STORAGE_FLASH)
+
+
+uint32_t Storage::eraseSize() const
+{
+    return 0; // FRAM and EEPROM are overwritten byte by byte.
+}
+
+
+void Storage::eraseSector(uint32_t)
+{
+    // nothing to erase.
+}
+
+
+#endif
+
+
+#ifndef LR_STORAGE_BLOCK
+
+
+void Storage::flush()
+{
+    // nothing is buffered.
+}
+
+
+#endif
+
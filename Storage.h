@@ -23,7 +23,32 @@
 #include <Arduino.h>
 
 
+// The image storage is used by the host tools, see the `host` directory.
+// Uncomment the next line to use a SPI NOR flash chip instead of FRAM.
+//#define LR_STORAGE_FLASH
+// Uncomment the next line to use the blocks of a SD card instead of FRAM.
+//#define LR_STORAGE_BLOCK
+#if !defined(LR_STORAGE_IMAGE) && !defined(LR_STORAGE_FLASH) && !defined(LR_STORAGE_BLOCK)
 #define LR_STORAGE_FRAM
+#endif
+
+
+/// The chip select pin of the SPI flash chip.
+///
+#define LR_STORAGE_FLASH_CS_PIN 10
+
+/// The chip select pin of the SD card.
+///
+#define LR_STORAGE_BLOCK_CS_PIN 10
+
+
+/// The size of the read cache for the FRAM storage in bytes.
+///
+/// Reads smaller than this size are served from a single cached page,
+/// which is loaded with one I2C transfer. Must be a power of two.
+/// Comment this line to disable the cache and save the RAM.
+///
+#define LR_STORAGE_READ_CACHE_SIZE 32
 
 
 /// A storage class
@@ -32,6 +57,27 @@
 /// The software can use either the EEPROM to any attached memory to
 /// store the data.
 ///
+/// With `LR_STORAGE_IMAGE` defined, the storage is a memory image of one of
+/// the other storage types. This is used to run the log system on a host.
+///
+/// With FRAM, the size is detected from the device ID of the chips. Up to
+/// eight MB85RC chips of the same type on consecutive addresses are used as
+/// one linear memory area, including the large chips with 17 and 18 bit
+/// addressing. The bus is switched to the fast clock of the chips before
+/// each transfer, see `I2CBus`.
+///
+/// With `LR_STORAGE_FLASH`, a W25Q series NOR flash chip on the SPI bus is
+/// used. The size is detected from the JEDEC ID. A flash chip can only
+/// clear bits when writing, so every byte has to be erased before it is
+/// written again. Erasing works on whole sectors, see `eraseSize()`.
+///
+/// With `LR_STORAGE_BLOCK`, the raw 512 byte blocks of a SD card are used,
+/// without a file system. All writes go into a buffer for one block, which
+/// is only written to the card if another block is accessed, or by `flush()`.
+/// A block is written to a journal first, so a power loss while a block is
+/// rewritten can not destroy the data in it. With `LR_STORAGE_BLOCK_FILE`,
+/// a file replaces the card, which is used to run the storage on a host.
+///
 /// In a desktop application, this would be implemented using a virtual abstract
 /// interface, but here we just replace the implementation of the class
 /// depening on the used memory area.
@@ -82,5 +128,212 @@ public:
     /// @param size The number of bytes to write to the memory.
     ///
     void writeBytes(uint32_t firstIndex, const uint8_t *data, uint32_t size);
+    
+    /// Get the size of an erase sector.
+    ///
+    /// @return The size of a sector in bytes, or 0 if the storage can be
+    ///   overwritten without an erase.
+    ///
+    uint32_t eraseSize() const;
+    
+    /// Erase the sector which contains the given index.
+    ///
+    /// After the erase, all bytes of the sector read as 0xff. A flash chip
+    /// erases in the background, the next access waits until it is done.
+    /// This call is ignored by storages without erase sectors.
+    ///
+    void eraseSector(uint32_t index);
+    
+    /// Write all buffered data to the storage.
+    ///
+    /// This call is ignored by storages without a write buffer.
+    ///
+    void flush();
+    
+#ifdef LR_STORAGE_IMAGE
+    /// Set the memory image to use for this storage.
+    ///
+    /// @param image A pointer to the image, which has to stay valid while the storage is used.
+    /// @param size The size of the image in bytes.
+    /// @param eraseSize The size of an erase sector to simulate a flash chip, or 0.
+    ///
+    void setImage(uint8_t *image, uint32_t size, uint32_t eraseSize = 0);
+    
+    /// Set the memory image for all storages which are created afterwards.
+    ///
+    /// The simulator uses this to run the application with its own storage.
+    ///
+    static void setDefaultImage(uint8_t *image, uint32_t size, uint32_t eraseSize = 0);
+    
+    /// Get the number of sectors erased by all image storages in this thread.
+    ///
+    static uint64_t getEraseCount();
+    
+    /// Get the number of bytes written by all image storages in this thread, which
+    /// tried to set a bit which was not erased.
+    ///
+    /// A flash chip can not do this, the simulated flash keeps the cleared bits
+    /// like the chip. Always zero if no erase size is set.
+    ///
+    static uint64_t getEraseViolations();
+    
+    /// Get the number of bytes read and written by all image storages in this thread.
+    ///
+    static uint64_t getTransferredBytes();
+    
+    /// Get the number of reads by all image storages in this thread.
+    ///
+    /// On a chip, each read addresses the storage again, which costs
+    /// more than the transfer of a few bytes.
+    ///
+    static uint64_t getReadCount();
+    
+    /// Get the number of bus transfers by all image storages in this thread.
+    ///
+    /// The transfers are counted as if the image is a FRAM chip without the
+    /// read cache, which splits each read and write into transfers of at
+    /// most `ImageTransferSize` bytes.
+    ///
+    static uint64_t getTransferCount();
+    
+    /// The largest transfer of the FRAM storage in bytes.
+    ///
+    /// This is the buffer of the Wire library, minus the two bytes of
+    /// the memory address of a write.
+    ///
+    static const uint8_t ImageTransferSize = 30;
+#endif
+    
+#if defined(LR_STORAGE_FRAM) && defined(LR_STORAGE_READ_CACHE_SIZE)
+    /// Get the number of reads served from the read cache.
+    ///
+    inline uint32_t getCacheHits() const { return _cacheHits; }
+    
+    /// Get the number of reads which had to load a page into the read cache.
+    ///
+    inline uint32_t getCacheMisses() const { return _cacheMisses; }
+#endif
+    
+#ifdef LR_STORAGE_FRAM
+private:
+    /// Read multiple bytes directly from the chips.
+    ///
+    void readBytesFromChip(uint32_t firstIndex, uint8_t *data, uint32_t size);
+    
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    /// The value for the start of the cache if no page is cached.
+    ///
+    /// As pages are aligned to the cache size, this is never a valid page start.
+    ///
+    static const uint32_t InvalidCacheStart = 0xffffffff;
+    
+    /// Read multiple bytes using the read cache.
+    ///
+    void readBytesFromCache(uint32_t firstIndex, uint8_t *data, uint32_t size);
+    
+    /// Invalidate the cache if it overlaps the given range.
+    ///
+    void invalidateCache(uint32_t firstIndex, uint32_t size);
+#endif
+    
+    /// Get the I2C address of the chip for the given index.
+    ///
+    uint8_t getDeviceAddress(uint32_t index) const;
+    
+    /// Get the number of bytes which can be transferred from the given index
+    /// without crossing the address range of a single device address.
+    ///
+    uint32_t getBytesToBoundary(uint32_t index) const;
+    
+private:
+    uint8_t _chipCount; ///< The number of detected FRAM chips.
+    uint8_t _chipSizeShift; ///< The size of a single chip as power of two.
+#ifdef LR_STORAGE_READ_CACHE_SIZE
+    uint8_t _cache[LR_STORAGE_READ_CACHE_SIZE]; ///< The cached page.
+    uint32_t _cacheStart; ///< The index of the cached page, or `InvalidCacheStart`.
+    uint32_t _cacheHits; ///< The number of reads from the cache.
+    uint32_t _cacheMisses; ///< The number of page loads.
+#endif
+#endif
+
+#ifdef LR_STORAGE_BLOCK_FILE
+    /// Set the file which replaces the SD card for all block storages.
+    ///
+    /// @param file The descriptor of the file, opened for reading and writing.
+    ///
+    static void setBlockFile(int file);
+    
+    /// Simulate a power loss after a number of block writes.
+    ///
+    /// After the given number of block writes, the next write stops after
+    /// the given number of bytes, and all following writes are ignored.
+    ///
+    /// @param blockWrites The number of block writes before the power loss, or `0xffffffff` for no power loss.
+    /// @param tornBytes The number of bytes of the interrupted block write.
+    ///
+    static void setPowerLoss(uint32_t blockWrites, uint16_t tornBytes);
+#endif
+    
+#ifdef LR_STORAGE_BLOCK
+    /// Get the number of blocks read from the card.
+    ///
+    inline uint32_t getBlockReads() const { return _blockReads; }
+    
+    /// Get the number of blocks written to the card, including the journal.
+    ///
+    inline uint32_t getBlockWrites() const { return _blockWrites; }
+#endif
+    
+#ifdef LR_STORAGE_FLASH
+private:
+    /// Wait until the chip finished the last program or erase operation.
+    ///
+    void waitUntilReady();
+    
+    /// Select the chip and send a command with an address.
+    ///
+    void beginCommand(uint8_t command, uint32_t index);
+    
+private:
+    uint32_t _size; ///< The size of the chip in bytes.
+#endif
+
+#ifdef LR_STORAGE_BLOCK
+public:
+    /// The size of a block of the card.
+    ///
+    static const uint16_t BlockSize = 512;
+    
+private:
+    /// The value for the buffered block if no block is buffered.
+    ///
+    static const uint32_t InvalidBlock = 0xffffffff;
+    
+    /// Load a block into the buffer, writing the previous block if it was changed.
+    ///
+    /// @param block The index of the block.
+    /// @param isOverwritten If the whole block is overwritten, so it is not read from the card.
+    ///
+    void loadBlock(uint32_t block, bool isOverwritten);
+    
+    /// Restore the block in the journal, if the power failed while it was written.
+    ///
+    void recoverJournal();
+    
+private:
+    uint8_t _block[BlockSize]; ///< The buffered block.
+    uint32_t _blockIndex; ///< The index of the buffered block, or `InvalidBlock`.
+    bool _isBlockChanged; ///< If the buffered block has to be written to the card.
+    uint32_t _blockCount; ///< The number of blocks for the data, without the journal.
+    uint32_t _blockReads; ///< The number of blocks read from the card.
+    uint32_t _blockWrites; ///< The number of blocks written to the card.
+#endif
+
+#ifdef LR_STORAGE_IMAGE
+private:
+    uint8_t *_image; ///< The memory image.
+    uint32_t _imageSize; ///< The size of the memory image.
+    uint32_t _eraseSize; ///< The simulated erase sector size, or 0.
+#endif
 };
 
@@ -0,0 +1,78 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <avr/io.h>
+
+#include <stdint.h>
+
+
+/// A cost model for the transfers on the I2C bus.
+///
+/// A transfer to or from a FRAM chip starts with the device address and
+/// the two bytes of the memory address. A read sends the device address
+/// again, after a repeated start. Each byte takes nine clocks with the
+/// acknowledge, a start or stop one more clock. The model counts four
+/// address bytes and three start and stop conditions for each transfer,
+/// which is exact for a read and one byte too much for a write.
+///
+/// The Wire library handles each byte in an interrupt, and the bus waits
+/// while the processor runs it. This time does not change with the clock
+/// of the bus, so it limits the gain of a faster clock.
+///
+struct BusModel
+{
+    /// The address bytes of a transfer.
+    ///
+    static const uint32_t TransferAddressBytes = 4;
+    
+    /// The clocks of the start and stop conditions of a transfer.
+    ///
+    static const uint32_t TransferConditionClocks = 3;
+    
+    /// The cycles of the Wire library for each byte, on an ATmega328P.
+    ///
+    static const uint32_t DefaultByteCycles = 80;
+    
+    /// The cycles of the Wire library to start and end a transfer, on an ATmega328P.
+    ///
+    static const uint32_t DefaultTransferCycles = 400;
+    
+    uint32_t byteCycles; ///< The processor cycles of the Wire library for each byte, including the address bytes.
+    uint32_t transferCycles; ///< The processor cycles of the Wire library to start and end a transfer.
+    
+    /// Get the time of transfers on the bus.
+    ///
+    /// @param clock The clock of the bus in Hz.
+    /// @param transferCount The number of transfers.
+    /// @param byteCount The number of data bytes of all transfers.
+    /// @return The time in nanoseconds.
+    ///
+    inline uint64_t getNanos(uint32_t clock, uint64_t transferCount, uint64_t byteCount) const
+    {
+        const uint64_t allBytes = transferCount * TransferAddressBytes + byteCount;
+        const uint64_t busClocks = allBytes * 9 + transferCount * TransferConditionClocks;
+        const uint64_t cycles = allBytes * byteCycles + transferCount * transferCycles;
+        return static_cast<uint64_t>(busClocks * 1e9 / clock + cycles * 1e9 / F_CPU);
+    }
+};
+
+
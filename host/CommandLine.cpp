@@ -0,0 +1,44 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "CommandLine.h"
+
+
+#include <stdlib.h>
+
+
+bool parseNumber(const char *text, uint32_t &value)
+{
+    char *end;
+    const unsigned long number = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || number > 0xffffffffUL) {
+        return false;
+    }
+    value = static_cast<uint32_t>(number);
+    return true;
+}
+
+
+bool parseDouble(const char *text, double &value)
+{
+    char *end;
+    value = strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
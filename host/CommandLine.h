@@ -0,0 +1,43 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <stdint.h>
+
+
+// The parsers for the option arguments of the host tools.
+
+
+/// Parse an unsigned decimal number.
+///
+/// @param text The text, which has to contain the number only.
+/// @param value The parsed number.
+/// @return true on success, false if the text is no number or it is out of range.
+///
+bool parseNumber(const char *text, uint32_t &value);
+
+/// Parse a signed floating point number.
+///
+/// @param text The text, which has to contain the number only.
+/// @param value The parsed number.
+/// @return true on success, false if the text is no number.
+///
+bool parseDouble(const char *text, double &value);
@@ -0,0 +1,155 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "ExportFile.h"
+
+
+#include <RTClib.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+ExportReader::ExportReader()
+    : _file(0)
+{
+}
+
+
+ExportReader::~ExportReader()
+{
+    close();
+}
+
+
+bool ExportReader::open(const char *path)
+{
+    close();
+    if (strcmp(path, "-") == 0) {
+        _file = stdin;
+        return true;
+    }
+    _file = fopen(path, "r");
+    if (_file == 0) {
+        fprintf(stderr, "Could not open %s.\n", path);
+        return false;
+    }
+    return true;
+}
+
+
+void ExportReader::close()
+{
+    if (_file != 0 && _file != stdin) {
+        fclose(_file);
+    }
+    _file = 0;
+}
+
+
+bool ExportReader::read(ExportRecord &record)
+{
+    if (_file == 0) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), _file) != 0) {
+        char *firstComma = strchr(line, ',');
+        if (firstComma == 0) {
+            continue;
+        }
+        char *secondComma = strchr(firstComma + 1, ',');
+        if (secondComma == 0) {
+            continue;
+        }
+        *firstComma = '\0';
+        if (parseTime(line, record.time) &&
+            parseFixedPoint(firstComma + 1, record.temperature) &&
+            parseFixedPoint(secondComma + 1, record.humidity)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool parseFixedPoint(const char *text, int16_t &value)
+{
+    bool negative = false;
+    if (*text == '-') {
+        negative = true;
+        ++text;
+    }
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    int32_t result = 0;
+    while (*text >= '0' && *text <= '9' && result <= 32767) {
+        result = result * 10 + (*text - '0');
+        ++text;
+    }
+    result *= 10;
+    if (*text == '.') {
+        ++text;
+        if (*text >= '0' && *text <= '9') {
+            result += (*text - '0');
+            ++text;
+            if (*text >= '5' && *text <= '9') {
+                ++result;
+            }
+        }
+    }
+    if (result > 32767) {
+        return false;
+    }
+    value = static_cast<int16_t>(negative ? -result : result);
+    return true;
+}
+
+
+bool parseTime(const char *text, uint32_t &time)
+{
+    int year = 0, month = 1, day = 1, hour = 0, minute = 0, second = 0;
+    const int count = sscanf(text, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second);
+    if (count < 1 || year < 2000 || year > 2099) {
+        return false;
+    }
+    time = DateTime(year, month, day, hour, minute, second).unixtime();
+    return true;
+}
+
+
+std::string formatTime(uint32_t time)
+{
+    const DateTime dateTime(time);
+    char buffer[32];
+    sprintf(buffer, "%04d-%02d-%02d %02d:%02d:%02d", dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second());
+    return buffer;
+}
+
+
+std::string formatFixedPoint(int64_t value)
+{
+    const long long absolute = llabs(value);
+    char buffer[32];
+    sprintf(buffer, "%s%lld.%lld", value < 0 ? "-" : "", absolute / 10, absolute % 10);
+    return buffer;
+}
+
+
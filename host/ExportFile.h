@@ -0,0 +1,102 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+
+/// A single record from an exported log.
+///
+struct ExportRecord
+{
+    uint32_t time; ///< The time as unix time.
+    int16_t temperature; ///< The temperature in 1/10 degrees.
+    int16_t humidity; ///< The humidity in 1/10 percent.
+};
+
+
+/// A reader for the records exported by the `r` command of the logger.
+///
+/// The records are read one by one, so the size of the export does not
+/// matter. Lines which are not records, like the messages of the logger,
+/// are skipped.
+///
+class ExportReader
+{
+public:
+    /// ctor
+    ///
+    ExportReader();
+    
+    /// dtor
+    ///
+    ~ExportReader();
+    
+public:
+    /// Open an exported log.
+    ///
+    /// @param path The path to the file, or "-" for the standard input.
+    /// @return true on success, false on any error. Expects an error message on stderr.
+    ///
+    bool open(const char *path);
+    
+    /// Close the file.
+    ///
+    void close();
+    
+    /// Read the next record.
+    ///
+    /// @param record The record to fill.
+    /// @return true if a record was read, false at the end of the file.
+    ///
+    bool read(ExportRecord &record);
+    
+private:
+    ExportReader(const ExportReader&);
+    ExportReader& operator=(const ExportReader&);
+    
+private:
+    FILE *_file;
+};
+
+
+/// Parse a fixed point value like "-21.5" into 1/10 units.
+///
+/// Values with more decimal places are rounded.
+///
+bool parseFixedPoint(const char *text, int16_t &value);
+
+/// Parse a time like "2015-08-22 12:42:21", or a prefix like "2015-08-22".
+///
+bool parseTime(const char *text, uint32_t &time);
+
+/// Format a time in the format used by the logger.
+///
+std::string formatTime(uint32_t time);
+
+/// Format a fixed point value in 1/10 units.
+///
+std::string formatFixedPoint(int64_t value);
+
+
@@ -0,0 +1,142 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include <Arduino.h>
+#include <RTClib.h>
+
+
+HostSerial Serial;
+
+
+size_t HostSerial::print(long value, int base)
+{
+    if (base == DEC) {
+        return static_cast<size_t>(fprintf(_output, "%ld", value));
+    }
+    return print(static_cast<unsigned long>(value), base);
+}
+
+
+size_t HostSerial::print(unsigned long value, int base)
+{
+    if (base == HEX) {
+        return static_cast<size_t>(fprintf(_output, "%lX", value));
+    }
+    return static_cast<size_t>(fprintf(_output, "%lu", value));
+}
+
+
+namespace {
+
+    
+const uint32_t SECONDS_FROM_1970_TO_2000 = 946684800;
+const uint8_t DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    
+// Number of days since 2000/01/01, valid for 2001..2099
+//
+uint16_t date2days(uint16_t y, uint8_t m, uint8_t d)
+{
+    if (y >= 2000) {
+        y -= 2000;
+    }
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) {
+        days += DAYS_IN_MONTH[i - 1];
+    }
+    if (m > 2 && y % 4 == 0) {
+        ++days;
+    }
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+    
+long time2long(uint16_t days, uint8_t h, uint8_t m, uint8_t s)
+{
+    return ((days * 24L + h) * 60 + m) * 60 + s;
+}
+
+    
+}
+
+
+DateTime::DateTime(uint32_t t)
+{
+    t -= SECONDS_FROM_1970_TO_2000; // bring to 2000 timestamp from 1970
+    ss = t % 60;
+    t /= 60;
+    mm = t % 60;
+    t /= 60;
+    hh = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap;
+    for (yOff = 0; ; ++yOff) {
+        leap = yOff % 4 == 0;
+        if (days < 365 + leap) {
+            break;
+        }
+        days -= 365 + leap;
+    }
+    for (m = 1; ; ++m) {
+        uint8_t daysPerMonth = DAYS_IN_MONTH[m - 1];
+        if (leap && m == 2) {
+            ++daysPerMonth;
+        }
+        if (days < daysPerMonth) {
+            break;
+        }
+        days -= daysPerMonth;
+    }
+    d = days + 1;
+}
+
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+{
+    if (year >= 2000) {
+        year -= 2000;
+    }
+    yOff = year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+
+uint8_t DateTime::dayOfWeek() const
+{
+    const uint16_t day = date2days(yOff, m, d);
+    return (day + 6) % 7; // Jan 1, 2000 is a Saturday, i.e. returns 6
+}
+
+
+long DateTime::secondstime() const
+{
+    return time2long(date2days(yOff, m, d), hh, mm, ss);
+}
+
+
+uint32_t DateTime::unixtime() const
+{
+    const uint16_t days = date2days(yOff, m, d);
+    return time2long(days, hh, mm, ss) + SECONDS_FROM_1970_TO_2000;
+}
+
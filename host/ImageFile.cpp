@@ -0,0 +1,83 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "ImageFile.h"
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+ImageFile::ImageFile()
+    : _data(0), _size(0)
+{
+}
+
+
+ImageFile::~ImageFile()
+{
+    close();
+}
+
+
+bool ImageFile::open(const char *path, bool writable)
+{
+    close();
+    const int fd = ::open(path, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0 || status.st_size > 0xffffffffLL) {
+        fprintf(stderr, "Unsupported image size for %s.\n", path);
+        ::close(fd);
+        return false;
+    }
+    // A private writable mapping allows the log system to write into a
+    // read-only image, without changing the file.
+    const int protection = PROT_READ|PROT_WRITE;
+    const int flags = writable ? MAP_SHARED : MAP_PRIVATE;
+    void *data = mmap(0, static_cast<size_t>(status.st_size), protection, flags, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+    _data = static_cast<uint8_t*>(data);
+    _size = static_cast<uint32_t>(status.st_size);
+    return true;
+}
+
+
+void ImageFile::close()
+{
+    if (_data != 0) {
+        munmap(_data, _size);
+        _data = 0;
+        _size = 0;
+    }
+}
+
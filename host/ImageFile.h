@@ -0,0 +1,73 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/// A storage image file, mapped into memory.
+///
+/// The image is the verbatim content of the storage, as it is sent by the
+/// `i` command of the logger. Mapping the file allows the log system to
+/// read it at memory speed, without a system call per record.
+///
+class ImageFile
+{
+public:
+    /// ctor
+    ///
+    ImageFile();
+    
+    /// dtor
+    ///
+    ~ImageFile();
+    
+public:
+    /// Map an image file into memory.
+    ///
+    /// @param path The path to the image file.
+    /// @param writable If the changes to the image should be written to the file.
+    /// @return true on success, false on any error. Expects an error message on stderr.
+    ///
+    bool open(const char *path, bool writable = false);
+    
+    /// Unmap the image.
+    ///
+    void close();
+    
+    /// Get a pointer to the mapped image.
+    ///
+    inline uint8_t* data() const { return _data; }
+    
+    /// Get the size of the image in bytes.
+    ///
+    inline uint32_t size() const { return _size; }
+    
+private:
+    ImageFile(const ImageFile&);
+    ImageFile& operator=(const ImageFile&);
+    
+private:
+    uint8_t *_data;
+    uint32_t _size;
+};
+
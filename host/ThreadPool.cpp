@@ -0,0 +1,146 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "ThreadPool.h"
+
+
+namespace {
+
+    
+// The index of the worker running on the current thread, or -1.
+//
+thread_local int currentWorkerIndex = -1;
+    
+// The pool of the worker running on the current thread.
+//
+thread_local const ThreadPool *currentPool = 0;
+
+    
+}
+
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : _queuedTasks(0), _pendingTasks(0), _nextWorker(0), _stop(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+    for (unsigned i = 0; i < threadCount; ++i) {
+        _workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (unsigned i = 0; i < threadCount; ++i) {
+        _threads.push_back(std::thread(&ThreadPool::run, this, i));
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _taskCondition.notify_all();
+    for (size_t i = 0; i < _threads.size(); ++i) {
+        _threads[i].join();
+    }
+}
+
+
+void ThreadPool::submit(const Task &task)
+{
+    unsigned index;
+    if (currentPool == this) {
+        index = static_cast<unsigned>(currentWorkerIndex);
+    } else {
+        index = _nextWorker++ % _workers.size();
+    }
+    ++_pendingTasks;
+    {
+        std::lock_guard<std::mutex> lock(_workers[index]->mutex);
+        _workers[index]->tasks.push_back(task);
+    }
+    ++_queuedTasks;
+    // Lock the mutex to make sure a worker going to sleep sees the new task.
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _taskCondition.notify_one();
+}
+
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this]{ return _pendingTasks == 0; });
+}
+
+
+bool ThreadPool::takeTask(unsigned index, Task &task)
+{
+    {
+        Worker &worker = *_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --_queuedTasks;
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < _workers.size(); ++offset) {
+        Worker &victim = *_workers[(index + offset) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --_queuedTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void ThreadPool::run(unsigned index)
+{
+    currentWorkerIndex = static_cast<int>(index);
+    currentPool = this;
+    while (true) {
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            if (--_pendingTasks == 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _doneCondition.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _taskCondition.wait(lock, [this]{ return _stop || _queuedTasks > 0; });
+        if (_stop && _queuedTasks == 0) {
+            return;
+        }
+    }
+}
+
@@ -0,0 +1,104 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/// A simple work-stealing thread pool for the host tools.
+///
+/// Every worker has its own queue. A worker takes new tasks from the back
+/// of its own queue, and steals from the front of the other queues if its
+/// own queue is empty. Tasks submitted from a worker are added to the queue
+/// of this worker, which keeps related work on the same thread.
+///
+class ThreadPool
+{
+public:
+    /// A single task.
+    ///
+    typedef std::function<void()> Task;
+    
+public:
+    /// Create a new pool.
+    ///
+    /// @param threadCount The number of worker threads, 0 to use one per core.
+    ///
+    explicit ThreadPool(unsigned threadCount = 0);
+    
+    /// Wait for all tasks and stop the workers.
+    ///
+    ~ThreadPool();
+    
+public:
+    /// Get the number of worker threads.
+    ///
+    inline unsigned threadCount() const { return static_cast<unsigned>(_threads.size()); }
+    
+    /// Submit a new task.
+    ///
+    /// This can be called from any thread, including from running tasks.
+    ///
+    void submit(const Task &task);
+    
+    /// Wait until all submitted tasks are finished.
+    ///
+    void wait();
+    
+private:
+    /// The queue of a single worker.
+    ///
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+    
+    /// The main loop of a worker thread.
+    ///
+    void run(unsigned index);
+    
+    /// Take a task from the own queue, or steal one from another queue.
+    ///
+    bool takeTask(unsigned index, Task &task);
+    
+private:
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex; ///< Protects the sleep of idle workers and waiting callers.
+    std::condition_variable _taskCondition; ///< Signals new tasks or the stop.
+    std::condition_variable _doneCondition; ///< Signals that all tasks are finished.
+    std::atomic<size_t> _queuedTasks; ///< The number of tasks in all queues.
+    std::atomic<size_t> _pendingTasks; ///< The number of queued and running tasks.
+    std::atomic<unsigned> _nextWorker; ///< The queue for tasks from other threads.
+    bool _stop;
+};
+
@@ -0,0 +1,138 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// A minimal replacement of the Arduino core for the host tools.
+//
+// It provides just enough to compile the storage independent parts
+// of the logger, like the log system, on a desktop computer. The pin
+// and time functions are only implemented by the simulator `lrsim`,
+// which runs the application against a virtual clock.
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The host tools expect a little endian system, like the AVR."
+#endif
+
+
+// Program memory is regular memory on the host.
+#define PROGMEM
+#define PSTR(s) (s)
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+#define pgm_read_word(address) (*reinterpret_cast<const uint16_t*>(address))
+#define pgm_read_dword(address) (*reinterpret_cast<const uint32_t*>(address))
+#define pgm_read_ptr(address) (*reinterpret_cast<void* const*>(address))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define DEC 10
+#define HEX 16
+
+#define SERIAL_TX_BUFFER_SIZE 64
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define B010 2
+#define B0001 1
+#define B0010 2
+#define B0100 4
+#define B1000 8
+
+
+template<typename T>
+inline T min(T a, T b) { return a < b ? a : b; }
+
+template<typename T>
+inline T max(T a, T b) { return a > b ? a : b; }
+
+
+// The functions of the Arduino core, implemented by the simulator.
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void delay(unsigned long milliseconds);
+void delayMicroseconds(unsigned int microseconds);
+unsigned long millis();
+unsigned long micros();
+
+
+#include <avr/io.h>
+
+
+/// The serial interface, which writes to the standard output.
+///
+/// The output is buffered by stdio, there is no system call per record.
+///
+class HostSerial
+{
+public:
+    HostSerial() : _output(stdout) {}
+    
+    /// Redirect the output, e.g. to discard the messages of the application.
+    ///
+    void setOutput(FILE *output) { _output = output; }
+    
+    void begin(unsigned long) {}
+    void flush() { fflush(_output); }
+    int available() { return 0; }
+    int read() { return -1; }
+    int availableForWrite() { return SERIAL_TX_BUFFER_SIZE - 1; } // The output is never blocked.
+    
+    size_t write(uint8_t value) { return fwrite(&value, 1, 1, _output); }
+    size_t write(const uint8_t *data, size_t size) { return fwrite(data, 1, size, _output); }
+    
+    size_t print(const char *text) { return fputs(text, _output) >= 0 ? strlen(text) : 0; }
+    size_t print(const __FlashStringHelper *text) { return print(reinterpret_cast<const char*>(text)); }
+    size_t print(char value) { return write(static_cast<uint8_t>(value)); }
+    size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+    size_t print(unsigned int value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2) { const int size = fprintf(_output, "%.*f", digits, value); return size > 0 ? size : 0; }
+    
+    template<typename T>
+    size_t println(T value) { const size_t size = print(value); return size + println(); }
+    template<typename T>
+    size_t println(T value, int base) { const size_t size = print(value, base); return size + println(); }
+    size_t println() { return print("\r\n"); }
+    
+private:
+    FILE *_output;
+};
+
+extern HostSerial Serial;
+
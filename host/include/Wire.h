@@ -0,0 +1,46 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// A replacement of the Wire library for the simulator `lrsim`.
+//
+// The simulated devices are not accessed over a bus, so there is
+// nothing to initialize. The clock is kept, to check which device
+// the application selected.
+
+
+#include <Arduino.h>
+
+
+class TwoWire
+{
+public:
+    TwoWire() : _clock(100000) {}
+    void begin() { _clock = 100000; }
+    void setClock(uint32_t clock) { _clock = clock; }
+    uint32_t getClock() const { return _clock; }
+    
+private:
+    uint32_t _clock;
+};
+
+extern TwoWire Wire;
+
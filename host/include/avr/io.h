@@ -0,0 +1,68 @@
+#pragma once
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// The registers of the ATmega328P, which are used by the application.
+//
+// The simulator `lrsim` implements them as plain variables and reads the
+// timer configuration from them.
+
+
+#include <stdint.h>
+
+
+#define F_CPU 16000000UL
+
+#define _BV(bit) (1 << (bit))
+
+
+extern volatile uint8_t SMCR; ///< Sleep mode control register.
+extern volatile uint8_t ASSR; ///< Asynchronous status register.
+extern volatile uint8_t TCCR2A; ///< Timer/counter 2 control register A.
+extern volatile uint8_t TCCR2B; ///< Timer/counter 2 control register B.
+extern volatile uint8_t TCNT2; ///< Timer/counter 2.
+extern volatile uint8_t OCR2A; ///< Timer/counter 2 output compare register A.
+extern volatile uint8_t OCR2B; ///< Timer/counter 2 output compare register B.
+extern volatile uint8_t TIMSK2; ///< Timer/counter 2 interrupt mask register.
+extern volatile uint8_t UCSR0A; ///< USART 0 control and status register A.
+
+
+// SMCR
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+
+// TCCR2A
+#define WGM20 0
+#define WGM21 1
+
+// TCCR2B
+#define CS20 0
+#define CS21 1
+#define CS22 2
+
+// TIMSK2
+#define TOIE2 0
+
+// UCSR0A
+#define TXC0 6
+
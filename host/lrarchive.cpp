@@ -0,0 +1,533 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// Host tool for a columnar archive of logged records.
+//
+// The archive stores the time, temperature and humidity in separate
+// arrays, sorted by time, together with a zone map for every block of
+// records. The zone map keeps the time range, the count and the minimum,
+// maximum and sum of each value of the block. A query maps the archive into
+// memory, finds the time range with a binary search and uses the zone maps
+// of all blocks which are completely inside one group, so only blocks at the
+// group borders are scanned.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrarchive
+//       host/lrarchive.cpp host/ExportFile.cpp host/ImageFile.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrarchive build <archive> <input>...
+//       Create an archive from exported records or storage images (*.bin).
+//   lrarchive info <archive>
+//       Show information about the archive.
+//   lrarchive query <archive> [options]
+//       --from <time>          The first time to include, "YYYY-MM-DD hh:mm:ss" or a prefix.
+//       --to <time>            The first time to exclude.
+//       --group hour|day|all   The size of the groups, default is day.
+//       --value temperature|humidity
+//       --above <value>        Count the values above this threshold.
+//       --below <value>        Count the values below this threshold.
+//
+
+
+#include "ExportFile.h"
+#include "ImageFile.h"
+
+#include "ConfigArea.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <RTClib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace {
+
+
+// The number of records in one block of the archive.
+//
+const uint32_t ARCHIVE_BLOCK_SIZE = 4096;
+
+// The number of bytes reserved for the configuration, as used by the application.
+//
+const uint32_t RESERVED_FOR_CONFIG = CONFIG_AREA_SIZE;
+
+// The magic value at the start of the archive.
+//
+const char ARCHIVE_MAGIC[8] = {'L', 'R', 'A', 'R', 'C', 'H', 'V', '1'};
+
+    
+// The values stored in the archive.
+//
+enum Value : uint8_t {
+    Temperature = 0,
+    Humidity = 1,
+    ValueCount = 2
+};
+
+    
+// The header at the start of the archive.
+//
+// All offsets are from the start of the file and aligned to 8 bytes.
+//
+struct ArchiveHeader
+{
+    char magic[8];
+    uint32_t blockSize; // The number of records per block.
+    uint32_t blockCount; // The number of blocks.
+    uint64_t recordCount; // The number of records.
+    uint64_t timeOffset; // uint32_t unix time for each record, sorted.
+    uint64_t valueOffset[ValueCount]; // int16_t values in 1/10 units for each record.
+    uint64_t zoneMapOffset; // One `ZoneMap` for each block.
+};
+
+    
+// The summary of one block of records.
+//
+struct ZoneMap
+{
+    uint32_t firstTime;
+    uint32_t lastTime;
+    uint32_t count;
+    int16_t minimum[ValueCount];
+    int16_t maximum[ValueCount];
+    int64_t sum[ValueCount];
+};
+
+    
+// A single record while building the archive.
+//
+struct Record
+{
+    uint32_t time;
+    int16_t value[ValueCount];
+    
+    bool operator<(const Record &other) const { return time < other.time; }
+};
+
+    
+// The aggregate of the values in one group.
+//
+struct Aggregate
+{
+    uint64_t count;
+    int16_t minimum;
+    int16_t maximum;
+    int64_t sum;
+    uint64_t above;
+    uint64_t below;
+};
+
+    
+// The parameters of a query.
+//
+struct Query
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t groupSize; // 0 for a single group.
+    Value value;
+    bool hasAbove;
+    int16_t above;
+    bool hasBelow;
+    int16_t below;
+};
+
+    
+// Read the records exported by the logger.
+//
+bool readExport(const char *path, std::vector<Record> &records)
+{
+    ExportReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    ExportRecord exportRecord;
+    while (reader.read(exportRecord)) {
+        Record record;
+        record.time = exportRecord.time;
+        record.value[Temperature] = exportRecord.temperature;
+        record.value[Humidity] = exportRecord.humidity;
+        records.push_back(record);
+    }
+    return true;
+}
+
+    
+// Read the records from a storage image, using the log system.
+//
+bool readImage(const char *path, std::vector<Record> &records)
+{
+    ImageFile imageFile;
+    if (!imageFile.open(path)) {
+        return false;
+    }
+    Storage storage;
+    storage.setImage(imageFile.data(), imageFile.size());
+    LogSystem logSystem(RESERVED_FOR_CONFIG, &storage);
+    logSystem.begin();
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        if (view.isMeasurement()) {
+            Record record;
+            record.time = view.getUnixtime();
+            record.value[Temperature] = view.getValue(LogChannelTemperature);
+            record.value[Humidity] = view.getValue(LogChannelHumidity);
+            records.push_back(record);
+        }
+    }
+    return true;
+}
+
+    
+inline uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+    
+template<typename T>
+void writeAt(FILE *file, uint64_t offset, const T *data, size_t count)
+{
+    fseek(file, static_cast<long>(offset), SEEK_SET);
+    fwrite(data, sizeof(T), count, file);
+}
+
+    
+// Build a new archive.
+//
+int buildArchive(const char *archivePath, int inputCount, char *inputPaths[])
+{
+    std::vector<Record> records;
+    for (int i = 0; i < inputCount; ++i) {
+        const std::string path = inputPaths[i];
+        const bool isImage = path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+        if (!(isImage ? readImage(path.c_str(), records) : readExport(path.c_str(), records))) {
+            return 1;
+        }
+    }
+    // The records of each run are already in order, this merges the inputs.
+    std::stable_sort(records.begin(), records.end());
+    
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.blockSize = ARCHIVE_BLOCK_SIZE;
+    header.recordCount = records.size();
+    header.blockCount = static_cast<uint32_t>((records.size() + ARCHIVE_BLOCK_SIZE - 1) / ARCHIVE_BLOCK_SIZE);
+    header.timeOffset = alignOffset(sizeof(ArchiveHeader));
+    header.valueOffset[Temperature] = alignOffset(header.timeOffset + sizeof(uint32_t) * records.size());
+    header.valueOffset[Humidity] = alignOffset(header.valueOffset[Temperature] + sizeof(int16_t) * records.size());
+    header.zoneMapOffset = alignOffset(header.valueOffset[Humidity] + sizeof(int16_t) * records.size());
+    
+    std::vector<uint32_t> times(records.size());
+    std::vector<int16_t> values[ValueCount];
+    for (uint8_t v = 0; v < ValueCount; ++v) {
+        values[v].resize(records.size());
+    }
+    std::vector<ZoneMap> zoneMaps(header.blockCount);
+    for (size_t i = 0; i < records.size(); ++i) {
+        times[i] = records[i].time;
+        ZoneMap &zoneMap = zoneMaps[i / ARCHIVE_BLOCK_SIZE];
+        if (i % ARCHIVE_BLOCK_SIZE == 0) {
+            zoneMap.firstTime = records[i].time;
+            zoneMap.count = 0;
+            for (uint8_t v = 0; v < ValueCount; ++v) {
+                zoneMap.minimum[v] = records[i].value[v];
+                zoneMap.maximum[v] = records[i].value[v];
+                zoneMap.sum[v] = 0;
+            }
+        }
+        zoneMap.lastTime = records[i].time;
+        ++zoneMap.count;
+        for (uint8_t v = 0; v < ValueCount; ++v) {
+            const int16_t value = records[i].value[v];
+            values[v][i] = value;
+            zoneMap.minimum[v] = std::min(zoneMap.minimum[v], value);
+            zoneMap.maximum[v] = std::max(zoneMap.maximum[v], value);
+            zoneMap.sum[v] += value;
+        }
+    }
+    
+    FILE *file = fopen(archivePath, "wb");
+    if (file == 0) {
+        fprintf(stderr, "Could not create %s.\n", archivePath);
+        return 1;
+    }
+    writeAt(file, 0, &header, 1);
+    writeAt(file, header.timeOffset, times.data(), times.size());
+    for (uint8_t v = 0; v < ValueCount; ++v) {
+        writeAt(file, header.valueOffset[v], values[v].data(), values[v].size());
+    }
+    writeAt(file, header.zoneMapOffset, zoneMaps.data(), zoneMaps.size());
+    if (ferror(file) || fclose(file) != 0) {
+        fprintf(stderr, "Could not write %s.\n", archivePath);
+        return 1;
+    }
+    fprintf(stderr, "Archived %zu records in %u blocks.\n", records.size(), header.blockCount);
+    return 0;
+}
+
+    
+// A memory mapped archive.
+//
+class Archive
+{
+public:
+    bool open(const char *path)
+    {
+        if (!_file.open(path)) {
+            return false;
+        }
+        if (_file.size() < sizeof(ArchiveHeader)) {
+            fprintf(stderr, "%s is not an archive.\n", path);
+            return false;
+        }
+        _header = reinterpret_cast<const ArchiveHeader*>(_file.data());
+        if (memcmp(_header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+            _header->zoneMapOffset + sizeof(ZoneMap) * _header->blockCount > _file.size()) {
+            fprintf(stderr, "%s is not an archive.\n", path);
+            return false;
+        }
+        return true;
+    }
+    
+    const ArchiveHeader& header() const { return *_header; }
+    const uint32_t* times() const { return reinterpret_cast<const uint32_t*>(_file.data() + _header->timeOffset); }
+    const int16_t* values(Value value) const { return reinterpret_cast<const int16_t*>(_file.data() + _header->valueOffset[value]); }
+    const ZoneMap* zoneMaps() const { return reinterpret_cast<const ZoneMap*>(_file.data() + _header->zoneMapOffset); }
+    
+private:
+    ImageFile _file;
+    const ArchiveHeader *_header;
+};
+
+    
+int showInfo(const char *archivePath)
+{
+    Archive archive;
+    if (!archive.open(archivePath)) {
+        return 1;
+    }
+    const ArchiveHeader &header = archive.header();
+    printf("Records: %llu\n", static_cast<unsigned long long>(header.recordCount));
+    printf("Blocks: %u of %u records\n", header.blockCount, header.blockSize);
+    if (header.recordCount > 0) {
+        printf("First: %s\n", formatTime(archive.times()[0]).c_str());
+        printf("Last: %s\n", formatTime(archive.times()[header.recordCount - 1]).c_str());
+    }
+    return 0;
+}
+
+    
+inline uint32_t getGroupStart(uint32_t time, uint32_t groupSize)
+{
+    return groupSize == 0 ? 0 : time - (time % groupSize);
+}
+
+    
+void writeAggregate(uint32_t groupStart, const Aggregate &aggregate, const Query &query)
+{
+    if (aggregate.count == 0) {
+        return;
+    }
+    printf("%s,%llu,%s,%s,%.2f", query.groupSize == 0 ? "all" : formatTime(groupStart).c_str(),
+        static_cast<unsigned long long>(aggregate.count),
+        formatFixedPoint(aggregate.minimum).c_str(), formatFixedPoint(aggregate.maximum).c_str(),
+        static_cast<double>(aggregate.sum) / aggregate.count / 10.0);
+    if (query.hasAbove) {
+        printf(",%llu", static_cast<unsigned long long>(aggregate.above));
+    }
+    if (query.hasBelow) {
+        printf(",%llu", static_cast<unsigned long long>(aggregate.below));
+    }
+    printf("\n");
+}
+
+    
+// Run a query on the archive.
+//
+int runQuery(const Archive &archive, const Query &query)
+{
+    const ArchiveHeader &header = archive.header();
+    const uint32_t *times = archive.times();
+    const int16_t *values = archive.values(query.value);
+    const ZoneMap *zoneMaps = archive.zoneMaps();
+    // The times are sorted, which makes the selected range exact.
+    const uint64_t first = std::lower_bound(times, times + header.recordCount, query.from) - times;
+    const uint64_t last = std::lower_bound(times, times + header.recordCount, query.to) - times;
+    
+    printf("group,count,minimum,maximum,mean%s%s\n", query.hasAbove ? ",above" : "", query.hasBelow ? ",below" : "");
+    uint64_t summarizedBlocks = 0;
+    uint64_t scannedRecords = 0;
+    Aggregate aggregate;
+    memset(&aggregate, 0, sizeof(aggregate));
+    uint32_t groupStart = 0;
+    uint64_t index = first;
+    while (index < last) {
+        const uint32_t recordGroup = getGroupStart(times[index], query.groupSize);
+        if (aggregate.count == 0 || recordGroup != groupStart) {
+            writeAggregate(groupStart, aggregate, query);
+            memset(&aggregate, 0, sizeof(aggregate));
+            groupStart = recordGroup;
+        }
+        // Use the zone map for a whole block in the range and in this group.
+        const uint64_t block = index / header.blockSize;
+        const ZoneMap &zoneMap = zoneMaps[block];
+        const bool isBlockStart = (index % header.blockSize) == 0;
+        if (isBlockStart && index + zoneMap.count <= last && getGroupStart(zoneMap.lastTime, query.groupSize) == groupStart) {
+            const bool needsScanAbove = query.hasAbove && zoneMap.minimum[query.value] <= query.above && zoneMap.maximum[query.value] > query.above;
+            const bool needsScanBelow = query.hasBelow && zoneMap.minimum[query.value] < query.below && zoneMap.maximum[query.value] >= query.below;
+            if (!needsScanAbove && !needsScanBelow) {
+                if (aggregate.count == 0) {
+                    aggregate.minimum = zoneMap.minimum[query.value];
+                    aggregate.maximum = zoneMap.maximum[query.value];
+                } else {
+                    aggregate.minimum = std::min(aggregate.minimum, zoneMap.minimum[query.value]);
+                    aggregate.maximum = std::max(aggregate.maximum, zoneMap.maximum[query.value]);
+                }
+                aggregate.count += zoneMap.count;
+                aggregate.sum += zoneMap.sum[query.value];
+                if (query.hasAbove && zoneMap.minimum[query.value] > query.above) {
+                    aggregate.above += zoneMap.count;
+                }
+                if (query.hasBelow && zoneMap.maximum[query.value] < query.below) {
+                    aggregate.below += zoneMap.count;
+                }
+                index += zoneMap.count;
+                ++summarizedBlocks;
+                continue;
+            }
+        }
+        // Scan the records up to the end of this block or group.
+        const uint64_t blockEnd = std::min(last, (block + 1) * header.blockSize);
+        for (; index < blockEnd && getGroupStart(times[index], query.groupSize) == groupStart; ++index) {
+            const int16_t value = values[index];
+            if (aggregate.count == 0) {
+                aggregate.minimum = value;
+                aggregate.maximum = value;
+            } else {
+                aggregate.minimum = std::min(aggregate.minimum, value);
+                aggregate.maximum = std::max(aggregate.maximum, value);
+            }
+            ++aggregate.count;
+            aggregate.sum += value;
+            aggregate.above += (query.hasAbove && value > query.above);
+            aggregate.below += (query.hasBelow && value < query.below);
+            ++scannedRecords;
+        }
+    }
+    writeAggregate(groupStart, aggregate, query);
+    const uint64_t blockCount = header.blockCount;
+    fprintf(stderr, "Selected %llu records, %llu of %llu blocks from zone maps, %llu records scanned.\n",
+        static_cast<unsigned long long>(last - first), static_cast<unsigned long long>(summarizedBlocks),
+        static_cast<unsigned long long>(blockCount), static_cast<unsigned long long>(scannedRecords));
+    return 0;
+}
+
+    
+int queryArchive(const char *archivePath, int argumentCount, char *arguments[])
+{
+    Query query;
+    query.from = 0;
+    query.to = 0xffffffff;
+    query.groupSize = 86400;
+    query.value = Temperature;
+    query.hasAbove = false;
+    query.above = 0;
+    query.hasBelow = false;
+    query.below = 0;
+    for (int i = 0; i + 1 < argumentCount; i += 2) {
+        const std::string option = arguments[i];
+        const char *argument = arguments[i + 1];
+        bool valid = true;
+        if (option == "--from") {
+            valid = parseTime(argument, query.from);
+        } else if (option == "--to") {
+            valid = parseTime(argument, query.to);
+        } else if (option == "--group") {
+            const std::string group = argument;
+            query.groupSize = (group == "hour") ? 3600 : (group == "day") ? 86400 : 0;
+            valid = (group == "hour" || group == "day" || group == "all");
+        } else if (option == "--value") {
+            const std::string value = argument;
+            query.value = (value == "humidity") ? Humidity : Temperature;
+            valid = (value == "humidity" || value == "temperature");
+        } else if (option == "--above") {
+            query.hasAbove = true;
+            valid = parseFixedPoint(argument, query.above);
+        } else if (option == "--below") {
+            query.hasBelow = true;
+            valid = parseFixedPoint(argument, query.below);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+    if (argumentCount % 2 != 0) {
+        fprintf(stderr, "Missing value for option %s\n", arguments[argumentCount - 1]);
+        return 2;
+    }
+    Archive archive;
+    if (!archive.open(archivePath)) {
+        return 1;
+    }
+    return runQuery(archive, query);
+}
+
+    
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage:\n"
+        "  lrarchive build <archive> <input>...\n"
+        "  lrarchive info <archive>\n"
+        "  lrarchive query <archive> [--from <time>] [--to <time>] [--group hour|day|all]\n"
+        "      [--value temperature|humidity] [--above <value>] [--below <value>]\n");
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 4 && strcmp(argv[1], "build") == 0) {
+        return buildArchive(argv[2], argc - 3, argv + 3);
+    } else if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return showInfo(argv[2]);
+    } else if (argc >= 3 && strcmp(argv[1], "query") == 0) {
+        return queryArchive(argv[2], argc - 3, argv + 3);
+    }
+    printUsage();
+    return 2;
+}
+
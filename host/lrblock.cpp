@@ -0,0 +1,351 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to benchmark the block storage of the SD card.
+//
+// The tool runs the log system on the block storage, with a file in place
+// of the card. It appends records and writes the buffered block after a
+// fixed number of records, like the flush task of the application. The
+// file is created with the given size, an existing file is overwritten.
+//
+// The benchmark reports the write amplification, which is the number of
+// bytes written to the file for each byte of the records, and the time of
+// the appends and the flushes. With `--sync`, each flush waits until the
+// data is on the disk.
+//
+// With `--crashes`, the benchmark is repeated with a power loss at random
+// block writes, which interrupts the write of a block. After each power
+// loss, the log is read again and all records written before the last
+// completed flush have to be present.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_BLOCK -DLR_STORAGE_BLOCK_FILE -Ihost/include -I. -o lrblock
+//       host/lrblock.cpp host/CommandLine.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrblock [options] <file>
+//       --records <count>   The number of records to append, default is 100000.
+//       --flush <records>   The number of records between two flushes, default is 60.
+//       --size <bytes>      The size of the file, default is 16777216.
+//       --crashes <count>   The number of simulated power losses, default is 0.
+//       --sync              Wait for the disk after each flush.
+//
+
+
+#include "CommandLine.h"
+
+#include "ConfigArea.h"
+#include "InternalLogRecord.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+
+namespace {
+
+
+// The time of the first record.
+//
+const uint32_t FIRST_RECORD_TIME = 1500000000;
+
+// The interval between two records in seconds.
+//
+const uint32_t RECORD_INTERVAL = 60;
+
+
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t recordCount;
+    uint32_t flushRecords;
+    uint32_t size;
+    uint32_t crashCount;
+    bool isSync;
+    const char *path;
+};
+
+
+// The result of one run.
+//
+struct RunResult
+{
+    uint32_t appendedCount; // The number of appended records.
+    uint32_t committedCount; // The number of records before the last completed flush.
+    uint32_t flushCount; // The number of flushes.
+    uint32_t blockWrites; // The number of blocks written.
+    uint64_t appendNanos; // The time of all appends.
+    uint64_t maximumAppendNanos; // The longest append.
+    uint64_t flushNanos; // The time of all flushes.
+    uint64_t maximumFlushNanos; // The longest flush.
+};
+
+
+// Get a monotonic time in nanoseconds.
+//
+uint64_t getNanos()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+
+// Create the record with the given number.
+//
+LogRecord getTestRecord(uint32_t number)
+{
+    return LogRecord(DateTime(FIRST_RECORD_TIME + number * RECORD_INTERVAL),
+        static_cast<int16_t>(number % 500), static_cast<int16_t>(number % 1000));
+}
+
+
+// Create an empty file with the given size.
+//
+// @return The file descriptor, or -1 on any error.
+//
+int createFile(const char *path, uint32_t size)
+{
+    const int file = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (file < 0) {
+        fprintf(stderr, "Could not create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(file, size) != 0) {
+        fprintf(stderr, "Could not resize %s: %s\n", path, strerror(errno));
+        close(file);
+        return -1;
+    }
+    return file;
+}
+
+
+// Format the storage and append the records, like the application.
+//
+// The records are written after a session record. A power loss stops
+// all writes to the file, but the run continues until the end.
+//
+// @param powerLossWrite The number of block writes for the records before the power loss, or `0xffffffff`.
+// @param tornBytes The number of bytes of the interrupted block write.
+//
+bool run(const Options &options, int file, uint32_t powerLossWrite, uint16_t tornBytes, RunResult &result)
+{
+    memset(&result, 0, sizeof(RunResult));
+    Storage storage;
+    if (!storage.begin()) {
+        return false;
+    }
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    logSystem.format();
+    if (!logSystem.appendSession(DateTime(FIRST_RECORD_TIME), RECORD_INTERVAL)) {
+        return false;
+    }
+    storage.flush();
+    const uint32_t initialWrites = storage.getBlockWrites();
+    Storage::setPowerLoss(powerLossWrite, tornBytes);
+    for (uint32_t number = 0; number < options.recordCount; ++number) {
+        if (logSystem.currentNumberOfRecords() >= logSystem.maximumNumberOfRecords()) {
+            break; // The next record would overwrite the session records in the ring.
+        }
+        const uint64_t appendStart = getNanos();
+        if (!logSystem.appendRecord(getTestRecord(number))) {
+            break;
+        }
+        const uint64_t appendNanos = getNanos() - appendStart;
+        result.appendNanos += appendNanos;
+        if (appendNanos > result.maximumAppendNanos) {
+            result.maximumAppendNanos = appendNanos;
+        }
+        ++result.appendedCount;
+        if (result.appendedCount % options.flushRecords == 0) {
+            const uint64_t flushStart = getNanos();
+            storage.flush();
+            if (options.isSync) {
+                fdatasync(file);
+            }
+            const uint64_t flushNanos = getNanos() - flushStart;
+            result.flushNanos += flushNanos;
+            if (flushNanos > result.maximumFlushNanos) {
+                result.maximumFlushNanos = flushNanos;
+            }
+            ++result.flushCount;
+            if (storage.getBlockWrites() - initialWrites <= powerLossWrite) {
+                result.committedCount = result.appendedCount;
+            }
+        }
+    }
+    result.blockWrites = storage.getBlockWrites() - initialWrites;
+    Storage::setPowerLoss(0xffffffff, 0);
+    return true;
+}
+
+
+// Check the records in the file after a power loss.
+//
+// @return The number of records found, or -1 if a committed record is missing.
+//
+int64_t verify(const RunResult &result)
+{
+    Storage storage;
+    if (!storage.begin()) {
+        return -1;
+    }
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    if (logSystem.currentNumberOfSessions() != 1) {
+        return -1;
+    }
+    // The session record and its link record are followed by the records.
+    uint32_t foundCount = 0;
+    for (const LogRecordView &view : logSystem.getRecords(2, logSystem.currentNumberOfRecords())) {
+        const LogRecord logRecord = view.getLogRecord();
+        const LogRecord expectedRecord = getTestRecord(view.getIndex() - 2);
+        if (logRecord.isNull() ||
+            logRecord.getDateTime().unixtime() != expectedRecord.getDateTime().unixtime() ||
+            memcmp(logRecord.getValues(), expectedRecord.getValues(), sizeof(int16_t) * LogRecordSchema::ChannelCount) != 0) {
+            break;
+        }
+        ++foundCount;
+    }
+    if (foundCount < result.committedCount) {
+        return -1;
+    }
+    return foundCount;
+}
+
+
+// Print the usage of the tool.
+//
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage: lrblock [--records <count>] [--flush <records>] [--size <bytes>] [--crashes <count>] [--sync] <file>\n");
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.recordCount = 100000;
+    options.flushRecords = 60;
+    options.size = 16777216;
+    options.crashCount = 0;
+    options.isSync = false;
+    options.path = 0;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option == "--sync") {
+            options.isSync = true;
+            continue;
+        }
+        if (option.compare(0, 2, "--") != 0 && options.path == 0 && argumentIndex + 1 == argc) {
+            options.path = argv[argumentIndex];
+            continue;
+        }
+        if (argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--records") {
+            valid = parseNumber(argument, options.recordCount) && options.recordCount > 0;
+        } else if (option == "--flush") {
+            valid = parseNumber(argument, options.flushRecords) && options.flushRecords > 0;
+        } else if (option == "--size") {
+            valid = parseNumber(argument, options.size) && options.size >= 4 * Storage::BlockSize + CONFIG_AREA_SIZE;
+        } else if (option == "--crashes") {
+            valid = parseNumber(argument, options.crashCount);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+    if (options.path == 0) {
+        printUsage();
+        return 2;
+    }
+
+    const int file = createFile(options.path, options.size);
+    if (file < 0) {
+        return 1;
+    }
+    Storage::setBlockFile(file);
+    RunResult result;
+    if (!run(options, file, 0xffffffff, 0, result)) {
+        fprintf(stderr, "Could not use %s as block storage.\n", options.path);
+        close(file);
+        return 1;
+    }
+    const double recordBytes = static_cast<double>(result.appendedCount) * sizeof(InternalLogRecord);
+    const double writtenBytes = static_cast<double>(result.blockWrites) * Storage::BlockSize;
+    printf("Records: %u, flushes: %u\n", result.appendedCount, result.flushCount);
+    printf("Written blocks: %u, write amplification: %.2f\n", result.blockWrites, writtenBytes / recordBytes);
+    printf("Append: mean %.2f us, maximum %.2f us\n",
+        result.appendNanos / 1e3 / result.appendedCount, result.maximumAppendNanos / 1e3);
+    if (result.flushCount > 0) {
+        printf("Flush: mean %.2f us, maximum %.2f us\n",
+            result.flushNanos / 1e3 / result.flushCount, result.maximumFlushNanos / 1e3);
+    }
+
+    // Repeat the run with a power loss at a random block write.
+    const uint32_t totalWrites = result.blockWrites;
+    uint32_t failureCount = 0;
+    srand(1);
+    for (uint32_t crash = 0; crash < options.crashCount; ++crash) {
+        const uint32_t powerLossWrite = static_cast<uint32_t>(rand()) % (totalWrites + 1);
+        const uint16_t tornBytes = static_cast<uint16_t>(rand() % Storage::BlockSize);
+        if (ftruncate(file, 0) != 0 || ftruncate(file, options.size) != 0) {
+            fprintf(stderr, "Could not reset %s: %s\n", options.path, strerror(errno));
+            close(file);
+            return 1;
+        }
+        RunResult crashResult;
+        run(options, file, powerLossWrite, tornBytes, crashResult);
+        if (verify(crashResult) < 0) {
+            ++failureCount;
+            fprintf(stderr, "Power loss at block write %u (%u bytes): committed records are missing.\n",
+                powerLossWrite, static_cast<unsigned>(tornBytes));
+        }
+    }
+    if (options.crashCount > 0) {
+        printf("Power losses: %u, failed: %u\n", options.crashCount, failureCount);
+    }
+    close(file);
+    return failureCount == 0 ? 0 : 1;
+}
+
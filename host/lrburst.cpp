@@ -0,0 +1,249 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to check the burst buffer.
+//
+// The tool adds samples to a `BurstBuffer` in random runs, like the burst
+// mode of the application, and compares it with a simple list of all
+// samples after each step:
+//
+// - The samples by age, also after the buffer wrapped and overwrote the
+//   oldest ones.
+// - The pending samples in time order, after `getPendingRecords()`
+//   rotated the buffer in place.
+// - The samples by age after this rotation.
+//
+// At the end of a run, the pending samples are written to a log in memory
+// with one `appendRecords()` call, like a burst, or they are dropped,
+// like the application does for a regular record. The log has to contain
+// the written samples in time order.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrburst
+//       host/lrburst.cpp host/CommandLine.cpp host/HostArduino.cpp BurstBuffer.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrburst [options]
+//       --runs <count>   The number of runs, default is 100000.
+//       --seed <number>  The seed of the random runs, default is 1.
+//
+
+
+#include "CommandLine.h"
+
+#include "BurstBuffer.h"
+#include "ConfigArea.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+// The time of the first sample.
+//
+const uint32_t FIRST_SAMPLE_TIME = 1500000000;
+
+// The size of the storage image for the log.
+//
+const uint32_t STORAGE_SIZE = 65536;
+
+// The number of failed checks after which the tool stops.
+//
+const uint32_t MAXIMUM_FAILURES = 20;
+
+
+// A simple random generator, which does not depend on the C library.
+//
+struct Random
+{
+    uint32_t state;
+
+    uint32_t next(uint32_t range)
+    {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % range;
+    }
+};
+
+
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t runCount;
+    uint32_t seed;
+};
+
+
+uint32_t gFailureCount = 0;
+uint32_t gRun = 0;
+
+
+// Count and report a failed check.
+//
+void check(bool condition, const char *format, ...)
+{
+    if (condition) {
+        return;
+    }
+    ++gFailureCount;
+    fprintf(stderr, "Run %u: ", gRun);
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+    fprintf(stderr, "\n");
+    if (gFailureCount >= MAXIMUM_FAILURES) {
+        fprintf(stderr, "Too many failures.\n");
+        exit(1);
+    }
+}
+
+
+// Create the sample with the given number.
+//
+LogRecord getSample(uint32_t number)
+{
+    return LogRecord(DateTime(FIRST_SAMPLE_TIME + number * 2),
+        static_cast<int16_t>(number % 700) - 300, static_cast<int16_t>(number % 1001));
+}
+
+
+// Check if a record is the sample with the given number.
+//
+bool isSample(const LogRecord &logRecord, uint32_t number)
+{
+    const LogRecord sample = getSample(number);
+    return logRecord.getDateTime().unixtime() == sample.getDateTime().unixtime() &&
+        memcmp(logRecord.getValues(), sample.getValues(), sizeof(int16_t) * LogRecordSchema::ChannelCount) == 0;
+}
+
+
+// Check the samples in the buffer by age.
+//
+// @param sampleCount The number of samples added since the start.
+// @param bufferedCount The number of samples the buffer has to keep.
+//
+void checkAges(const BurstBuffer &buffer, uint32_t sampleCount, uint32_t bufferedCount)
+{
+    check(buffer.count() == bufferedCount, "%u samples in the buffer, expected %u", buffer.count(), bufferedCount);
+    for (uint8_t age = 0; age < buffer.count() && age < bufferedCount; ++age) {
+        check(isSample(buffer.getRecord(age), sampleCount - 1 - age), "wrong sample with age %u", age);
+    }
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.runCount = 100000;
+    options.seed = 1;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (argumentIndex + 1 >= argc) {
+            fprintf(stderr, "Usage: lrburst [--runs <count>] [--seed <number>]\n");
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--runs") {
+            valid = parseNumber(argument, options.runCount) && options.runCount > 0;
+        } else if (option == "--seed") {
+            valid = parseNumber(argument, options.seed);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+
+    std::vector<uint8_t> image(STORAGE_SIZE, 0x55);
+    Storage storage;
+    storage.setImage(image.data(), STORAGE_SIZE);
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    logSystem.format();
+
+    Random random = {options.seed};
+    BurstBuffer buffer;
+    uint32_t sampleCount = 0;
+    uint32_t pendingStart = 0;
+    uint32_t writtenCount = 0;
+    uint32_t burstCount = 0;
+    uint32_t fullBurstCount = 0;
+    for (gRun = 0; gRun < options.runCount; ++gRun) {
+        // Short runs like regular records, and long runs which wrap the buffer.
+        const uint32_t runLength = (random.next(4) == 0 ? random.next(3 * BurstBuffer::Capacity) : random.next(4)) + 1;
+        for (uint32_t i = 0; i < runLength; ++i) {
+            buffer.add(getSample(sampleCount++));
+            const uint32_t bufferedCount = (sampleCount < BurstBuffer::Capacity ? sampleCount : BurstBuffer::Capacity);
+            checkAges(buffer, sampleCount, bufferedCount);
+        }
+        const uint32_t bufferedCount = (sampleCount < BurstBuffer::Capacity ? sampleCount : BurstBuffer::Capacity);
+        uint32_t pendingCount = sampleCount - pendingStart;
+        if (pendingCount > bufferedCount) {
+            pendingCount = bufferedCount;
+        }
+        check(buffer.pendingCount() == pendingCount, "%u pending samples, expected %u", buffer.pendingCount(), pendingCount);
+        if (random.next(2) == 0) {
+            // A burst: the pending samples are written at once.
+            ++burstCount;
+            if (buffer.count() == BurstBuffer::Capacity) {
+                ++fullBurstCount;
+            }
+            const LogRecord *pendingRecords = buffer.getPendingRecords();
+            for (uint8_t i = 0; i < buffer.pendingCount(); ++i) {
+                check(isSample(pendingRecords[i], sampleCount - buffer.pendingCount() + i), "wrong pending sample %u", i);
+            }
+            checkAges(buffer, sampleCount, bufferedCount);
+            const uint32_t totalCount = logSystem.totalNumberOfRecords();
+            check(logSystem.appendRecords(pendingRecords, buffer.pendingCount()), "the burst was not written");
+            check(logSystem.totalNumberOfRecords() == totalCount + buffer.pendingCount(), "the burst was not completely written");
+            for (uint8_t i = 0; i < buffer.pendingCount(); ++i) {
+                const LogRecord logRecord = logSystem.getLogRecord(logSystem.currentNumberOfRecords() - buffer.pendingCount() + i);
+                check(isSample(logRecord, sampleCount - buffer.pendingCount() + i), "wrong sample %u of the burst in the log", i);
+            }
+            writtenCount += buffer.pendingCount();
+        }
+        // Otherwise the older samples are dropped, like for a regular record.
+        buffer.markWritten();
+        pendingStart = sampleCount;
+        check(buffer.pendingCount() == 0, "pending samples after they were written");
+    }
+    printf("Capacity: %u, samples: %u, written: %u, bursts: %u, from a full buffer: %u\n",
+        static_cast<unsigned>(BurstBuffer::Capacity), sampleCount, writtenCount, burstCount, fullBurstCount);
+    printf("Runs: %u, failed checks: %u\n", options.runCount, gFailureCount);
+    return gFailureCount == 0 ? 0 : 1;
+}
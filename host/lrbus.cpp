@@ -0,0 +1,265 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to model the time of the log system on the I2C bus.
+//
+// The tool runs the log system on an image, counts the transfers to the
+// storage, and converts them into bus time with the cost model of
+// `BusModel.h`. The transfers are counted like the FRAM storage does
+// them, without the read cache. The times are reported for the standard
+// clock of 100kHz, which the whole bus used before the devices got their
+// own clocks, and for the FRAM clock of `I2CBus`.
+//
+// - The boot scan is `LogSystem::begin()`, which finds the end of the
+//   rings and reads the statistics and the session index.
+// - The append is the mean time of one record, including the rollups
+//   and the statistics checkpoints, over one day of records.
+// - The dump reads all records with a cursor, like the `r` command. The
+//   time to send the records at 57600 baud is shown as well.
+// - The RTC read always runs at 100kHz.
+//
+// Without an image, a log of the given size is formatted and filled with
+// records until the ring of the records is full. With an image, the image
+// file is not changed.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrbus
+//       host/lrbus.cpp host/CommandLine.cpp host/ImageFile.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp I2CBus.cpp
+//
+// Usage:
+//
+//   lrbus [options] [<image>]
+//       --size <bytes>      The size of the storage without image, default is 32768 (MB85RC256).
+//
+
+
+#include "BusModel.h"
+#include "CommandLine.h"
+#include "ImageFile.h"
+
+#include "ConfigArea.h"
+#include "I2CBus.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <Wire.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+// The bus, for `I2CBus`.
+TwoWire Wire;
+
+
+namespace {
+
+
+// The time of the first record.
+//
+const uint32_t FIRST_RECORD_TIME = 1500000000;
+
+// The interval between two records in seconds.
+//
+const uint32_t RECORD_INTERVAL = 60;
+
+// The number of records to measure the append.
+//
+const uint32_t APPEND_RECORDS = 86400 / RECORD_INTERVAL;
+
+// The baud rate of the serial interface.
+//
+const uint32_t SERIAL_BAUD = 57600;
+
+
+// The transfers of one operation.
+//
+struct Transfers
+{
+    uint64_t transferCount;
+    uint64_t byteCount;
+};
+
+
+// Get the transfers since the given start.
+//
+Transfers getTransfersSince(const Transfers &start)
+{
+    Transfers transfers;
+    transfers.transferCount = Storage::getTransferCount() - start.transferCount;
+    transfers.byteCount = Storage::getTransferredBytes() - start.byteCount;
+    return transfers;
+}
+
+
+// Get the current counters of the storage.
+//
+Transfers getCurrentTransfers()
+{
+    Transfers transfers;
+    transfers.transferCount = Storage::getTransferCount();
+    transfers.byteCount = Storage::getTransferredBytes();
+    return transfers;
+}
+
+
+// Create the record with the given number.
+//
+LogRecord getTestRecord(uint32_t number)
+{
+    return LogRecord(DateTime(FIRST_RECORD_TIME + number * RECORD_INTERVAL),
+        static_cast<int16_t>(200 + number % 100), static_cast<int16_t>(400 + number % 300));
+}
+
+
+// Print one operation with the time at the standard and the fast clock.
+//
+// @param divisor The number of operations in the transfers.
+//
+void printOperation(const char *name, const Transfers &transfers, uint32_t divisor, const BusModel &bus)
+{
+    const double standardMillis = bus.getNanos(LR_I2C_STANDARD_CLOCK, transfers.transferCount, transfers.byteCount) / 1e6 / divisor;
+    const double fastMillis = bus.getNanos(I2CBus::getClock(I2CBus::Fram), transfers.transferCount, transfers.byteCount) / 1e6 / divisor;
+    printf("%-12s %10.1f %10.1f %12.3f %12.3f %8.2fx\n", name,
+        static_cast<double>(transfers.transferCount) / divisor, static_cast<double>(transfers.byteCount) / divisor,
+        standardMillis, fastMillis, standardMillis / fastMillis);
+}
+
+
+// Print the usage of the tool.
+//
+void printUsage()
+{
+    fprintf(stderr, "Usage: lrbus [--size <bytes>] [<image>]\n");
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t size = 32768;
+    const char *path = 0;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option.compare(0, 2, "--") != 0 && path == 0 && argumentIndex + 1 == argc) {
+            path = argv[argumentIndex];
+            continue;
+        }
+        if (option != "--size" || argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        if (!parseNumber(argument, size) || size < CONFIG_AREA_SIZE + 1024) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+
+    ImageFile imageFile;
+    std::vector<uint8_t> image;
+    Storage storage;
+    if (path != 0) {
+        if (!imageFile.open(path)) {
+            return 1;
+        }
+        storage.setImage(imageFile.data(), imageFile.size());
+    } else {
+        image.resize(size, 0xff);
+        storage.setImage(image.data(), size);
+        LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+        logSystem.begin();
+        logSystem.format();
+        logSystem.appendSession(DateTime(FIRST_RECORD_TIME), RECORD_INTERVAL);
+        for (uint32_t number = 1; number < logSystem.maximumNumberOfRecords(); ++number) {
+            if (!logSystem.appendRecord(getTestRecord(number))) {
+                fprintf(stderr, "Could not write the records.\n");
+                return 1;
+            }
+        }
+    }
+
+    // Boot scan.
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    Transfers start = getCurrentTransfers();
+    logSystem.begin();
+    const Transfers bootTransfers = getTransfersSince(start);
+    if (logSystem.currentNumberOfRecords() == 0) {
+        fprintf(stderr, "The log is empty.\n");
+        return 1;
+    }
+    const uint32_t recordCount = logSystem.currentNumberOfRecords();
+
+    // Dump, with the serial output counted in a temporary file.
+    FILE *serialOutput = tmpfile();
+    if (serialOutput == 0) {
+        fprintf(stderr, "Could not create a temporary file.\n");
+        return 1;
+    }
+    Serial.setOutput(serialOutput);
+    start = getCurrentTransfers();
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        view.writeToSerial();
+    }
+    const Transfers dumpTransfers = getTransfersSince(start);
+    Serial.flush();
+    const long serialBytes = ftell(serialOutput);
+    fclose(serialOutput);
+    Serial.setOutput(stdout);
+
+    // Append one day of records, after the last record.
+    LogRecordView lastView;
+    for (const LogRecordView &view : logSystem.getRecords(recordCount - 1, recordCount)) {
+        lastView = view;
+    }
+    const uint32_t firstNumber = (lastView.getUnixtime() - FIRST_RECORD_TIME) / RECORD_INTERVAL + 1;
+    start = getCurrentTransfers();
+    for (uint32_t number = firstNumber; number < firstNumber + APPEND_RECORDS; ++number) {
+        if (!logSystem.appendRecord(getTestRecord(number))) {
+            fprintf(stderr, "Could not append the records.\n");
+            return 1;
+        }
+    }
+    const Transfers appendTransfers = getTransfersSince(start);
+
+    BusModel bus;
+    bus.byteCycles = BusModel::DefaultByteCycles;
+    bus.transferCycles = BusModel::DefaultTransferCycles;
+    printf("Storage: %u bytes, %u records\n", storage.size(), recordCount);
+    printf("%-12s %10s %10s %12s %12s %9s\n", "operation", "transfers", "bytes",
+        "100kHz ms", "fast ms", "speedup");
+    printOperation("boot scan", bootTransfers, 1, bus);
+    printOperation("append", appendTransfers, APPEND_RECORDS, bus);
+    printOperation("dump", dumpTransfers, 1, bus);
+    // The register address and the seven bytes of the time.
+    const double rtcMillis = bus.getNanos(LR_I2C_STANDARD_CLOCK, 1, 7) / 1e6;
+    printf("%-12s %10.1f %10.1f %12.3f %12.3f %8.2fx\n", "rtc read", 1.0, 7.0, rtcMillis, rtcMillis, 1.0);
+    printf("Fast clock: %u Hz\n", I2CBus::getClock(I2CBus::Fram));
+    printf("Serial output of the dump: %ld bytes, %.1f ms at %u baud\n",
+        serialBytes, serialBytes * 10.0 * 1000.0 / SERIAL_BAUD, SERIAL_BAUD);
+    return 0;
+}
+
@@ -0,0 +1,288 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// Host tool to work with raw storage images of the logger.
+//
+// The tool uses the log system of the logger on a memory mapped image,
+// therefore the records are decoded exactly like on the device.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrimage
+//       host/lrimage.cpp host/ImageFile.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrimage extract <capture> <image>  Extract the image from a capture of the `i` command.
+//   lrimage info <image>               Show information about the log in the image.
+//   lrimage records <image>            Write all records in the format of the logger.
+//   lrimage rollups <tier> <image>     Write the hourly or daily rollups, like the `u` command.
+//   lrimage statistics <image>         Show the statistics of the log, like the `s` command.
+//
+
+
+#include "ImageFile.h"
+
+#include "ConfigArea.h"
+#include "Storage.h"
+#include "LogSystem.h"
+
+#include <util/crc16.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+// The number of bytes reserved for the configuration, as used by the application.
+//
+const uint32_t RESERVED_FOR_CONFIG = CONFIG_AREA_SIZE;
+
+    
+// Read a whole file into memory.
+//
+bool readFile(const char *path, std::vector<uint8_t> &content)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == 0) {
+        fprintf(stderr, "Could not open %s.\n", path);
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.insert(content.end(), buffer, buffer + size);
+    }
+    fclose(file);
+    return true;
+}
+
+    
+// Extract the image from a capture of the serial output.
+//
+int extractImage(const char *capturePath, const char *imagePath)
+{
+    std::vector<uint8_t> capture;
+    if (!readFile(capturePath, capture)) {
+        return 1;
+    }
+    // Find the line with the image size.
+    const char *marker = "IMAGE ";
+    const size_t markerLength = strlen(marker);
+    size_t position = 0;
+    bool found = false;
+    for (; position + markerLength < capture.size(); ++position) {
+        if ((position == 0 || capture[position-1] == '\n') &&
+            memcmp(&capture[position], marker, markerLength) == 0) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "No image found in %s.\n", capturePath);
+        return 1;
+    }
+    position += markerLength;
+    uint32_t size = 0;
+    while (position < capture.size() && capture[position] >= '0' && capture[position] <= '9') {
+        size = size * 10 + (capture[position] - '0');
+        ++position;
+    }
+    if (position + 2 > capture.size() || capture[position] != '\r' || capture[position+1] != '\n') {
+        fprintf(stderr, "Invalid image header in %s.\n", capturePath);
+        return 1;
+    }
+    position += 2;
+    if (position + size > capture.size()) {
+        fprintf(stderr, "The image in %s is incomplete.\n", capturePath);
+        return 1;
+    }
+    const uint8_t *image = &capture[position];
+    // Verify the CRC line after the image.
+    uint16_t crc = 0xffff;
+    for (uint32_t i = 0; i < size; ++i) {
+        crc = _crc16_update(crc, image[i]);
+    }
+    const std::string trailer(reinterpret_cast<const char*>(image + size), capture.size() - position - size);
+    unsigned int expectedCRC = 0;
+    if (sscanf(trailer.c_str(), "\r\nCRC %X", &expectedCRC) != 1) {
+        fprintf(stderr, "Missing CRC after the image in %s.\n", capturePath);
+        return 1;
+    }
+    if (expectedCRC != crc) {
+        fprintf(stderr, "CRC mismatch: expected %04X, calculated %04X.\n", expectedCRC, crc);
+        return 1;
+    }
+    FILE *file = fopen(imagePath, "wb");
+    if (file == 0 || fwrite(image, 1, size, file) != size || fclose(file) != 0) {
+        fprintf(stderr, "Could not write %s.\n", imagePath);
+        return 1;
+    }
+    fprintf(stderr, "Extracted %u bytes to %s.\n", size, imagePath);
+    return 0;
+}
+
+    
+// Show information about the log in the image.
+//
+int showInfo(const char *imagePath)
+{
+    ImageFile imageFile;
+    if (!imageFile.open(imagePath)) {
+        return 1;
+    }
+    Storage storage;
+    storage.setImage(imageFile.data(), imageFile.size());
+    LogSystem logSystem(RESERVED_FOR_CONFIG, &storage);
+    logSystem.begin();
+    uint32_t corruptedRecords = 0;
+    uint32_t errorRecords = 0;
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        if (view.getType() == LogRecordView::Corrupted) {
+            ++corruptedRecords;
+        } else if (view.getType() == LogRecordView::Error) {
+            ++errorRecords;
+        }
+    }
+    printf("Image size: %u bytes\n", storage.size());
+    printf("Maximum records: %u\n", logSystem.maximumNumberOfRecords());
+    printf("Current records: %u\n", logSystem.currentNumberOfRecords());
+    printf("Overwritten records: %u\n", logSystem.totalNumberOfRecords() - logSystem.currentNumberOfRecords());
+    printf("Corrupted records: %u\n", corruptedRecords);
+    printf("Error records: %u\n", errorRecords);
+    printf("Sessions: %u\n", logSystem.currentNumberOfSessions());
+    printf("Hourly rollups: %u of %u\n", logSystem.currentNumberOfRollups(LogRollup::Hourly), logSystem.maximumNumberOfRollups(LogRollup::Hourly));
+    printf("Daily rollups: %u of %u\n", logSystem.currentNumberOfRollups(LogRollup::Daily), logSystem.maximumNumberOfRollups(LogRollup::Daily));
+    return 0;
+}
+
+    
+// Write all records of the image in the format of the logger.
+//
+int writeRecords(const char *imagePath)
+{
+    ImageFile imageFile;
+    if (!imageFile.open(imagePath)) {
+        return 1;
+    }
+    Storage storage;
+    storage.setImage(imageFile.data(), imageFile.size());
+    LogSystem logSystem(RESERVED_FOR_CONFIG, &storage);
+    logSystem.begin();
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        view.writeToSerial();
+    }
+    Serial.flush();
+    return 0;
+}
+
+    
+// Write the rollups of one tier in the format of the logger.
+//
+int writeRollups(const char *tierName, const char *imagePath)
+{
+    LogRollup::Tier tier;
+    if (strcmp(tierName, "hourly") == 0) {
+        tier = LogRollup::Hourly;
+    } else if (strcmp(tierName, "daily") == 0) {
+        tier = LogRollup::Daily;
+    } else {
+        fprintf(stderr, "Unknown tier %s, use hourly or daily.\n", tierName);
+        return 2;
+    }
+    ImageFile imageFile;
+    if (!imageFile.open(imagePath)) {
+        return 1;
+    }
+    Storage storage;
+    storage.setImage(imageFile.data(), imageFile.size());
+    LogSystem logSystem(RESERVED_FOR_CONFIG, &storage);
+    logSystem.begin();
+    for (uint32_t i = 0; i < logSystem.currentNumberOfRollups(tier); ++i) {
+        const LogRollup rollup = logSystem.getRollup(tier, i);
+        if (!rollup.isNull()) {
+            rollup.writeToSerial();
+        }
+    }
+    const LogRollup currentRollup = logSystem.getCurrentRollup(tier);
+    if (!currentRollup.isNull()) {
+        currentRollup.writeToSerial();
+    }
+    Serial.flush();
+    return 0;
+}
+
+    
+// Show the statistics of the log in the image.
+//
+int writeStatistics(const char *imagePath)
+{
+    ImageFile imageFile;
+    if (!imageFile.open(imagePath)) {
+        return 1;
+    }
+    Storage storage;
+    storage.setImage(imageFile.data(), imageFile.size());
+    LogSystem logSystem(RESERVED_FOR_CONFIG, &storage);
+    logSystem.begin();
+    logSystem.getStatistics().writeToSerial();
+    Serial.flush();
+    return 0;
+}
+
+    
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage:\n"
+        "  lrimage extract <capture> <image>\n"
+        "  lrimage info <image>\n"
+        "  lrimage records <image>\n"
+        "  lrimage rollups <hourly|daily> <image>\n"
+        "  lrimage statistics <image>\n");
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc == 4 && strcmp(argv[1], "extract") == 0) {
+        return extractImage(argv[2], argv[3]);
+    } else if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return showInfo(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "records") == 0) {
+        return writeRecords(argv[2]);
+    } else if (argc == 4 && strcmp(argv[1], "rollups") == 0) {
+        return writeRollups(argv[2], argv[3]);
+    } else if (argc == 3 && strcmp(argv[1], "statistics") == 0) {
+        return writeStatistics(argv[2]);
+    }
+    printUsage();
+    return 2;
+}
+
@@ -0,0 +1,588 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// Host tool to validate and convert many storage images in parallel.
+//
+// Every image is split into chunks of records, which are validated on a
+// work-stealing thread pool. The validation uses the storage format of the
+// log system: a table driven CRC-16 and branch free range checks, which
+// the compiler can vectorize. After the last chunk of an image, the log is
+// recovered with the same rules as `LogSystem::begin()`, a corruption report
+// is created and the records are converted into the text format of the logger.
+// The records are read from the ring in the order they were written, starting
+// with the oldest record which is not overwritten.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O3 -pthread -DLR_STORAGE_IMAGE -Ihost/include -I. -o lringest
+//       host/lringest.cpp host/ThreadPool.cpp host/ImageFile.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lringest [-j <threads>] [-o <output directory>] [--verify] <image>...
+//
+// With `-o`, a file `<image name>.csv` is written for each image. With `--verify`,
+// each image is also decoded with the log system, to check the results match.
+//
+
+
+#include "ImageFile.h"
+#include "ThreadPool.h"
+
+#include "ConfigArea.h"
+#include "InternalLogRecord.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <RTClib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace {
+
+    
+// The number of records validated in one task.
+//
+const uint32_t CHUNK_SIZE = 16384;
+
+// The number of records validated in one batch, with the values in local arrays.
+//
+const uint32_t BATCH_SIZE = 256;
+
+// The results of the validation of a record slot.
+//
+const uint8_t SLOT_INVALID = 0;
+const uint8_t SLOT_MEASUREMENT = 1;
+const uint8_t SLOT_SESSION = 2;
+const uint8_t SLOT_ERROR = 3;
+const uint8_t SLOT_SESSION_LINK = 4;
+
+    
+// The tables for the slicing-by-4 CRC-16 (polynomial 0xa001).
+//
+uint16_t crcTable[4][256];
+
+    
+void initializeCRCTables()
+{
+    for (uint16_t i = 0; i < 256; ++i) {
+        crcTable[0][i] = _crc16_update(0, static_cast<uint8_t>(i));
+    }
+    for (uint16_t i = 0; i < 256; ++i) {
+        for (uint8_t t = 1; t < 4; ++t) {
+            const uint16_t previous = crcTable[t-1][i];
+            crcTable[t][i] = (previous >> 8) ^ crcTable[0][previous & 0xff];
+        }
+    }
+}
+
+    
+// Calculate the CRC-16 of a record, four bytes per step.
+//
+inline uint16_t getFastCRCForRecord(const uint8_t *data)
+{
+    const uint8_t size = offsetof(InternalLogRecord, crc);
+    uint16_t crc = 0xffff;
+    uint8_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const uint16_t x = crc ^ (data[i] | (data[i+1] << 8));
+        crc = crcTable[3][x & 0xff] ^ crcTable[2][x >> 8] ^ crcTable[1][data[i+2]] ^ crcTable[0][data[i+3]];
+    }
+    for (; i < size; ++i) {
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ data[i]) & 0xff];
+    }
+    return crc;
+}
+
+    
+// Verify the fast CRC against the CRC of the log system.
+//
+bool selfTest()
+{
+    uint8_t record[sizeof(InternalLogRecord)];
+    uint32_t seed = 0x12345678;
+    for (int round = 0; round < 10000; ++round) {
+        for (size_t i = 0; i < sizeof(record); ++i) {
+            seed = seed * 1103515245 + 12345;
+            record[i] = static_cast<uint8_t>(seed >> 16);
+        }
+        if (getFastCRCForRecord(record) != getCRCForInternalRecord(reinterpret_cast<const InternalLogRecord*>(record))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+    
+// The state of the log header in an image.
+//
+enum HeaderState : uint8_t {
+    HeaderValid,
+    HeaderRecovered,
+    HeaderMissing
+};
+
+    
+// One device image and the results of the validation.
+//
+struct Device
+{
+    std::string path;
+    std::string name;
+    ImageFile image;
+    bool mapped;
+    uint32_t configAreaSize; // The size of the configuration area of the image.
+    uint32_t slotCount; // The number of record slots in the ring of the image.
+    std::vector<uint8_t> valid; // The validation result for each slot, `SLOT_INVALID` for an invalid record.
+    std::atomic<uint32_t> remainingChunks;
+    // The results of the recovery.
+    HeaderState headerState;
+    uint32_t sequenceBase;
+    uint32_t firstRecord; // The number of the oldest record in the ring since the format.
+    uint32_t recordCount; // The number of records in the log, including corrupted ones.
+    uint32_t corruptedCount; // The number of corrupted records in the log.
+    uint32_t sessionCount; // The number of session records in the log.
+    uint32_t errorCount; // The number of error records in the log.
+    uint32_t timeRegressions; // The number of records with a time before the previous one.
+    uint32_t firstTime;
+    uint32_t lastTime;
+    bool verifyFailed;
+    bool writeFailed;
+};
+
+    
+// The options from the command line.
+//
+struct Options
+{
+    unsigned threadCount;
+    std::string outputDirectory;
+    bool verify;
+    std::vector<std::string> paths;
+};
+
+    
+inline const InternalLogRecord* getRecord(const Device &device, uint32_t slot)
+{
+    return reinterpret_cast<const InternalLogRecord*>(device.image.data() + device.configAreaSize + sizeof(InternalLogHeader) + sizeof(InternalLogRecord) * slot);
+}
+
+
+// Get the slot of the record with the given index in the log.
+//
+inline uint32_t getSlot(const Device &device, uint32_t index)
+{
+    return (device.firstRecord + index) % device.slotCount;
+}
+
+    
+// Validate a range of records.
+//
+// The values are copied into local arrays first, which allows the
+// compiler to vectorize the range checks.
+//
+void validateChunk(Device &device, uint32_t first, uint32_t last)
+{
+    uint32_t sequence[BATCH_SIZE];
+    int16_t values[LogRecordSchema::ChannelCount][BATCH_SIZE];
+    uint8_t errorCode[BATCH_SIZE];
+    uint16_t crc[BATCH_SIZE];
+    uint16_t expectedCRC[BATCH_SIZE];
+    for (uint32_t batchStart = first; batchStart < last; batchStart += BATCH_SIZE) {
+        const uint32_t batchSize = std::min(BATCH_SIZE, last - batchStart);
+        const uint8_t *data = reinterpret_cast<const uint8_t*>(getRecord(device, batchStart));
+        for (uint32_t i = 0; i < batchSize; ++i) {
+            const uint8_t *recordData = data + i * sizeof(InternalLogRecord);
+            memcpy(&sequence[i], recordData + offsetof(InternalLogRecord, sequence), sizeof(uint32_t));
+            for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+                memcpy(&values[channel][i], recordData + offsetof(InternalLogRecord, values) + sizeof(int16_t) * channel, sizeof(int16_t));
+            }
+            errorCode[i] = recordData[offsetof(InternalLogRecord, error) + offsetof(InternalErrorData, code)];
+            memcpy(&crc[i], recordData + offsetof(InternalLogRecord, crc), sizeof(uint16_t));
+            expectedCRC[i] = getFastCRCForRecord(recordData);
+        }
+        uint8_t *valid = &device.valid[batchStart];
+        uint8_t inRange[BATCH_SIZE];
+        for (uint32_t i = 0; i < batchSize; ++i) {
+            inRange[i] = 1;
+        }
+        for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+            const int16_t minimum = LogRecordSchema::getMinimum(channel);
+            const int16_t maximum = LogRecordSchema::getMaximum(channel);
+            for (uint32_t i = 0; i < batchSize; ++i) {
+                inRange[i] &= (values[channel][i] >= minimum) & (values[channel][i] <= maximum);
+            }
+        }
+        for (uint32_t i = 0; i < batchSize; ++i) {
+            const uint8_t type = static_cast<uint8_t>(sequence[i] >> LOG_RECORD_TYPE_SHIFT);
+            const uint8_t isMeasurement = (type == LOG_RECORD_TYPE_MEASUREMENT) & inRange[i];
+            const uint8_t isSession = (type == LOG_RECORD_TYPE_SESSION);
+            const uint8_t isError = (type == LOG_RECORD_TYPE_ERROR) & (errorCode[i] < LOG_ERROR_CODE_COUNT);
+            const uint8_t isSessionLink = (type == LOG_RECORD_TYPE_SESSION_LINK);
+            valid[i] = (crc[i] == expectedCRC[i]) *
+                (isMeasurement * SLOT_MEASUREMENT + isSession * SLOT_SESSION + isError * SLOT_ERROR + isSessionLink * SLOT_SESSION_LINK);
+        }
+    }
+}
+
+    
+// Recover the log from the validation results.
+//
+// This follows the rules of `LogSystem::begin()`.
+//
+void recoverLog(Device &device)
+{
+    const InternalLogHeader *header = reinterpret_cast<const InternalLogHeader*>(device.image.data() + device.configAreaSize);
+    device.headerState = HeaderMissing;
+    device.sequenceBase = 0;
+    if (header->magic == LOG_HEADER_MAGIC && header->crc == getCRC(header, offsetof(InternalLogHeader, crc))) {
+        device.headerState = HeaderValid;
+        device.sequenceBase = header->sequenceBase;
+    } else {
+        for (uint32_t index = 0; index < LOG_MAXIMUM_SKIPPED_RECORDS && index < device.slotCount; ++index) {
+            if (device.valid[index]) {
+                device.headerState = HeaderRecovered;
+                device.sequenceBase = (getInternalRecordSequence(getRecord(device, index)) - index) & LOG_SEQUENCE_MASK;
+                break;
+            }
+        }
+    }
+    // The lap of the ring is taken from the first valid record, the records
+    // of this lap are followed from the start of the ring.
+    uint32_t lapStart = 0;
+    bool hasLap = false;
+    for (uint32_t slot = 0; slot < LOG_MAXIMUM_SKIPPED_RECORDS && slot < device.slotCount && !hasLap; ++slot) {
+        if (device.valid[slot]) {
+            const uint32_t number = (getInternalRecordSequence(getRecord(device, slot)) - device.sequenceBase) & LOG_SEQUENCE_MASK;
+            if (number <= LOG_MAXIMUM_RECORD_NUMBER && number % device.slotCount == slot) {
+                lapStart = number - slot;
+                hasLap = true;
+            }
+        }
+    }
+    uint32_t endSlot = 0;
+    uint8_t skippedRecords = 0;
+    for (uint32_t slot = 0; hasLap && slot < device.slotCount; ++slot) {
+        if (device.valid[slot]) {
+            if (getInternalRecordSequence(getRecord(device, slot)) != ((device.sequenceBase + lapStart + slot) & LOG_SEQUENCE_MASK)) {
+                break;
+            }
+            endSlot = slot + 1;
+            skippedRecords = 0;
+        } else if (++skippedRecords >= LOG_MAXIMUM_SKIPPED_RECORDS) {
+            break;
+        }
+    }
+    const uint32_t recordEnd = lapStart + endSlot;
+    device.recordCount = std::min(recordEnd, device.slotCount);
+    device.firstRecord = recordEnd - device.recordCount;
+    device.corruptedCount = 0;
+    device.sessionCount = 0;
+    device.errorCount = 0;
+    device.timeRegressions = 0;
+    device.firstTime = 0;
+    device.lastTime = 0;
+    for (uint32_t index = 0; index < device.recordCount; ++index) {
+        const uint32_t slot = getSlot(device, index);
+        if (device.valid[slot] == SLOT_INVALID) {
+            ++device.corruptedCount;
+            continue;
+        } else if (device.valid[slot] == SLOT_SESSION) {
+            ++device.sessionCount;
+            continue;
+        } else if (device.valid[slot] == SLOT_ERROR) {
+            ++device.errorCount;
+            continue;
+        } else if (device.valid[slot] == SLOT_SESSION_LINK) {
+            continue;
+        }
+        const uint32_t time = getRecord(device, slot)->unixtime;
+        if (device.firstTime == 0) {
+            device.firstTime = time;
+        } else if (time < device.lastTime) {
+            ++device.timeRegressions;
+        }
+        device.lastTime = time;
+    }
+}
+
+    
+// Decode the image with the log system and compare the results.
+//
+bool verifyWithLogSystem(Device &device)
+{
+    // The log system needs a writable image, use a private copy.
+    std::vector<uint8_t> copy(device.image.data(), device.image.data() + device.image.size());
+    Storage storage;
+    storage.setImage(copy.data(), static_cast<uint32_t>(copy.size()));
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    if (logSystem.currentNumberOfRecords() != device.recordCount ||
+        logSystem.totalNumberOfRecords() != device.firstRecord + device.recordCount) {
+        return false;
+    }
+    for (uint32_t index = 0; index < device.recordCount; ++index) {
+        const uint8_t valid = device.valid[getSlot(device, index)];
+        if (logSystem.getLogRecord(index).isNull() != (valid != SLOT_MEASUREMENT) ||
+            logSystem.getSessionAtRecord(index).isNull() != (valid != SLOT_SESSION) ||
+            logSystem.getErrorAtRecord(index).isNull() != (valid != SLOT_ERROR)) {
+            return false;
+        }
+    }
+    // The session index also counts the sessions with overwritten records.
+    return device.firstRecord > 0 || logSystem.currentNumberOfSessions() == device.sessionCount;
+}
+
+    
+// Append a fixed point value of a channel, like the logger.
+//
+char* appendFixedPoint(char *output, int16_t value, uint8_t decimals)
+{
+    int32_t magnitude = value;
+    if (magnitude < 0) {
+        *output++ = '-';
+        magnitude = -magnitude;
+    }
+    const int32_t scale = getDecimalScale(decimals);
+    if (decimals == 0) {
+        return output + sprintf(output, "%d", static_cast<int>(magnitude));
+    }
+    return output + sprintf(output, "%d.%0*d", static_cast<int>(magnitude / scale), static_cast<int>(decimals), static_cast<int>(magnitude % scale));
+}
+
+    
+// Write the records of the device in the text format of the logger.
+//
+bool writeRecords(const Device &device, const std::string &outputDirectory)
+{
+    const std::string path = outputDirectory + "/" + device.name + ".csv";
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == 0) {
+        return false;
+    }
+    std::vector<char> buffer;
+    buffer.reserve(1 << 20);
+    char line[80 + 8 * LogRecordSchema::ChannelCount];
+    for (uint32_t index = 0; index < device.recordCount; ++index) {
+        const uint32_t slot = getSlot(device, index);
+        if (device.valid[slot] == SLOT_INVALID || device.valid[slot] == SLOT_SESSION_LINK) {
+            continue;
+        }
+        const InternalLogRecord *record = getRecord(device, slot);
+        const DateTime dateTime(record->unixtime);
+        char *end = line;
+        if (device.valid[slot] == SLOT_SESSION) {
+            const InternalSessionData &session = record->session;
+            end += sprintf(line, "Session start %04d-%02d-%02d %02d:%02d:%02d interval %us boot %u\r\n",
+                dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second(),
+                static_cast<unsigned>(session.interval) * LOG_SESSION_INTERVAL_UNIT, static_cast<unsigned>(session.bootCount));
+        } else if (device.valid[slot] == SLOT_ERROR) {
+            const InternalErrorData &error = record->error;
+            end += sprintf(line, "Sensor error %04d-%02d-%02d %02d:%02d:%02d %s attempts %u\r\n",
+                dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second(),
+                error.code == LogError::SensorChecksum ? "checksum" : "timeout", static_cast<unsigned>(error.attempts));
+        } else {
+            end += sprintf(line, "%04d-%02d-%02d %02d:%02d:%02d", dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second());
+            for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+                int16_t value;
+                memcpy(&value, reinterpret_cast<const uint8_t*>(record) + offsetof(InternalLogRecord, values) + sizeof(int16_t) * channel, sizeof(int16_t));
+                *end++ = ',';
+                end = appendFixedPoint(end, value, LogRecordSchema::getDecimals(channel));
+            }
+            *end++ = '\r';
+            *end++ = '\n';
+        }
+        buffer.insert(buffer.end(), line, end);
+        if (buffer.size() > (1 << 20) - sizeof(line)) {
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    }
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    return fclose(file) == 0;
+}
+
+    
+// Finish a device, after all chunks are validated.
+//
+void finishDevice(Device &device, const Options &options)
+{
+    recoverLog(device);
+    if (options.verify) {
+        device.verifyFailed = !verifyWithLogSystem(device);
+    }
+    if (!options.outputDirectory.empty()) {
+        device.writeFailed = !writeRecords(device, options.outputDirectory);
+    }
+}
+
+    
+std::string formatTime(uint32_t time)
+{
+    if (time == 0) {
+        return "-";
+    }
+    const DateTime dateTime(time);
+    char buffer[32];
+    sprintf(buffer, "%04d-%02d-%02d %02d:%02d:%02d", dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second());
+    return buffer;
+}
+
+    
+std::string getName(const std::string &path)
+{
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) {
+        name.resize(dot);
+    }
+    return name;
+}
+
+    
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    options.threadCount = 0;
+    options.verify = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "-j" && i + 1 < argc) {
+            options.threadCount = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (argument == "-o" && i + 1 < argc) {
+            options.outputDirectory = argv[++i];
+        } else if (argument == "--verify") {
+            options.verify = true;
+        } else if (!argument.empty() && argument[0] == '-') {
+            return false;
+        } else {
+            options.paths.push_back(argument);
+        }
+    }
+    return !options.paths.empty();
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: lringest [-j <threads>] [-o <output directory>] [--verify] <image>...\n");
+        return 2;
+    }
+    initializeCRCTables();
+    if (!selfTest()) {
+        fprintf(stderr, "Self test of the CRC failed.\n");
+        return 1;
+    }
+    
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Device>> devices;
+    uint64_t totalBytes = 0;
+    {
+        ThreadPool pool(options.threadCount);
+        for (size_t i = 0; i < options.paths.size(); ++i) {
+            std::unique_ptr<Device> device(new Device());
+            device->path = options.paths[i];
+            device->name = getName(device->path);
+            device->mapped = device->image.open(device->path.c_str());
+            device->configAreaSize = getConfigAreaSize(device->image.size());
+            device->slotCount = 0;
+            device->firstRecord = 0;
+            device->recordCount = 0;
+            device->corruptedCount = 0;
+            device->sessionCount = 0;
+            device->errorCount = 0;
+            device->timeRegressions = 0;
+            device->firstTime = 0;
+            device->lastTime = 0;
+            device->headerState = HeaderMissing;
+            device->verifyFailed = false;
+            device->writeFailed = false;
+            const uint32_t minimumSize = device->configAreaSize + sizeof(InternalLogHeader);
+            if (device->mapped && device->image.size() >= minimumSize) {
+                device->slotCount = LogSystem::getLayout(device->image.size(), device->configAreaSize, 0).recordCount;
+                device->valid.resize(device->slotCount);
+                totalBytes += device->image.size();
+                const uint32_t chunkCount = std::max(1u, (device->slotCount + CHUNK_SIZE - 1) / CHUNK_SIZE);
+                device->remainingChunks = chunkCount;
+                Device *devicePtr = device.get();
+                for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+                    const uint32_t first = chunk * CHUNK_SIZE;
+                    const uint32_t last = std::min(first + CHUNK_SIZE, devicePtr->slotCount);
+                    pool.submit([devicePtr, first, last, &options]{
+                        validateChunk(*devicePtr, first, last);
+                        if (--devicePtr->remainingChunks == 0) {
+                            finishDevice(*devicePtr, options);
+                        }
+                    });
+                }
+            } else {
+                device->mapped = false;
+            }
+            devices.push_back(std::move(device));
+        }
+        pool.wait();
+        fprintf(stderr, "Processed %zu images (%.1f MB) with %u threads", devices.size(), totalBytes / 1e6, pool.threadCount());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    fprintf(stderr, " in %.3f s, %.1f MB/s.\n", seconds, totalBytes / 1e6 / seconds);
+    
+    // Write the report.
+    std::sort(devices.begin(), devices.end(), [](const std::unique_ptr<Device> &a, const std::unique_ptr<Device> &b){ return a->name < b->name; });
+    static const char *headerStateNames[] = {"valid", "recovered", "missing"};
+    printf("device,records,overwritten,corrupted,sessions,errors,time_regressions,header,first,last,status\n");
+    int exitCode = 0;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const Device &device = *devices[i];
+        if (!device.mapped) {
+            printf("%s,,,,,,,,,,unreadable\n", device.name.c_str());
+            exitCode = 1;
+            continue;
+        }
+        const char *status = "ok";
+        if (device.verifyFailed) {
+            status = "verify-failed";
+            exitCode = 1;
+        } else if (device.writeFailed) {
+            status = "write-failed";
+            exitCode = 1;
+        } else if (device.corruptedCount > 0 || device.timeRegressions > 0 || device.headerState != HeaderValid) {
+            status = "damaged";
+        }
+        printf("%s,%u,%u,%u,%u,%u,%u,%s,%s,%s,%s\n", device.name.c_str(), device.recordCount, device.firstRecord, device.corruptedCount, device.sessionCount, device.errorCount, device.timeRegressions,
+            headerStateNames[device.headerState], formatTime(device.firstTime).c_str(), formatTime(device.lastTime).c_str(), status);
+    }
+    return exitCode;
+}
+
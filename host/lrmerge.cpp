@@ -0,0 +1,352 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// Host tool to merge the exported logs of several loggers.
+//
+// Every logger samples on its own schedule, so the times of different
+// loggers never line up. This tool reads all exports at the same time and
+// merges them with a heap ordered by the time of the next record of each
+// logger. Only the current and the next record of each logger are kept in
+// memory, so the size of the logs does not matter.
+//
+// By default, the values are resampled onto a common time grid. The value
+// of a logger at a grid time is interpolated linearly between the records
+// before and after it. If these records are further apart than the maximum
+// gap, or there is no record on one side, the cell is left empty to mark
+// the gap.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -Ihost/include -o lrmerge host/lrmerge.cpp host/CommandLine.cpp host/ExportFile.cpp host/HostArduino.cpp
+//
+// Usage:
+//
+//   lrmerge [options] <export>...
+//       --step <seconds>       The distance of the grid times, default is 600.
+//       --gap <seconds>        The maximum distance of two records to interpolate, default is 3600.
+//       --from <time>          The first time of the grid, "YYYY-MM-DD hh:mm:ss" or a prefix.
+//       --to <time>            The first time after the grid.
+//       --value temperature|humidity|both
+//       --events               Write all records in time order, without resampling.
+//
+
+
+#include "CommandLine.h"
+#include "ExportFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+
+// One exported log which is merged.
+//
+struct Input
+{
+    ExportReader reader;
+    std::string name;
+    bool hasPrevious; // If there is a record at or before the current time.
+    ExportRecord previous;
+    bool hasNext; // If there is a record after the current time.
+    ExportRecord next;
+    uint32_t skippedRecords; // Records skipped because the time went backwards.
+    uint32_t gaps; // The number of empty cells in the grid.
+};
+
+    
+// The options of the merge.
+//
+struct Options
+{
+    uint32_t step;
+    uint32_t gap;
+    bool hasFrom;
+    uint32_t from;
+    bool hasTo;
+    uint32_t to;
+    bool writeTemperature;
+    bool writeHumidity;
+    bool events;
+};
+
+    
+// The heap entry for an input, ordered by the time of its next record.
+//
+typedef std::pair<uint32_t, size_t> HeapEntry;
+typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > Heap;
+
+    
+std::string getInputName(const char *path)
+{
+    if (strcmp(path, "-") == 0) {
+        return "stdin";
+    }
+    std::string name = path;
+    const size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) {
+        name = name.substr(slash + 1);
+    }
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) {
+        name = name.substr(0, dot);
+    }
+    return name;
+}
+
+    
+// Read the next record of an input into `next`.
+//
+// The logger writes the records of a run in time order. A record which
+// goes back in time, for example after the clock was set, is skipped.
+//
+void readNext(Input &input)
+{
+    input.hasNext = false;
+    ExportRecord record;
+    while (input.reader.read(record)) {
+        if (input.hasPrevious && record.time < input.previous.time) {
+            ++input.skippedRecords;
+            continue;
+        }
+        input.next = record;
+        input.hasNext = true;
+        return;
+    }
+}
+
+    
+// Move an input to its next record and put it back on the heap.
+//
+void advance(std::vector<Input> &inputs, size_t index, Heap &heap)
+{
+    Input &input = inputs[index];
+    input.previous = input.next;
+    input.hasPrevious = true;
+    readNext(input);
+    if (input.hasNext) {
+        heap.push(HeapEntry(input.next.time, index));
+    }
+}
+
+    
+int16_t getValue(const ExportRecord &record, bool humidity)
+{
+    return humidity ? record.humidity : record.temperature;
+}
+
+    
+// Write the value of an input at the given grid time.
+//
+void writeCell(Input &input, uint32_t time, bool humidity, uint32_t maximumGap)
+{
+    if (input.hasPrevious && input.previous.time == time) {
+        printf(",%s", formatFixedPoint(getValue(input.previous, humidity)).c_str());
+    } else if (input.hasPrevious && input.hasNext && input.next.time - input.previous.time <= maximumGap) {
+        const double previousValue = getValue(input.previous, humidity);
+        const double nextValue = getValue(input.next, humidity);
+        const double fraction = static_cast<double>(time - input.previous.time) / (input.next.time - input.previous.time);
+        printf(",%s", formatFixedPoint(lround(previousValue + (nextValue - previousValue) * fraction)).c_str());
+    } else {
+        printf(",");
+        ++input.gaps;
+    }
+}
+
+    
+void writeEvents(std::vector<Input> &inputs, Heap &heap, const Options &options)
+{
+    printf("time,logger,temperature,humidity\n");
+    while (!heap.empty()) {
+        const size_t index = heap.top().second;
+        heap.pop();
+        advance(inputs, index, heap);
+        const ExportRecord &record = inputs[index].previous;
+        if ((options.hasFrom && record.time < options.from) || (options.hasTo && record.time >= options.to)) {
+            continue;
+        }
+        printf("%s,%s,%s,%s\n", formatTime(record.time).c_str(), inputs[index].name.c_str(),
+            formatFixedPoint(record.temperature).c_str(), formatFixedPoint(record.humidity).c_str());
+    }
+}
+
+    
+void writeGrid(std::vector<Input> &inputs, Heap &heap, const Options &options)
+{
+    printf("time");
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (options.writeTemperature) {
+            printf(",%s.temperature", inputs[i].name.c_str());
+        }
+        if (options.writeHumidity) {
+            printf(",%s.humidity", inputs[i].name.c_str());
+        }
+    }
+    printf("\n");
+    if (heap.empty()) {
+        return;
+    }
+    uint32_t time = options.hasFrom ? options.from : heap.top().first;
+    time = ((time + options.step - 1) / options.step) * options.step;
+    uint32_t lastTime = 0;
+    while (!options.hasTo || time < options.to) {
+        // Consume all records up to the grid time.
+        while (!heap.empty() && heap.top().first <= time) {
+            const size_t index = heap.top().second;
+            heap.pop();
+            advance(inputs, index, heap);
+            lastTime = std::max(lastTime, inputs[index].previous.time);
+        }
+        if (!options.hasTo && heap.empty() && time > lastTime) {
+            break;
+        }
+        printf("%s", formatTime(time).c_str());
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (options.writeTemperature) {
+                writeCell(inputs[i], time, false, options.gap);
+            }
+            if (options.writeHumidity) {
+                writeCell(inputs[i], time, true, options.gap);
+            }
+        }
+        printf("\n");
+        if (time > 0xffffffff - options.step) {
+            break;
+        }
+        time += options.step;
+    }
+}
+
+    
+bool parseSeconds(const char *text, uint32_t &seconds)
+{
+    return parseNumber(text, seconds) && seconds > 0;
+}
+
+    
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage: lrmerge [--step <seconds>] [--gap <seconds>] [--from <time>] [--to <time>]\n"
+        "    [--value temperature|humidity|both] [--events] <export>...\n");
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.step = 600;
+    options.gap = 3600;
+    options.hasFrom = false;
+    options.from = 0;
+    options.hasTo = false;
+    options.to = 0;
+    options.writeTemperature = true;
+    options.writeHumidity = true;
+    options.events = false;
+    int argumentIndex = 1;
+    for (; argumentIndex < argc && strncmp(argv[argumentIndex], "--", 2) == 0; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option == "--events") {
+            options.events = true;
+            continue;
+        }
+        if (argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--step") {
+            valid = parseSeconds(argument, options.step);
+        } else if (option == "--gap") {
+            valid = parseSeconds(argument, options.gap);
+        } else if (option == "--from") {
+            options.hasFrom = valid = parseTime(argument, options.from);
+        } else if (option == "--to") {
+            options.hasTo = valid = parseTime(argument, options.to);
+        } else if (option == "--value") {
+            const std::string value = argument;
+            options.writeTemperature = (value == "temperature" || value == "both");
+            options.writeHumidity = (value == "humidity" || value == "both");
+            valid = options.writeTemperature || options.writeHumidity;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+    if (argumentIndex >= argc) {
+        printUsage();
+        return 2;
+    }
+    
+    // Open all inputs and read their first record.
+    std::vector<Input> inputs(argc - argumentIndex);
+    Heap heap;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        Input &input = inputs[i];
+        const char *path = argv[argumentIndex + i];
+        if (!input.reader.open(path)) {
+            return 1;
+        }
+        input.name = getInputName(path);
+        input.hasPrevious = false;
+        input.skippedRecords = 0;
+        input.gaps = 0;
+        readNext(input);
+        if (input.hasNext) {
+            heap.push(HeapEntry(input.next.time, i));
+        }
+    }
+    
+    if (options.events) {
+        writeEvents(inputs, heap, options);
+    } else {
+        writeGrid(inputs, heap, options);
+    }
+    
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (inputs[i].skippedRecords > 0) {
+            fprintf(stderr, "%s: Skipped %u records which go back in time.\n", inputs[i].name.c_str(), inputs[i].skippedRecords);
+        }
+        if (inputs[i].gaps > 0) {
+            fprintf(stderr, "%s: %u gaps in the grid.\n", inputs[i].name.c_str(), inputs[i].gaps);
+        }
+    }
+    return 0;
+}
+
@@ -0,0 +1,683 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to check the rings of the log system.
+//
+// The tool runs the log system on storage images in memory, for a fixed
+// set of storage sizes. Each run appends a random mix of records, batches
+// of records, errors and sessions, restarts the log system at random, and
+// keeps a model of everything it appended. At the end, the log has to
+// match the model:
+//
+// - The records, errors, sessions and link records left in the ring.
+// - The stored rollups of each tier, and the rollups of the current hour
+//   and day, which are restored from the records after a restart.
+// - The sessions by their number, also after a corrupted link record.
+// - The statistics, and the partial statistics after the checkpoints are
+//   lost.
+// - The end of the rings after a restart without the ends in the config
+//   store. A random restart also damages one byte of the config store.
+// - The image with restarts has to be the same as without them, apart
+//   from the config store.
+//
+// Some runs simulate a flash chip. There are no rollups, a torn record at
+// the end of the log has to keep its place, and no byte may be written
+// without an erase.
+//
+// Each run prints one line. The tool fails if any check fails.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrring
+//       host/lrring.cpp host/CommandLine.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrring [options]
+//       --appends <count>   The number of appends in each run, default is 60000.
+//       --seed <number>     The seed of the first run, default is 1.
+//
+
+
+#include "CommandLine.h"
+
+#include "ConfigArea.h"
+#include "InternalLogRecord.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+// The time of the first entry.
+//
+const uint32_t FIRST_ENTRY_TIME = 1500001234;
+
+// The interval of the sessions in seconds.
+//
+const uint32_t SESSION_INTERVAL = 60;
+
+// The number of failed checks after which the tool stops.
+//
+const uint32_t MAXIMUM_FAILURES = 20;
+
+
+// One run of the check.
+//
+struct RunConfig
+{
+    uint32_t size; // The size of the storage.
+    uint32_t eraseSize; // The size of an erase sector, or 0 if the storage does not have to be erased.
+    uint32_t restartRate; // A restart for every n appends on average, or 0 for no restarts.
+    uint32_t sessionPercent; // The probability of a session for each append.
+};
+
+
+// The runs of the check.
+//
+const RunConfig RUN_CONFIGS[] = {
+    {8192, 0, 0, 1},
+    {8192, 0, 50, 1},
+    {8192, 0, 3, 1},
+    {32768, 0, 20, 1},
+    {4096, 0, 7, 1},
+    {1024, 0, 0, 1},
+    {32768, 0, 0, 10},
+    {8192, 0, 5, 10},
+    {65536, 4096, 0, 5},
+    {65536, 4096, 40, 5},
+    {16384, 512, 7, 10},
+    {16384, 256, 0, 1},
+};
+
+
+// The type of an entry in the model of the log.
+//
+enum EntryType {
+    EntryMeasurement,
+    EntrySession,
+    EntrySessionLink,
+    EntryError,
+};
+
+
+// An entry in the model of the log.
+//
+struct Entry
+{
+    EntryType type;
+    uint32_t time;
+    int16_t values[LogRecordSchema::ChannelCount];
+};
+
+
+// A rollup in the model of the log.
+//
+struct Period
+{
+    uint32_t start;
+    uint32_t count;
+    int16_t minimum[LogRecordSchema::ChannelCount];
+    int16_t maximum[LogRecordSchema::ChannelCount];
+    int64_t sum[LogRecordSchema::ChannelCount];
+
+    // Get the mean of a channel, rounded like `LogRollup`.
+    int16_t getMean(uint8_t channel) const
+    {
+        const int64_t half = count / 2;
+        return static_cast<int16_t>((sum[channel] < 0 ? sum[channel] - half : sum[channel] + half) / static_cast<int64_t>(count));
+    }
+};
+
+
+// The model of one run.
+//
+struct Model
+{
+    std::vector<Entry> entries;
+    std::vector<size_t> sessionEntries; // The index of the entry of each session.
+    std::vector<Period> hourly;
+    std::vector<Period> daily;
+};
+
+
+// A simple random generator, which does not depend on the C library.
+//
+struct Random
+{
+    uint32_t state;
+
+    uint32_t next(uint32_t range)
+    {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % range;
+    }
+};
+
+
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t appendCount;
+    uint32_t seed;
+};
+
+
+uint32_t gFailureCount = 0;
+std::string gRunName;
+
+
+// Count and report a failed check.
+//
+void check(bool condition, const char *format, ...)
+{
+    if (condition) {
+        return;
+    }
+    ++gFailureCount;
+    fprintf(stderr, "%s: ", gRunName.c_str());
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+    fprintf(stderr, "\n");
+    if (gFailureCount >= MAXIMUM_FAILURES) {
+        fprintf(stderr, "Too many failures.\n");
+        exit(1);
+    }
+}
+
+
+// Add values to the rollup of a period.
+//
+void addToPeriods(std::vector<Period> &periods, uint32_t duration, uint32_t time, uint32_t count,
+    const int16_t *minimum, const int16_t *mean, const int16_t *maximum)
+{
+    const uint32_t start = time - time % duration;
+    if (periods.empty() || periods.back().start != start) {
+        Period period;
+        memset(&period, 0, sizeof(Period));
+        period.start = start;
+        periods.push_back(period);
+    }
+    Period &period = periods.back();
+    for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+        if (period.count == 0 || minimum[channel] < period.minimum[channel]) {
+            period.minimum[channel] = minimum[channel];
+        }
+        if (period.count == 0 || maximum[channel] > period.maximum[channel]) {
+            period.maximum[channel] = maximum[channel];
+        }
+        period.sum[channel] += static_cast<int64_t>(mean[channel]) * count;
+    }
+    period.count += count;
+}
+
+
+// Add a closed hour to the daily rollups, with its rounded mean.
+//
+void addHourToDays(std::vector<Period> &daily, const Period &hour)
+{
+    int16_t mean[LogRecordSchema::ChannelCount];
+    for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+        mean[channel] = hour.getMean(channel);
+    }
+    addToPeriods(daily, 86400, hour.start, hour.count, hour.minimum, mean, hour.maximum);
+}
+
+
+// Build the rollups of the model from its measurements.
+//
+void buildPeriods(Model &model)
+{
+    for (const Entry &entry : model.entries) {
+        if (entry.type != EntryMeasurement) {
+            continue;
+        }
+        if (!model.hourly.empty() && model.hourly.back().start != entry.time - entry.time % 3600) {
+            addHourToDays(model.daily, model.hourly.back());
+        }
+        addToPeriods(model.hourly, 3600, entry.time, 1, entry.values, entry.values, entry.values);
+    }
+}
+
+
+// Check if a rollup matches a rollup of the model.
+//
+bool isSameRollup(const LogRollup &rollup, const Period &period)
+{
+    if (rollup.isNull() || rollup.getStartTime().unixtime() != period.start || rollup.getCount() != period.count) {
+        return false;
+    }
+    for (uint8_t channel = 0; channel < LogRecordSchema::ChannelCount; ++channel) {
+        if (rollup.getMinimum(channel) != period.minimum[channel] || rollup.getMaximum(channel) != period.maximum[channel] ||
+            rollup.getMean(channel) != period.getMean(channel)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Check that the ends of the rings are found without the config store.
+//
+void checkWithoutStoredEnds(const std::vector<uint8_t> &image, const RunConfig &config, const LogSystem &logSystem)
+{
+    std::vector<uint8_t> copy(image);
+    memset(copy.data() + CONFIG_STORE_OFFSET, 0x55, CONFIG_STORE_SIZE);
+    Storage storage;
+    storage.setImage(copy.data(), config.size, config.eraseSize);
+    LogSystem copyLogSystem(CONFIG_AREA_SIZE, &storage);
+    copyLogSystem.begin();
+    check(copyLogSystem.totalNumberOfRecords() == logSystem.totalNumberOfRecords(), "%u records without the stored end, expected %u",
+        copyLogSystem.totalNumberOfRecords(), logSystem.totalNumberOfRecords());
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        const LogRollup::Tier rollupTier = static_cast<LogRollup::Tier>(tier);
+        check(copyLogSystem.currentNumberOfRollups(rollupTier) == logSystem.currentNumberOfRollups(rollupTier),
+            "tier %u: wrong number of rollups without the stored end", tier);
+    }
+}
+
+
+// Append random entries to the log and to the model.
+//
+// @return The time of the next entry.
+//
+uint32_t appendEntries(std::vector<uint8_t> &image, Storage &storage, LogSystem *&logSystem,
+    const RunConfig &config, const Options &options, uint32_t seed, Model &model)
+{
+    const bool hasConfigStore = (config.eraseSize == 0 && config.size > CONFIG_SMALL_STORAGE_SIZE);
+    // The restarts use their own generator, so the entries do not depend on them.
+    Random random = {seed};
+    Random restartRandom = {seed ^ 0x5a5a5a5au};
+    uint32_t time = FIRST_ENTRY_TIME;
+    for (uint32_t append = 0; append < options.appendCount; ++append) {
+        if (config.restartRate > 0 && restartRandom.next(config.restartRate) == 0) {
+            delete logSystem;
+            if (hasConfigStore && restartRandom.next(4) == 0) {
+                image[CONFIG_STORE_OFFSET + restartRandom.next(CONFIG_STORE_SIZE)] ^= 0x5a;
+            }
+            logSystem = new LogSystem(CONFIG_AREA_SIZE, &storage);
+            logSystem->begin();
+            if (hasConfigStore) {
+                checkWithoutStoredEnds(image, config, *logSystem);
+            }
+        }
+        const uint32_t kind = random.next(100);
+        if (kind < config.sessionPercent || append == 0) {
+            logSystem->appendSession(DateTime(time), SESSION_INTERVAL);
+            model.sessionEntries.push_back(model.entries.size());
+            model.entries.push_back({EntrySession, time, {0, 0}});
+            model.entries.push_back({EntrySessionLink, time, {0, 0}});
+        } else if (kind < config.sessionPercent + 3) {
+            logSystem->appendError(LogError(DateTime(time), LogError::SensorTimeout, 3));
+            model.entries.push_back({EntryError, time, {0, 0}});
+        } else {
+            int16_t values[LogRecordSchema::ChannelCount];
+            values[0] = static_cast<int16_t>(static_cast<int32_t>(random.next(1200)) - 400);
+            values[1] = static_cast<int16_t>(random.next(1001));
+            if (kind < 10) {
+                const LogRecord logRecords[3] = {
+                    LogRecord(DateTime(time), values),
+                    LogRecord(DateTime(time + 20), values),
+                    LogRecord(DateTime(time + 40), values)};
+                logSystem->appendRecords(logRecords, 3);
+                for (uint32_t i = 0; i < 3; ++i) {
+                    model.entries.push_back({EntryMeasurement, time + 20 * i, {values[0], values[1]}});
+                }
+            } else {
+                logSystem->appendRecord(LogRecord(DateTime(time), values));
+                model.entries.push_back({EntryMeasurement, time, {values[0], values[1]}});
+            }
+        }
+        // Leave a gap of several hours from time to time.
+        time += 60 + random.next(60) + (random.next(500) == 0 ? 20000 : 0);
+    }
+    return time;
+}
+
+
+// Check the entries left in the ring.
+//
+void checkEntries(const Model &model, const LogSystem &logSystem)
+{
+    const size_t first = model.entries.size() - logSystem.currentNumberOfRecords();
+    for (uint32_t index = 0; index < logSystem.currentNumberOfRecords(); ++index) {
+        const Entry &entry = model.entries[first + index];
+        switch (entry.type) {
+        case EntryMeasurement: {
+            const LogRecord logRecord = logSystem.getLogRecord(index);
+            check(!logRecord.isNull() && logRecord.getDateTime().unixtime() == entry.time &&
+                memcmp(logRecord.getValues(), entry.values, sizeof(entry.values)) == 0, "record %u differs", index);
+            break;
+        }
+        case EntrySession:
+            check(!logSystem.getSessionAtRecord(index).isNull(), "record %u is no session", index);
+            break;
+        case EntrySessionLink:
+            check(logSystem.getSessionAtRecord(index).isNull() && logSystem.getLogRecord(index).isNull() &&
+                logSystem.getErrorAtRecord(index).isNull(), "record %u is no link", index);
+            break;
+        case EntryError:
+            check(!logSystem.getErrorAtRecord(index).isNull(), "record %u is no error", index);
+            break;
+        }
+    }
+}
+
+
+// Check the stored rollups and the rollups of the current periods.
+//
+void checkRollups(const Model &model, const LogSystem &logSystem)
+{
+    if (model.hourly.empty()) {
+        check(logSystem.currentNumberOfRollups(LogRollup::Hourly) == 0 && logSystem.getCurrentRollup(LogRollup::Hourly).isNull(),
+            "rollups without records");
+        return;
+    }
+    for (uint8_t tier = 0; tier < LogRollup::TierCount; ++tier) {
+        const LogRollup::Tier rollupTier = static_cast<LogRollup::Tier>(tier);
+        const std::vector<Period> &periods = (rollupTier == LogRollup::Daily ? model.daily : model.hourly);
+        // The last hour is still open. The last day is open, unless the open hour starts the next day.
+        const Period &hour = model.hourly.back();
+        size_t closedCount = periods.size() - 1;
+        if (rollupTier == LogRollup::Daily && (periods.empty() || periods.back().start != hour.start - hour.start % 86400)) {
+            closedCount = periods.size();
+        }
+        const uint32_t count = logSystem.currentNumberOfRollups(rollupTier);
+        const size_t expectedCount = (closedCount < logSystem.maximumNumberOfRollups(rollupTier) ? closedCount : logSystem.maximumNumberOfRollups(rollupTier));
+        check(count == expectedCount, "tier %u: %u rollups, expected %u", tier, count, static_cast<unsigned>(expectedCount));
+        for (uint32_t index = 0; index < count && count == expectedCount; ++index) {
+            check(isSameRollup(logSystem.getRollup(rollupTier, index), periods[closedCount - count + index]), "tier %u: rollup %u differs", tier, index);
+        }
+    }
+    if (logSystem.maximumNumberOfRollups(LogRollup::Hourly) == 0) {
+        check(logSystem.getCurrentRollup(LogRollup::Hourly).isNull(), "current hour without rollups");
+        return;
+    }
+    const Period &hour = model.hourly.back();
+    check(isSameRollup(logSystem.getCurrentRollup(LogRollup::Hourly), hour), "current hour differs");
+    std::vector<Period> daily(model.daily);
+    addHourToDays(daily, hour);
+    check(isSameRollup(logSystem.getCurrentRollup(LogRollup::Daily), daily.back()), "current day differs");
+}
+
+
+// Check the sessions, also with a corrupted link record.
+//
+void checkSessions(const std::vector<uint8_t> &image, const RunConfig &config, const Model &model, LogSystem &logSystem)
+{
+    const uint32_t sessionCount = static_cast<uint32_t>(model.sessionEntries.size());
+    check(logSystem.currentNumberOfSessions() == sessionCount, "%u sessions, expected %u", logSystem.currentNumberOfSessions(), sessionCount);
+    const size_t first = model.entries.size() - logSystem.currentNumberOfRecords();
+    uint32_t sessionsInRing = 0;
+    for (uint32_t session = 0; session < sessionCount; ++session) {
+        const LogSession logSession = logSystem.getSession(static_cast<uint16_t>(session));
+        const size_t entry = model.sessionEntries[session];
+        if (entry >= first) {
+            check(!logSession.isNull() && logSession.getRecordIndex() == entry - first, "session %u not found", session);
+            ++sessionsInRing;
+        } else {
+            check(logSession.isNull(), "overwritten session %u found", session);
+        }
+    }
+    if (sessionsInRing <= LOG_SESSION_INDEX_SIZE + 4) {
+        return;
+    }
+    // Corrupt the link of a session older than the ones in the index. The
+    // chain ends there for the older sessions, the numbers do not shift.
+    const uint32_t brokenSession = sessionCount - LOG_SESSION_INDEX_SIZE - 2;
+    const LogSystem::Layout layout = LogSystem::getLayout(config.size, getConfigAreaSize(config.size), config.eraseSize);
+    const uint32_t firstNumber = logSystem.totalNumberOfRecords() - logSystem.currentNumberOfRecords();
+    const uint32_t linkSlot = (firstNumber + (model.sessionEntries[brokenSession] - first) + 1) % logSystem.maximumNumberOfRecords();
+    std::vector<uint8_t> copy(image);
+    copy[layout.recordStart + linkSlot * sizeof(InternalLogRecord) + offsetof(InternalLogRecord, sessionLink)] ^= 0x10;
+    Storage storage;
+    storage.setImage(copy.data(), config.size, config.eraseSize);
+    LogSystem copyLogSystem(CONFIG_AREA_SIZE, &storage);
+    copyLogSystem.begin();
+    for (uint32_t session = 0; session < sessionCount; ++session) {
+        const LogSession logSession = copyLogSystem.getSession(static_cast<uint16_t>(session));
+        const size_t entry = model.sessionEntries[session];
+        if (session > brokenSession && entry >= first) {
+            check(!logSession.isNull() && logSession.getRecordIndex() == entry - first, "session %u not found after a corrupted link", session);
+        } else {
+            check(logSession.isNull(), "session %u found behind a corrupted link", session);
+        }
+    }
+}
+
+
+// Check the statistics, and the partial statistics without the checkpoints.
+//
+void checkStatistics(const std::vector<uint8_t> &image, const RunConfig &config, const Model &model, LogSystem &logSystem, uint32_t time)
+{
+    uint32_t measurementCount = 0;
+    for (const Entry &entry : model.entries) {
+        measurementCount += (entry.type == EntryMeasurement ? 1 : 0);
+    }
+    check(logSystem.getStatistics().getCount() == measurementCount && logSystem.getStatistics().isComplete(),
+        "statistics with %u records, expected %u", logSystem.getStatistics().getCount(), measurementCount);
+    std::vector<uint8_t> copy(image);
+    if (config.eraseSize > 0) {
+        const LogSystem::Layout layout = LogSystem::getLayout(config.size, getConfigAreaSize(config.size), config.eraseSize);
+        memset(copy.data() + layout.checkpointStart, 0xff, CheckpointArea::SectorCount * config.eraseSize);
+    } else {
+        memset(copy.data() + CONFIG_STATISTICS_OFFSET, 0x55, CONFIG_STATISTICS_SIZE);
+    }
+    uint32_t measurementsInRing = 0;
+    for (size_t index = model.entries.size() - logSystem.currentNumberOfRecords(); index < model.entries.size(); ++index) {
+        measurementsInRing += (model.entries[index].type == EntryMeasurement ? 1 : 0);
+    }
+    Storage storage;
+    storage.setImage(copy.data(), config.size, config.eraseSize);
+    LogSystem copyLogSystem(CONFIG_AREA_SIZE, &storage);
+    copyLogSystem.begin();
+    const bool isComplete = (logSystem.totalNumberOfRecords() == logSystem.currentNumberOfRecords());
+    check(copyLogSystem.getStatistics().isComplete() == isComplete && copyLogSystem.getStatistics().getCount() == measurementsInRing,
+        "rebuilt statistics with %u records, expected %u", copyLogSystem.getStatistics().getCount(), measurementsInRing);
+    // The rebuilt statistics are a checkpoint again.
+    copyLogSystem.appendRecord(LogRecord(DateTime(time), 1, 2));
+    LogSystem restartedLogSystem(CONFIG_AREA_SIZE, &storage);
+    restartedLogSystem.begin();
+    check(restartedLogSystem.getStatistics().isComplete() == isComplete && restartedLogSystem.getStatistics().getCount() == measurementsInRing + 1,
+        "rebuilt statistics lost after a restart");
+}
+
+
+// Check that a torn record at the end of the log keeps its place on a storage which has to be erased.
+//
+void checkTornRecord(const std::vector<uint8_t> &image, const RunConfig &config, const LogSystem &logSystem, uint32_t time)
+{
+    const LogSystem::Layout layout = LogSystem::getLayout(config.size, getConfigAreaSize(config.size), config.eraseSize);
+    std::vector<uint8_t> copy(image);
+    Storage storage;
+    storage.setImage(copy.data(), config.size, config.eraseSize);
+    uint32_t firstNumber;
+    {
+        // Only the first bytes of the record reach the storage. Its sectors
+        // were erased first, which can remove the oldest records.
+        LogSystem copyLogSystem(CONFIG_AREA_SIZE, &storage);
+        copyLogSystem.begin();
+        copyLogSystem.appendRecord(LogRecord(DateTime(time), 3, 4));
+        firstNumber = copyLogSystem.totalNumberOfRecords() - copyLogSystem.currentNumberOfRecords();
+        const uint32_t tornSlot = logSystem.totalNumberOfRecords() % logSystem.maximumNumberOfRecords();
+        memset(copy.data() + layout.recordStart + tornSlot * sizeof(InternalLogRecord) + 5, 0xff, sizeof(InternalLogRecord) - 5);
+    }
+    LogSystem copyLogSystem(CONFIG_AREA_SIZE, &storage);
+    copyLogSystem.begin();
+    check(copyLogSystem.totalNumberOfRecords() == logSystem.totalNumberOfRecords() + 1 &&
+        copyLogSystem.totalNumberOfRecords() - copyLogSystem.currentNumberOfRecords() == firstNumber &&
+        copyLogSystem.getLogRecord(copyLogSystem.currentNumberOfRecords() - 1).isNull(), "the torn record lost its place");
+    copyLogSystem.appendRecord(LogRecord(DateTime(time + 60), 1, 2));
+    LogSystem restartedLogSystem(CONFIG_AREA_SIZE, &storage);
+    restartedLogSystem.begin();
+    check(restartedLogSystem.totalNumberOfRecords() == logSystem.totalNumberOfRecords() + 2 &&
+        restartedLogSystem.getLogRecord(restartedLogSystem.currentNumberOfRecords() - 1).getHumidity() == 2,
+        "no record behind the torn record");
+}
+
+
+// Check a format of the log.
+//
+void checkFormat(Storage &storage, LogSystem *&logSystem, uint32_t time)
+{
+    logSystem->format();
+    delete logSystem;
+    logSystem = new LogSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem->begin();
+    check(logSystem->currentNumberOfRecords() == 0 && logSystem->currentNumberOfRollups(LogRollup::Hourly) == 0 &&
+        logSystem->currentNumberOfRollups(LogRollup::Daily) == 0 && logSystem->getCurrentRollup(LogRollup::Daily).isNull(),
+        "the log is not empty after a format");
+    logSystem->appendRecord(LogRecord(DateTime(time), 1, 2));
+    delete logSystem;
+    logSystem = new LogSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem->begin();
+    check(logSystem->currentNumberOfRecords() == 1 && logSystem->getLogRecord(0).getHumidity() == 2, "no record after a format");
+}
+
+
+// Fill a log and compare it with the model.
+//
+// @param image The image of the storage after the appends.
+//
+void run(const RunConfig &config, const Options &options, uint32_t seed, std::vector<uint8_t> &image)
+{
+    image.assign(config.size, config.eraseSize > 0 ? 0xff : 0x55);
+    Storage storage;
+    storage.setImage(image.data(), config.size, config.eraseSize);
+    const uint64_t initialViolations = Storage::getEraseViolations();
+    LogSystem *logSystem = new LogSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem->begin();
+    logSystem->format();
+    Model model;
+    const uint32_t time = appendEntries(image, storage, logSystem, config, options, seed, model);
+    buildPeriods(model);
+    if (config.restartRate > 0) {
+        delete logSystem;
+        logSystem = new LogSystem(CONFIG_AREA_SIZE, &storage);
+        logSystem->begin();
+    }
+    const uint32_t capacity = logSystem->maximumNumberOfRecords();
+    check(logSystem->totalNumberOfRecords() == model.entries.size(), "%u records written, expected %u",
+        logSystem->totalNumberOfRecords(), static_cast<unsigned>(model.entries.size()));
+    // The ring is full once it wrapped. On a flash chip, up to two sectors ahead of the log are erased.
+    const uint32_t totalCount = logSystem->totalNumberOfRecords();
+    const uint32_t currentCount = logSystem->currentNumberOfRecords();
+    uint32_t minimumCount = capacity;
+    if (config.eraseSize > 0) {
+        minimumCount -= 2 * config.eraseSize / sizeof(InternalLogRecord) + 2;
+    }
+    check(currentCount <= capacity && currentCount <= totalCount && (currentCount >= minimumCount || currentCount == totalCount),
+        "%u records in a ring of %u", currentCount, capacity);
+    checkEntries(model, *logSystem);
+    checkRollups(model, *logSystem);
+    if (config.eraseSize > 0) {
+        checkTornRecord(image, config, *logSystem, time);
+    }
+    checkSessions(image, config, model, *logSystem);
+    checkStatistics(image, config, model, *logSystem, time);
+    check(Storage::getEraseViolations() == initialViolations, "bytes written without an erase");
+    printf("%s: capacity %u, rollups %u/%u, records %u, sessions %u\n", gRunName.c_str(), capacity,
+        static_cast<unsigned>(logSystem->maximumNumberOfRollups(LogRollup::Hourly)),
+        static_cast<unsigned>(logSystem->maximumNumberOfRollups(LogRollup::Daily)),
+        logSystem->totalNumberOfRecords(), static_cast<unsigned>(model.sessionEntries.size()));
+    std::vector<uint8_t> finalImage(image);
+    checkFormat(storage, logSystem, time);
+    delete logSystem;
+    image.swap(finalImage);
+}
+
+
+// Get the name of a run for the output.
+//
+std::string getRunName(const RunConfig &config, uint32_t seed)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "size %u, sector %u, restarts 1/%u, sessions %u%%, seed %u",
+        config.size, config.eraseSize, config.restartRate, config.sessionPercent, seed);
+    return name;
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.appendCount = 60000;
+    options.seed = 1;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (argumentIndex + 1 >= argc) {
+            fprintf(stderr, "Usage: lrring [--appends <count>] [--seed <number>]\n");
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--appends") {
+            valid = parseNumber(argument, options.appendCount) && options.appendCount > 0;
+        } else if (option == "--seed") {
+            valid = parseNumber(argument, options.seed);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+
+    const uint32_t runCount = sizeof(RUN_CONFIGS) / sizeof(RunConfig);
+    for (uint32_t runIndex = 0; runIndex < runCount; ++runIndex) {
+        const RunConfig &config = RUN_CONFIGS[runIndex];
+        const uint32_t seed = options.seed + runIndex;
+        gRunName = getRunName(config, seed);
+        std::vector<uint8_t> image;
+        run(config, options, seed, image);
+        if (config.restartRate == 0) {
+            continue;
+        }
+        // The restarts must not change the log, only the config store.
+        RunConfig steadyConfig = config;
+        steadyConfig.restartRate = 0;
+        gRunName = getRunName(steadyConfig, seed);
+        std::vector<uint8_t> steadyImage;
+        run(steadyConfig, options, seed, steadyImage);
+        if (config.eraseSize == 0 && config.size > CONFIG_SMALL_STORAGE_SIZE) {
+            memset(image.data() + CONFIG_STORE_OFFSET, 0, CONFIG_STORE_SIZE);
+            memset(steadyImage.data() + CONFIG_STORE_OFFSET, 0, CONFIG_STORE_SIZE);
+        }
+        check(image == steadyImage, "the restarts changed the log");
+    }
+    printf("Runs: %u, failed checks: %u\n", runCount, gFailureCount);
+    return gFailureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to benchmark the sequential scan of the log.
+//
+// The tool reads all records of the log three times: by index, with
+// `getLogRecord`, `getSessionAtRecord` and `getErrorAtRecord` like the
+// dump of the application did, with the views of a cursor, and with a
+// cursor which also decodes each record with its time.
+//
+// Without an image, the log is filled in memory with the given number
+// of records. A session is started every 10000 records, and every 1000th
+// record is an error.
+//
+// The benchmark reports the time and the number of storage reads for each
+// record. On the device, each read addresses the storage again, which is
+// an I2C or SPI transaction.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrscan
+//       host/lrscan.cpp host/CommandLine.cpp host/ImageFile.cpp host/HostArduino.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp
+//
+// Usage:
+//
+//   lrscan [options] [<image>]
+//       --records <count>   The number of records to write without image, default is 1000000.
+//       --repeat <count>    The number of scans for each method, default is 5.
+//
+
+
+#include "CommandLine.h"
+#include "ImageFile.h"
+
+#include "ConfigArea.h"
+#include "InternalLogRecord.h"
+#include "LogSystem.h"
+#include "Storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+// The time of the first record.
+//
+const uint32_t FIRST_RECORD_TIME = 1500000000;
+
+// The interval between two records in seconds.
+//
+const uint32_t RECORD_INTERVAL = 60;
+
+// The number of records of a session.
+//
+const uint32_t SESSION_RECORDS = 10000;
+
+// The number of records between two errors.
+//
+const uint32_t ERROR_RECORDS = 1000;
+
+
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t recordCount;
+    uint32_t repeatCount;
+    const char *path;
+};
+
+
+// The result of one scan method.
+//
+struct ScanResult
+{
+    uint64_t nanos; // The time of the fastest scan.
+    uint64_t reads; // The storage reads of one scan.
+    uint64_t bytes; // The bytes read in one scan.
+    uint64_t checksum; // The sum of the times of all valid records.
+};
+
+
+// Get a monotonic time in nanoseconds.
+//
+uint64_t getNanos()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+
+// Get the size of a storage which keeps the given number of records.
+//
+uint32_t getStorageSize(uint32_t recordCount)
+{
+    uint32_t size = getConfigAreaSize(0) + sizeof(InternalLogHeader);
+    uint32_t currentCount = 0;
+    while ((currentCount = LogSystem::getLayout(size, getConfigAreaSize(size), 0).recordCount) < recordCount) {
+        size += (recordCount - currentCount) * sizeof(InternalLogRecord) + sizeof(InternalLogRollup);
+    }
+    return size;
+}
+
+
+// Fill a formatted log with records, sessions and errors.
+//
+bool fillLog(LogSystem &logSystem, uint32_t recordCount)
+{
+    uint32_t time = FIRST_RECORD_TIME;
+    for (uint32_t number = 0; number < recordCount; ++number) {
+        bool success;
+        if (number % SESSION_RECORDS == 0) {
+            success = logSystem.appendSession(DateTime(time), RECORD_INTERVAL);
+        } else if (number % ERROR_RECORDS == 0) {
+            success = logSystem.appendError(LogError(DateTime(time), LogError::SensorTimeout, 3));
+        } else {
+            success = logSystem.appendRecord(LogRecord(DateTime(time),
+                static_cast<int16_t>(number % 500), static_cast<int16_t>(number % 1000)));
+        }
+        if (!success) {
+            return false;
+        }
+        time += RECORD_INTERVAL;
+    }
+    return true;
+}
+
+
+// Read all records by index, like the dump of the application did.
+//
+uint64_t scanByIndex(const LogSystem &logSystem)
+{
+    uint64_t checksum = 0;
+    for (uint32_t i = 0; i < logSystem.currentNumberOfRecords(); ++i) {
+        const LogRecord record = logSystem.getLogRecord(i);
+        if (!record.isNull()) {
+            checksum += record.getDateTime().unixtime() + record.getTemperature();
+        } else {
+            const LogSession session = logSystem.getSessionAtRecord(i);
+            if (!session.isNull()) {
+                checksum += session.getStartTime().unixtime();
+            } else {
+                const LogError error = logSystem.getErrorAtRecord(i);
+                if (!error.isNull()) {
+                    checksum += error.getDateTime().unixtime();
+                }
+            }
+        }
+    }
+    return checksum;
+}
+
+
+// Read all records with the views of a cursor, without decoding them.
+//
+uint64_t scanViews(const LogSystem &logSystem)
+{
+    uint64_t checksum = 0;
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        if (view.getType() == LogRecordView::Measurement) {
+            checksum += view.getUnixtime() + view.getValue(LogChannelTemperature);
+        } else if (view.getType() == LogRecordView::Session || view.getType() == LogRecordView::Error) {
+            checksum += view.getUnixtime();
+        }
+    }
+    return checksum;
+}
+
+
+// Read all records with a cursor, and decode each one with its time.
+//
+uint64_t scanDecoded(const LogSystem &logSystem)
+{
+    uint64_t checksum = 0;
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        if (view.getType() == LogRecordView::Measurement) {
+            const LogRecord record = view.getLogRecord();
+            checksum += record.getDateTime().unixtime() + record.getTemperature();
+        } else if (view.getType() == LogRecordView::Session || view.getType() == LogRecordView::Error) {
+            checksum += view.getDateTime().unixtime();
+        }
+    }
+    return checksum;
+}
+
+
+// Run one scan method several times, and keep the fastest run.
+//
+ScanResult runScan(const LogSystem &logSystem, uint64_t (*scan)(const LogSystem&), uint32_t repeatCount)
+{
+    ScanResult result;
+    memset(&result, 0, sizeof(ScanResult));
+    for (uint32_t run = 0; run < repeatCount; ++run) {
+        const uint64_t reads = Storage::getReadCount();
+        const uint64_t bytes = Storage::getTransferredBytes();
+        const uint64_t start = getNanos();
+        result.checksum = scan(logSystem);
+        const uint64_t nanos = getNanos() - start;
+        if (run == 0 || nanos < result.nanos) {
+            result.nanos = nanos;
+        }
+        result.reads = Storage::getReadCount() - reads;
+        result.bytes = Storage::getTransferredBytes() - bytes;
+    }
+    return result;
+}
+
+
+// Print the result of one scan method.
+//
+void printResult(const char *name, const ScanResult &result, uint32_t recordCount)
+{
+    const double seconds = result.nanos / 1e9;
+    printf("%-8s %12.0f records/s %8.1f ns/record %6.2f reads/record %6.1f bytes/record\n",
+        name, recordCount / seconds, static_cast<double>(result.nanos) / recordCount,
+        static_cast<double>(result.reads) / recordCount, static_cast<double>(result.bytes) / recordCount);
+}
+
+
+// Print the usage of the tool.
+//
+void printUsage()
+{
+    fprintf(stderr, "Usage: lrscan [--records <count>] [--repeat <count>] [<image>]\n");
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.recordCount = 1000000;
+    options.repeatCount = 5;
+    options.path = 0;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option.compare(0, 2, "--") != 0 && options.path == 0 && argumentIndex + 1 == argc) {
+            options.path = argv[argumentIndex];
+            continue;
+        }
+        if (argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--records") {
+            valid = parseNumber(argument, options.recordCount) && options.recordCount > 0;
+        } else if (option == "--repeat") {
+            valid = parseNumber(argument, options.repeatCount) && options.repeatCount > 0;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+
+    ImageFile imageFile;
+    std::vector<uint8_t> image;
+    Storage storage;
+    if (options.path != 0) {
+        if (!imageFile.open(options.path)) {
+            return 1;
+        }
+        storage.setImage(imageFile.data(), imageFile.size());
+    } else {
+        image.resize(getStorageSize(options.recordCount));
+        storage.setImage(image.data(), static_cast<uint32_t>(image.size()));
+    }
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    if (options.path == 0) {
+        logSystem.format();
+        if (!fillLog(logSystem, options.recordCount)) {
+            fprintf(stderr, "Could not write the records.\n");
+            return 1;
+        }
+    }
+    const uint32_t recordCount = logSystem.currentNumberOfRecords();
+    if (recordCount == 0) {
+        fprintf(stderr, "The log is empty.\n");
+        return 1;
+    }
+    printf("Records: %u, read ahead: %u records\n", recordCount, static_cast<unsigned>(LR_LOG_CURSOR_READ_AHEAD));
+    const ScanResult indexResult = runScan(logSystem, scanByIndex, options.repeatCount);
+    const ScanResult viewResult = runScan(logSystem, scanViews, options.repeatCount);
+    const ScanResult decodedResult = runScan(logSystem, scanDecoded, options.repeatCount);
+    printResult("index", indexResult, recordCount);
+    printResult("views", viewResult, recordCount);
+    printResult("decoded", decodedResult, recordCount);
+    printf("Speedup of the views: %.2fx\n", static_cast<double>(indexResult.nanos) / viewResult.nanos);
+    if (viewResult.checksum != indexResult.checksum || decodedResult.checksum != indexResult.checksum) {
+        fprintf(stderr, "The scans read different records.\n");
+        return 1;
+    }
+    return 0;
+}
+
@@ -0,0 +1,320 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to check the task scheduler.
+//
+// The tool fills a `Scheduler` with tasks of random periods, and runs it
+// like the application: it sleeps until the earliest deadline, wakes up a
+// little late, and sometimes much later, and runs the due tasks. The
+// tasks change their own period or deadline from time to time, and some
+// run only once. After each wake-up, the tool checks:
+//
+// - A task runs exactly if its deadline passed.
+// - The next deadline of a task is in the future, and is the first one
+//   in the grid of its period. Missed deadlines are skipped.
+// - A change of the period applies from the current deadline on, and a
+//   deadline set by the task itself is kept.
+// - A task which runs once has no deadline afterwards.
+// - The earliest deadline is the minimum of the deadlines of all tasks.
+//
+// The table of tasks is also checked for its fixed size, and a short
+// fixed example is checked against known deadlines.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -Ihost/include -I. -o lrsched
+//       host/lrsched.cpp host/CommandLine.cpp host/HostArduino.cpp Scheduler.cpp
+//
+// Usage:
+//
+//   lrsched [options]
+//       --rounds <count>  The number of schedulers to fill and run, default is 1000.
+//       --seed <number>   The seed of the random tasks, default is 1.
+//
+
+
+#include "CommandLine.h"
+
+#include "Scheduler.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+
+namespace {
+
+
+// The start time of each round.
+//
+const uint32_t START_TIME = 1500000000;
+
+// The number of wake-ups in each round.
+//
+const uint32_t WAKE_UP_COUNT = 2000;
+
+// The number of failed checks after which the tool stops.
+//
+const uint32_t MAXIMUM_FAILURES = 20;
+
+
+// A simple random generator, which does not depend on the C library.
+//
+struct Random
+{
+    uint32_t state;
+
+    uint32_t next(uint32_t range)
+    {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % range;
+    }
+};
+
+
+// The state of a task, which is also its context.
+//
+struct TaskState
+{
+    Scheduler *scheduler;
+    Random *random;
+    uint8_t index; // The index of the task in the scheduler.
+    uint32_t period; // The current period, or 0 for a task which runs once.
+    uint32_t deadline; // The deadline which is expected by the check.
+    uint32_t runCount; // The number of runs since the last check.
+    uint32_t ownDeadline; // A deadline the task set while running, or `Scheduler::NoDeadline`.
+};
+
+
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t roundCount;
+    uint32_t seed;
+};
+
+
+uint32_t gFailureCount = 0;
+uint32_t gRound = 0;
+
+
+// Count and report a failed check.
+//
+void check(bool condition, const char *format, ...)
+{
+    if (condition) {
+        return;
+    }
+    ++gFailureCount;
+    fprintf(stderr, "Round %u: ", gRound);
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+    fprintf(stderr, "\n");
+    if (gFailureCount >= MAXIMUM_FAILURES) {
+        fprintf(stderr, "Too many failures.\n");
+        exit(1);
+    }
+}
+
+
+// The function of all tasks.
+//
+// Some runs change the period of the task, or set the next deadline.
+//
+void runTask(void *context)
+{
+    TaskState &state = *static_cast<TaskState*>(context);
+    ++state.runCount;
+    if (state.period == 0) {
+        return;
+    }
+    const uint32_t change = state.random->next(20);
+    if (change == 0) {
+        state.period = state.random->next(600) + 1;
+        state.scheduler->setPeriod(state.index, state.period);
+    } else if (change == 1) {
+        state.ownDeadline = state.deadline + state.random->next(1000) + 1;
+        state.scheduler->setDeadline(state.index, state.ownDeadline);
+    }
+}
+
+
+// Get the deadline which follows a run of a task.
+//
+uint32_t getNextDeadline(const TaskState &state, uint32_t currentTime)
+{
+    if (state.ownDeadline != Scheduler::NoDeadline) {
+        return state.ownDeadline;
+    }
+    if (state.period == 0) {
+        return Scheduler::NoDeadline;
+    }
+    // The first deadline of the grid after the current time.
+    return state.deadline + ((currentTime - state.deadline) / state.period + 1) * state.period;
+}
+
+
+// The context of the fixed example.
+//
+struct ExampleState
+{
+    Scheduler *scheduler;
+    uint32_t runCount;
+};
+
+
+// The periodic task of the fixed example, which changes its period in the third run.
+//
+void runExampleTask(void *context)
+{
+    ExampleState &state = *static_cast<ExampleState*>(context);
+    if (++state.runCount == 3) {
+        state.scheduler->setPeriod(0, 7);
+    }
+}
+
+
+// The task of the fixed example, which runs once.
+//
+void runExampleOnce(void *context)
+{
+    ++*static_cast<uint32_t*>(context);
+}
+
+
+// Check a fixed example with known deadlines.
+//
+void checkExample()
+{
+    Scheduler scheduler;
+    ExampleState state = {&scheduler, 0};
+    uint32_t onceCount = 0;
+    check(scheduler.addTask(&runExampleTask, &state, 10, 100) == 0, "example: wrong index of the periodic task");
+    check(scheduler.addTask(&runExampleOnce, &onceCount, 0, 105) == 1, "example: wrong index of the task which runs once");
+    const uint32_t wakeUps[] = {100, 105, 110, 120, 150};
+    const uint32_t nextDeadlines[] = {105, 110, 120, 127, 155};
+    const uint32_t runCounts[] = {1, 1, 2, 3, 4};
+    check(scheduler.getNextDeadline() == 100, "example: the first deadline is %u", scheduler.getNextDeadline());
+    for (uint8_t i = 0; i < 5; ++i) {
+        scheduler.runDueTasks(wakeUps[i]);
+        check(scheduler.getNextDeadline() == nextDeadlines[i], "example: the deadline after %u is %u, expected %u",
+            wakeUps[i], scheduler.getNextDeadline(), nextDeadlines[i]);
+        check(state.runCount == runCounts[i], "example: the periodic task ran %u times until %u", state.runCount, wakeUps[i]);
+    }
+    check(onceCount == 1, "example: the task which runs once ran %u times", onceCount);
+}
+
+
+// Fill a scheduler with random tasks and run it.
+//
+void runRound(Random &random)
+{
+    Scheduler scheduler;
+    check(scheduler.getNextDeadline() == Scheduler::NoDeadline, "a deadline without tasks");
+    TaskState states[LR_SCHEDULER_MAXIMUM_TASKS];
+    const uint8_t taskCount = static_cast<uint8_t>(random.next(LR_SCHEDULER_MAXIMUM_TASKS) + 1);
+    for (uint8_t i = 0; i < taskCount; ++i) {
+        TaskState &state = states[i];
+        state.scheduler = &scheduler;
+        state.random = &random;
+        state.period = (random.next(8) == 0 ? 0 : random.next(600) + 1);
+        state.deadline = START_TIME + random.next(1200);
+        state.runCount = 0;
+        state.ownDeadline = Scheduler::NoDeadline;
+        state.index = scheduler.addTask(&runTask, &state, state.period, state.deadline);
+        check(state.index == i, "task %u was added as %u", i, state.index);
+    }
+    if (taskCount == LR_SCHEDULER_MAXIMUM_TASKS) {
+        check(scheduler.addTask(&runTask, 0, 1, START_TIME) == Scheduler::InvalidTask, "a task was added to a full table");
+    }
+    uint32_t currentTime = START_TIME;
+    for (uint32_t wakeUp = 0; wakeUp < WAKE_UP_COUNT; ++wakeUp) {
+        uint32_t earliestDeadline = Scheduler::NoDeadline;
+        for (uint8_t i = 0; i < taskCount; ++i) {
+            if (states[i].deadline < earliestDeadline) {
+                earliestDeadline = states[i].deadline;
+            }
+        }
+        check(scheduler.getNextDeadline() == earliestDeadline, "the earliest deadline is %u, expected %u",
+            scheduler.getNextDeadline(), earliestDeadline);
+        if (earliestDeadline == Scheduler::NoDeadline) {
+            break;
+        }
+        // Wake up a little late, and sometimes much later.
+        if (earliestDeadline > currentTime) {
+            currentTime = earliestDeadline;
+        }
+        currentTime += (random.next(50) == 0 ? random.next(5000) : random.next(3));
+        scheduler.runDueTasks(currentTime);
+        for (uint8_t i = 0; i < taskCount; ++i) {
+            TaskState &state = states[i];
+            const uint32_t expectedRunCount = (state.deadline <= currentTime ? 1 : 0);
+            check(state.runCount == expectedRunCount, "task %u ran %u times, expected %u", i, state.runCount, expectedRunCount);
+            if (state.runCount > 0) {
+                state.deadline = getNextDeadline(state, currentTime);
+            }
+            state.runCount = 0;
+            state.ownDeadline = Scheduler::NoDeadline;
+        }
+    }
+}
+
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.roundCount = 1000;
+    options.seed = 1;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (argumentIndex + 1 >= argc) {
+            fprintf(stderr, "Usage: lrsched [--rounds <count>] [--seed <number>]\n");
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--rounds") {
+            valid = parseNumber(argument, options.roundCount) && options.roundCount > 0;
+        } else if (option == "--seed") {
+            valid = parseNumber(argument, options.seed);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+
+    checkExample();
+    Random random = {options.seed};
+    for (gRound = 0; gRound < options.roundCount; ++gRound) {
+        runRound(random);
+    }
+    printf("Rounds: %u, failed checks: %u\n", options.roundCount, gFailureCount);
+    return gFailureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,658 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to simulate the application against a virtual clock.
+//
+// The simulator compiles the unchanged `Application` with replacements for
+// the hardware: the pins, the timer 2 sleep, the DS1307 and the DHT22 are
+// driven by a virtual clock, which only advances when the application
+// waits, sleeps or talks to a device. A year of logging runs in seconds.
+//
+// For each selector code, the simulator reports how the samples follow
+// the logging interval and how long the processor is awake:
+//
+// - The latency is the time from the start of the RTC second of the
+//   timestamp to the sensor read. This is the jitter of the timestamps.
+// - The offset is the difference of a timestamp to the grid of the
+//   interval, which starts at the first sample.
+// - The drift is the difference of the real time of the last sample to
+//   the grid, in real time. It includes the error of the RTC.
+// - Missed intervals are grid times without a sample.
+// - With `--flash`, the storage behaves like a flash chip. The erased
+//   sectors and the writes which would need an erase are counted, the
+//   latter have to stay at zero.
+// - With `--sensor-errors`, reads of the sensor fail at random. The failed
+//   reads and the error records in the log are counted.
+// - The records are the ones left in the ring of the log at the end, the
+//   hourly and daily rollups are counted as well. On the flash chip, the
+//   ring is kept in whole erase sectors, and there are no rollups.
+//
+// The grid values are only reported for fixed intervals. The awake time
+// is modelled from the number of wake-ups, the bus transfers and the
+// waits of the application, using the cost model below. The transfers
+// of the RTC use the clock the application selected on the bus, the
+// ones of the storage are modelled as FRAM transfers at the storage clock.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -DLR_STORAGE_IMAGE -Ihost/include -I. -o lrsim host/lrsim.cpp host/CommandLine.cpp Application.cpp ModeSelector.cpp BurstBuffer.cpp Scheduler.cpp PhaseTrace.cpp LogSystem.cpp CheckpointArea.cpp ConfigStore.cpp Storage.cpp I2CBus.cpp host/HostArduino.cpp
+//
+// Usage:
+//
+//   lrsim [options]
+//       --days <days>              The simulated time, default is 365.
+//       --mode <code>[,<code>...]  The selector codes to simulate, default are all logging codes.
+//       --timer-error <ppm>        The error of the timer 2 clock, default is 0.
+//       --rtc-error <ppm>          The error of the RTC crystal, default is 0.
+//       --storage <bytes>          The size of the storage, default is 1048576.
+//       --startup-cycles <cycles>  The start-up time of the oscillator after sleep, default is 16384.
+//       --flash <bytes>            Simulate a flash chip with the given erase sector size, like 4096.
+//       --sensor-errors <percent>  The probability of a failed sensor read, default is 0.
+//       --storage-clock <hz>       The I2C clock of the storage, default is the FRAM clock of `I2CBus`.
+//       --verbose                  Show the serial output of the application.
+//
+
+
+#include "Application.h"
+
+#include "BusModel.h"
+#include "CommandLine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+// The hardware registers and the bus, see `avr/io.h` and `Wire.h`.
+volatile uint8_t SMCR = 0;
+volatile uint8_t ASSR = 0;
+volatile uint8_t TCCR2A = 0;
+volatile uint8_t TCCR2B = 0;
+volatile uint8_t TCNT2 = 0;
+volatile uint8_t OCR2A = 0;
+volatile uint8_t OCR2B = 0;
+volatile uint8_t TIMSK2 = 0;
+volatile uint8_t UCSR0A = _BV(TXC0); // The serial output is sent at once.
+TwoWire Wire;
+
+
+namespace {
+
+    
+// The time of the RTC at the start of each simulation, 2016-01-01 00:00:00.
+const uint32_t START_TIME = 1451606400UL;
+
+// The position of the virtual clock in the first RTC second.
+const uint64_t START_PHASE_NANOS = 370000000ULL;
+
+// The duration of one clock cycle of the processor.
+const double CYCLE_NANOS = 1e9 / F_CPU;
+
+// The prescalers of timer 2, for the clock select bits.
+const uint16_t TIMER2_PRESCALERS[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+    
+// The cost model for the awake time.
+//
+struct CostModel
+{
+    uint32_t startupCycles; // The start-up time of the oscillator after a wake-up.
+    uint32_t wakeCycles; // The cycles for the interrupt and the loop around the sleep.
+    uint32_t sensorReadMicros; // The time of a DHT22 read, including the start signal.
+    BusModel bus; // The time of the transfers on the I2C bus.
+    uint32_t storageClock; // The I2C clock for the transfers of the storage.
+};
+
+    
+// The options from the command line.
+//
+struct Options
+{
+    uint32_t days;
+    std::vector<uint8_t> codes;
+    double timerErrorPPM;
+    double rtcErrorPPM;
+    uint32_t storageSize;
+    uint32_t eraseSize; // The erase sector size of a simulated flash chip, or 0.
+    double sensorErrorPercent; // The probability of a failed sensor read.
+    CostModel cost;
+    bool verbose;
+};
+
+    
+// Thrown by the virtual hardware to end a simulation.
+//
+struct SimulationEnd
+{
+    uint8_t error; // The error number signalled by the application, or zero.
+};
+
+    
+// The state of the virtual hardware and the measurements of one simulation.
+//
+struct VirtualHardware
+{
+    // The clock.
+    uint64_t nanos; // The real time since the start.
+    uint64_t endNanos; // The real time to end the simulation.
+    uint64_t awakeNanos; // The modelled time the processor was awake.
+    double timerRate; // The rate of the timer 2 clock, relative to the real time.
+    double rtcRate; // The rate of the RTC, relative to the real time.
+    CostModel cost;
+    // The devices.
+    uint8_t code; // The selector code.
+    uint8_t errorBlinks; // The number of error blinks since the last pause.
+    uint32_t lastRtcTime; // The last time read from the RTC.
+    uint32_t random; // The state of the noise generator of the sensor.
+    uint32_t errorRandom; // The state of the generator for failed reads.
+    double sensorErrorPercent;
+    // The counters.
+    uint64_t wakeCount;
+    uint64_t rtcReadCount;
+    uint64_t sampleCount;
+    uint64_t sensorErrorCount;
+    // The statistics of the samples.
+    bool isGridEnabled;
+    uint32_t interval;
+    uint32_t firstTimestamp;
+    uint64_t firstSampleNanos;
+    uint32_t lastSlot;
+    uint64_t missedCount;
+    int32_t maximumOffset;
+    double drift;
+    uint64_t latencySum;
+    double latencySumOfSquares;
+    uint64_t maximumLatency;
+};
+
+VirtualHardware hardware;
+
+    
+// Advance the virtual clock.
+//
+// @param nanos The time to advance.
+// @param awake If the processor is awake during this time.
+//
+void advance(uint64_t nanos, bool awake)
+{
+    hardware.nanos += nanos;
+    if (awake) {
+        hardware.awakeNanos += nanos;
+    }
+    if (hardware.nanos >= hardware.endNanos) {
+        throw SimulationEnd{0};
+    }
+}
+
+    
+// Get the time of the RTC at the given real time.
+//
+uint32_t getRTCTime(uint64_t nanos)
+{
+    return START_TIME + static_cast<uint32_t>((nanos * hardware.rtcRate + START_PHASE_NANOS) / 1e9);
+}
+
+    
+// Get the real time at which the RTC starts the given second.
+//
+uint64_t getRTCSecondStart(uint32_t time)
+{
+    const double nanos = ((time - START_TIME) * 1e9 - START_PHASE_NANOS) / hardware.rtcRate;
+    return nanos > 0.0 ? static_cast<uint64_t>(ceil(nanos)) : 0;
+}
+
+    
+// Get a value of the simulated environment.
+//
+// The values follow a daily and a yearly cycle, with a short heat event
+// every seven hours, which lasts 15 minutes.
+//
+void getEnvironment(uint64_t nanos, int16_t &temperature, int16_t &humidity)
+{
+    const double seconds = nanos / 1e9;
+    const double day = sin(2.0 * M_PI * seconds / 86400.0);
+    const double year = sin(2.0 * M_PI * seconds / (365.0 * 86400.0));
+    const bool isEvent = fmod(seconds, 7.0 * 3600.0) < 900.0;
+    hardware.random = hardware.random * 1103515245 + 12345;
+    const int noise = static_cast<int>((hardware.random >> 16) % 3) - 1;
+    temperature = static_cast<int16_t>(lround(200.0 + 60.0 * day + 50.0 * year + (isEvent ? 60.0 : 0.0)) + noise);
+    humidity = static_cast<int16_t>(lround(550.0 - 100.0 * day - (isEvent ? 80.0 : 0.0)) + noise);
+}
+
+    
+// Add a sample to the statistics, at the current real time.
+//
+void addSample()
+{
+    ++hardware.sampleCount;
+    const uint32_t timestamp = hardware.lastRtcTime;
+    const uint64_t latency = hardware.nanos - getRTCSecondStart(timestamp);
+    hardware.latencySum += latency;
+    hardware.latencySumOfSquares += static_cast<double>(latency) * latency;
+    if (latency > hardware.maximumLatency) {
+        hardware.maximumLatency = latency;
+    }
+    if (!hardware.isGridEnabled) {
+        return;
+    }
+    if (hardware.sampleCount == 1) {
+        hardware.firstTimestamp = timestamp;
+        hardware.firstSampleNanos = hardware.nanos;
+        hardware.lastSlot = 0;
+        return;
+    }
+    const uint32_t elapsed = timestamp - hardware.firstTimestamp;
+    const uint32_t slot = (elapsed + hardware.interval / 2) / hardware.interval;
+    const int32_t offset = static_cast<int32_t>(elapsed - slot * hardware.interval);
+    if (abs(offset) > abs(hardware.maximumOffset)) {
+        hardware.maximumOffset = offset;
+    }
+    if (slot > hardware.lastSlot + 1) {
+        hardware.missedCount += slot - hardware.lastSlot - 1;
+    }
+    hardware.lastSlot = slot;
+    hardware.drift = (hardware.nanos - hardware.firstSampleNanos) / 1e9 - static_cast<double>(slot) * hardware.interval;
+}
+
+    
+}
+
+
+// The Arduino core.
+
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    // The signal LED is only switched on by the error signal.
+    if (pin == SIGNAL_LED && value == HIGH) {
+        ++hardware.errorBlinks;
+    }
+}
+
+
+int digitalRead(uint8_t pin)
+{
+    // The switches of the selector pull the pins low.
+    switch (pin) {
+    case MODE_SELECTOR_PIN_D1: return (hardware.code & B0001) != 0 ? LOW : HIGH;
+    case MODE_SELECTOR_PIN_D2: return (hardware.code & B0010) != 0 ? LOW : HIGH;
+    case MODE_SELECTOR_PIN_D4: return (hardware.code & B0100) != 0 ? LOW : HIGH;
+    case MODE_SELECTOR_PIN_D8: return (hardware.code & B1000) != 0 ? LOW : HIGH;
+    default: return HIGH;
+    }
+}
+
+
+void delay(unsigned long milliseconds)
+{
+    // The error signal pauses for a second after the blinks.
+    if (milliseconds == 1000 && hardware.errorBlinks > 0) {
+        throw SimulationEnd{hardware.errorBlinks};
+    }
+    advance(static_cast<uint64_t>(milliseconds) * 1000000ULL, true);
+}
+
+
+void delayMicroseconds(unsigned int microseconds)
+{
+    advance(static_cast<uint64_t>(microseconds) * 1000ULL, true);
+}
+
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>(hardware.nanos / 1000000ULL);
+}
+
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(hardware.nanos / 1000ULL);
+}
+
+
+// The AVR library.
+
+
+void sei()
+{
+}
+
+
+void cli()
+{
+}
+
+
+void set_sleep_mode(uint8_t)
+{
+}
+
+
+void sleep_cpu()
+{
+    if ((SMCR & _BV(SE)) == 0) {
+        return;
+    }
+    // Only the overflow of timer 2 wakes the processor.
+    const uint16_t prescaler = TIMER2_PRESCALERS[TCCR2B & 0x07];
+    if (prescaler == 0 || (TIMSK2 & _BV(TOIE2)) == 0) {
+        throw SimulationEnd{0};
+    }
+    const double cycles = (256 - TCNT2) * static_cast<double>(prescaler);
+    advance(static_cast<uint64_t>(cycles * CYCLE_NANOS / hardware.timerRate), false);
+    TCNT2 = 0;
+    ++hardware.wakeCount;
+    advance(static_cast<uint64_t>((hardware.cost.startupCycles + hardware.cost.wakeCycles) * CYCLE_NANOS), true);
+}
+
+
+void sleep_mode()
+{
+    // Power-down without interrupts, the processor never wakes again.
+    throw SimulationEnd{0};
+}
+
+
+// The devices.
+
+
+uint8_t RTC_DS1307::begin()
+{
+    return 1;
+}
+
+
+uint8_t RTC_DS1307::isrunning()
+{
+    return 1;
+}
+
+
+DateTime RTC_DS1307::now()
+{
+    ++hardware.rtcReadCount;
+    // The register address and the seven bytes of the time.
+    advance(hardware.cost.bus.getNanos(Wire.getClock(), 1, 7), true);
+    hardware.lastRtcTime = getRTCTime(hardware.nanos);
+    return DateTime(hardware.lastRtcTime);
+}
+
+
+DHT22::DHT22(uint8_t pin)
+    : _pin(pin), _pinMask(0), _pinPort(0), _pulseTimeout(0)
+{
+}
+
+
+DHT22::~DHT22()
+{
+}
+
+
+void DHT22::begin()
+{
+}
+
+
+DHT22::Measurement DHT22::readTemperatureAndHumidity()
+{
+    Measurement measurement;
+    hardware.errorRandom = hardware.errorRandom * 1103515245 + 12345;
+    if ((hardware.errorRandom >> 8) % 10000 < hardware.sensorErrorPercent * 100.0) {
+        // A failed read takes the same time, the sensor stops sending.
+        ++hardware.sensorErrorCount;
+        measurement.temperature = InvalidValue;
+        measurement.humidity = InvalidValue;
+        measurement.status = ((hardware.errorRandom >> 24) & 3) == 0 ? StatusChecksumError : StatusTimeout;
+    } else {
+        addSample();
+        getEnvironment(hardware.nanos, measurement.temperature, measurement.humidity);
+        measurement.status = StatusOk;
+    }
+    advance(static_cast<uint64_t>(hardware.cost.sensorReadMicros) * 1000ULL, true);
+    return measurement;
+}
+
+
+namespace {
+
+    
+// Run the application with one selector code.
+//
+// @return true if the simulation ran until the end or the storage was full.
+//
+bool simulate(const Options &options, uint8_t code)
+{
+    // Format the storage, like the format mode of the logger.
+    std::vector<uint8_t> image(options.storageSize, 0xff);
+    Storage::setDefaultImage(image.data(), static_cast<uint32_t>(image.size()), options.eraseSize);
+    const uint64_t initialErases = Storage::getEraseCount();
+    const uint64_t initialViolations = Storage::getEraseViolations();
+    {
+        Storage storage;
+        LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+        logSystem.begin();
+        logSystem.format();
+    }
+    const uint64_t formatBytes = Storage::getTransferredBytes();
+    const uint64_t formatTransfers = Storage::getTransferCount();
+    
+    hardware = VirtualHardware();
+    hardware.endNanos = static_cast<uint64_t>(options.days) * 86400ULL * 1000000000ULL;
+    hardware.timerRate = 1.0 + options.timerErrorPPM / 1e6;
+    hardware.rtcRate = 1.0 + options.rtcErrorPPM / 1e6;
+    hardware.cost = options.cost;
+    hardware.code = code;
+    hardware.random = code;
+    hardware.errorRandom = code + 1;
+    hardware.sensorErrorPercent = options.sensorErrorPercent;
+    SMCR = ASSR = TCCR2A = TCCR2B = TCNT2 = OCR2A = OCR2B = TIMSK2 = 0;
+    
+    ModeSelector modeSelector;
+    modeSelector.begin();
+    hardware.isGridEnabled = !modeSelector.isAdaptive() && !modeSelector.isBurst();
+    hardware.interval = modeSelector.getInterval();
+    hardware.nanos = 0;
+    
+    uint8_t error = 0;
+    Application *application = new Application();
+    try {
+        application->setup();
+        while (true) {
+            application->loop();
+        }
+    } catch (const SimulationEnd &end) {
+        error = end.error;
+    }
+    delete application;
+    const uint64_t storageNanos = options.cost.bus.getNanos(options.cost.storageClock,
+        Storage::getTransferCount() - formatTransfers, Storage::getTransferredBytes() - formatBytes);
+    
+    // Read the records back from the storage.
+    Storage storage;
+    LogSystem logSystem(CONFIG_AREA_SIZE, &storage);
+    logSystem.begin();
+    uint32_t recordCount = 0;
+    uint32_t errorRecordCount = 0;
+    for (const LogRecordView &view : logSystem.getRecords()) {
+        if (view.getType() == LogRecordView::Measurement) {
+            ++recordCount;
+        } else if (view.getType() == LogRecordView::Error) {
+            ++errorRecordCount;
+        }
+    }
+    
+    const double days = hardware.nanos / (86400.0 * 1e9);
+    const double awake = (hardware.awakeNanos + storageNanos) / 1e9;
+    const double latencyMean = hardware.sampleCount > 0 ? static_cast<double>(hardware.latencySum) / hardware.sampleCount : 0.0;
+    const double latencyDeviation = hardware.sampleCount > 0 ?
+        sqrt(fmax(0.0, hardware.latencySumOfSquares / hardware.sampleCount - latencyMean * latencyMean)) : 0.0;
+    
+    printf("%u,%s,%.2f,%llu,%u,", static_cast<unsigned>(code), reinterpret_cast<const char*>(modeSelector.getIntervalText()), days,
+        static_cast<unsigned long long>(hardware.sampleCount), recordCount);
+    if (hardware.isGridEnabled) {
+        printf("%llu,%d,%.3f,", static_cast<unsigned long long>(hardware.missedCount), hardware.maximumOffset, hardware.drift);
+    } else {
+        printf(",,,");
+    }
+    printf("%.1f,%.1f,%.1f,%.0f,%.0f,%.2f,%.3f,",
+        latencyMean / 1e6, latencyDeviation / 1e6, hardware.maximumLatency / 1e6,
+        hardware.wakeCount / days, hardware.rtcReadCount / days, awake / days, 100.0 * awake / (days * 86400.0));
+    printf("%llu,%llu,", static_cast<unsigned long long>(Storage::getEraseCount() - initialErases),
+        static_cast<unsigned long long>(Storage::getEraseViolations() - initialViolations));
+    printf("%llu,%u,", static_cast<unsigned long long>(hardware.sensorErrorCount), errorRecordCount);
+    printf("%u,%u,", static_cast<unsigned>(logSystem.currentNumberOfRollups(LogRollup::Hourly)),
+        static_cast<unsigned>(logSystem.currentNumberOfRollups(LogRollup::Daily)));
+    if (error == 0) {
+        printf("ok\n");
+    } else if (error == 5) {
+        printf("storage full\n");
+    } else {
+        printf("error %u\n", static_cast<unsigned>(error));
+    }
+    fflush(stdout);
+    return error == 0 || error == 5;
+}
+
+    
+// Parse a list of selector codes.
+//
+bool parseCodes(const char *text, std::vector<uint8_t> &codes)
+{
+    codes.clear();
+    while (*text != '\0') {
+        char *end;
+        const unsigned long code = strtoul(text, &end, 10);
+        if (end == text || code > 15 || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        codes.push_back(static_cast<uint8_t>(code));
+        text = (*end == ',' ? end + 1 : end);
+    }
+    return !codes.empty();
+}
+
+    
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage: lrsim [--days <days>] [--mode <code>[,<code>...]] [--timer-error <ppm>] [--rtc-error <ppm>]\n"
+        "    [--storage <bytes>] [--startup-cycles <cycles>] [--flash <bytes>] [--sensor-errors <percent>]\n"
+        "    [--storage-clock <hz>] [--verbose]\n");
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.days = 365;
+    options.timerErrorPPM = 0.0;
+    options.rtcErrorPPM = 0.0;
+    options.storageSize = 1048576;
+    options.eraseSize = 0;
+    options.sensorErrorPercent = 0.0;
+    options.cost.startupCycles = 16384; // 16K CK, the start-up time of the Arduino fuses.
+    options.cost.wakeCycles = 64;
+    options.cost.sensorReadMicros = 275000; // 250ms high, 20ms start signal, 5ms transfer.
+    options.cost.bus.byteCycles = BusModel::DefaultByteCycles;
+    options.cost.bus.transferCycles = BusModel::DefaultTransferCycles;
+    options.cost.storageClock = I2CBus::getClock(I2CBus::Fram);
+    options.verbose = false;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--days") {
+            valid = parseNumber(argument, options.days) && options.days > 0;
+        } else if (option == "--mode") {
+            valid = parseCodes(argument, options.codes);
+        } else if (option == "--timer-error") {
+            valid = parseDouble(argument, options.timerErrorPPM) && fabs(options.timerErrorPPM) < 100000.0;
+        } else if (option == "--rtc-error") {
+            valid = parseDouble(argument, options.rtcErrorPPM) && fabs(options.rtcErrorPPM) < 100000.0;
+        } else if (option == "--storage") {
+            valid = parseNumber(argument, options.storageSize) && options.storageSize > CONFIG_AREA_SIZE + 1024;
+        } else if (option == "--startup-cycles") {
+            valid = parseNumber(argument, options.cost.startupCycles);
+        } else if (option == "--flash") {
+            valid = parseNumber(argument, options.eraseSize) && options.eraseSize >= 256 && (options.eraseSize & (options.eraseSize-1)) == 0;
+        } else if (option == "--sensor-errors") {
+            valid = parseDouble(argument, options.sensorErrorPercent) && options.sensorErrorPercent >= 0.0 && options.sensorErrorPercent <= 100.0;
+        } else if (option == "--storage-clock") {
+            valid = parseNumber(argument, options.cost.storageClock) && options.cost.storageClock >= 10000 && options.cost.storageClock <= 3400000;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+    
+    // Simulate all logging codes by default.
+    if (options.codes.empty()) {
+        for (uint8_t code = 0; code < 16; ++code) {
+            hardware = VirtualHardware();
+            hardware.endNanos = UINT64_MAX;
+            hardware.code = code;
+            ModeSelector modeSelector;
+            modeSelector.begin();
+            if (modeSelector.getMode() == ModeSelector::Log) {
+                options.codes.push_back(code);
+            }
+        }
+    }
+    
+    // The application writes its messages to the serial.
+    FILE *serialOutput = options.verbose ? stderr : fopen("/dev/null", "w");
+    if (serialOutput == 0) {
+        fprintf(stderr, "Could not open /dev/null.\n");
+        return 1;
+    }
+    Serial.setOutput(serialOutput);
+    
+    printf("code,interval,days,samples,records,missed,max_offset_s,drift_s,latency_mean_ms,latency_deviation_ms,latency_max_ms,"
+        "wakes_per_day,rtc_reads_per_day,awake_s_per_day,duty_percent,erases,erase_violations,sensor_errors,error_records,hourly_rollups,daily_rollups,status\n");
+    bool success = true;
+    for (size_t i = 0; i < options.codes.size(); ++i) {
+        success &= simulate(options, options.codes[i]);
+    }
+    return success ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+//
+// Lucky Resistor's Data Logger (Simple Version)
+// ---------------------------------------------------------------------------
+// (c)2015 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Host tool to evaluate the phase trace of the logger.
+//
+// The logger is built with `LR_PHASE_TRACE`, see `PhaseTrace.h`. The trace
+// is captured from the serial into a text file, while the logger runs in
+// logging mode, or with the `t` command if the trace is persisted. The
+// tool reads all lines `Trace <phase> <start> <duration> <value>` of one
+// or more captures. Entries which appear in more than one dump are only
+// counted once.
+//
+// For each phase, the tool shows the number of entries, the mean and the
+// maximum duration, and a histogram of the durations in powers of two.
+//
+// The charge per sample is estimated from the awake time of all phases.
+// Each sample has one sensor phase. The times in the trace do not include
+// the start-up time of the oscillator after a wake-up, it is added for the
+// number of wake-ups of the sleep phases. With `--interval`, the charge in
+// power-save mode for the rest of the interval is added.
+//
+// Build it from the root of the repository:
+//
+//   c++ -std=c++11 -O2 -o lrtrace host/lrtrace.cpp host/CommandLine.cpp
+//
+// Usage:
+//
+//   lrtrace [options] <capture>...
+//       --active-ma <mA>           The current while awake, default is 10.
+//       --sensor-ma <mA>           The additional current while the sensor is read, default is 1.5.
+//       --sleep-ua <uA>            The current in power-save mode, default is 50.
+//       --startup-cycles <cycles>  The start-up time of the oscillator after sleep, default is 16384.
+//       --interval <seconds>       The interval of the samples, to add the charge while sleeping.
+//
+
+
+#include "CommandLine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+namespace {
+
+    
+// The clock of the processor in Hz.
+//
+const double CLOCK_HZ = 16e6;
+
+// The names of the phases, as written by the logger.
+//
+const char *PHASE_NAMES[] = {"clock", "sensor", "write", "sleep", "persist", "output"};
+const size_t PHASE_COUNT = sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]);
+
+// The number of buckets of the histograms, the last bucket is open.
+//
+const size_t BUCKET_COUNT = 24;
+
+    
+// The options from the command line.
+//
+struct Options
+{
+    double activeMilliamperes;
+    double sensorMilliamperes;
+    double sleepMicroamperes;
+    uint32_t startupCycles;
+    double interval; // The interval of the samples in seconds, or 0.
+    std::vector<std::string> paths;
+};
+
+    
+// The statistics of one phase.
+//
+struct PhaseStatistics
+{
+    uint64_t count;
+    uint64_t totalMicros;
+    uint64_t maximumMicros;
+    uint64_t totalValue;
+    uint64_t buckets[BUCKET_COUNT];
+};
+
+    
+// A single entry of the trace, to find entries which appear in more than one dump.
+//
+typedef std::tuple<uint32_t, uint32_t, uint32_t, size_t> EntryKey;
+
+    
+// Get the index of a phase by its name.
+//
+// @return The index, or `PHASE_COUNT` for an unknown phase.
+//
+size_t getPhase(const char *name)
+{
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        if (strcmp(name, PHASE_NAMES[phase]) == 0) {
+            return phase;
+        }
+    }
+    return PHASE_COUNT;
+}
+
+    
+// Get the histogram bucket for a duration.
+//
+// Bucket 0 holds durations below 2us, bucket n durations from 2^n to 2^(n+1)-1 us.
+//
+size_t getBucket(uint64_t micros)
+{
+    size_t bucket = 0;
+    while (micros > 1 && bucket < BUCKET_COUNT - 1) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+    
+// Read the trace entries of a capture.
+//
+bool readCapture(const std::string &path, std::set<EntryKey> &entries, PhaseStatistics *statistics)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == 0) {
+        fprintf(stderr, "Could not open %s.\n", path.c_str());
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != 0) {
+        char name[16];
+        unsigned long start;
+        unsigned long duration;
+        unsigned long value;
+        if (sscanf(line, "Trace %15s %lu %lu %lu", name, &start, &duration, &value) != 4) {
+            continue;
+        }
+        const size_t phase = getPhase(name);
+        if (phase == PHASE_COUNT) {
+            continue;
+        }
+        const EntryKey key(static_cast<uint32_t>(start), static_cast<uint32_t>(duration), static_cast<uint32_t>(value), phase);
+        if (!entries.insert(key).second) {
+            continue; // Already read from an earlier dump.
+        }
+        PhaseStatistics &phaseStatistics = statistics[phase];
+        ++phaseStatistics.count;
+        phaseStatistics.totalMicros += duration;
+        if (duration > phaseStatistics.maximumMicros) {
+            phaseStatistics.maximumMicros = duration;
+        }
+        phaseStatistics.totalValue += value;
+        ++phaseStatistics.buckets[getBucket(duration)];
+    }
+    fclose(file);
+    return true;
+}
+
+    
+// Print the histogram of one phase.
+//
+void printHistogram(const PhaseStatistics &statistics)
+{
+    uint64_t largestBucket = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        if (statistics.buckets[bucket] > largestBucket) {
+            largestBucket = statistics.buckets[bucket];
+        }
+    }
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        if (statistics.buckets[bucket] == 0) {
+            continue;
+        }
+        const unsigned long long low = (bucket == 0 ? 0ULL : 1ULL << bucket);
+        const int barLength = static_cast<int>(40 * statistics.buckets[bucket] / largestBucket);
+        if (bucket == BUCKET_COUNT - 1) {
+            printf("  %9llu us and more     %8llu ", low, static_cast<unsigned long long>(statistics.buckets[bucket]));
+        } else {
+            printf("  %9llu - %9llu us %8llu ", low, (2ULL << bucket) - 1, static_cast<unsigned long long>(statistics.buckets[bucket]));
+        }
+        printf("%s\n", std::string(barLength > 0 ? barLength : 1, '#').c_str());
+    }
+}
+
+    
+// Print the usage of the tool.
+//
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage: lrtrace [--active-ma <mA>] [--sensor-ma <mA>] [--sleep-ua <uA>] [--startup-cycles <cycles>]\n"
+        "    [--interval <seconds>] <capture>...\n");
+}
+
+    
+}
+
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.activeMilliamperes = 10.0;
+    options.sensorMilliamperes = 1.5;
+    options.sleepMicroamperes = 50.0;
+    options.startupCycles = 16384; // 16K CK, the start-up time of the Arduino fuses.
+    options.interval = 0.0;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::string option = argv[argumentIndex];
+        if (option.compare(0, 2, "--") != 0) {
+            options.paths.push_back(option);
+            continue;
+        }
+        if (argumentIndex + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *argument = argv[++argumentIndex];
+        bool valid = true;
+        if (option == "--active-ma") {
+            valid = parseDouble(argument, options.activeMilliamperes) && options.activeMilliamperes >= 0.0;
+        } else if (option == "--sensor-ma") {
+            valid = parseDouble(argument, options.sensorMilliamperes) && options.sensorMilliamperes >= 0.0;
+        } else if (option == "--sleep-ua") {
+            valid = parseDouble(argument, options.sleepMicroamperes) && options.sleepMicroamperes >= 0.0;
+        } else if (option == "--startup-cycles") {
+            valid = parseNumber(argument, options.startupCycles);
+        } else if (option == "--interval") {
+            valid = parseDouble(argument, options.interval) && options.interval >= 0.0;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid option: %s %s\n", option.c_str(), argument);
+            return 2;
+        }
+    }
+    if (options.paths.empty()) {
+        printUsage();
+        return 2;
+    }
+    
+    std::set<EntryKey> entries;
+    PhaseStatistics statistics[PHASE_COUNT];
+    memset(statistics, 0, sizeof(statistics));
+    for (size_t i = 0; i < options.paths.size(); ++i) {
+        if (!readCapture(options.paths[i], entries, statistics)) {
+            return 1;
+        }
+    }
+    if (entries.empty()) {
+        fprintf(stderr, "No trace entries found.\n");
+        return 1;
+    }
+    
+    // The durations of the phases.
+    printf("phase,count,mean_us,max_us,total_us,total_value\n");
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        const PhaseStatistics &phaseStatistics = statistics[phase];
+        printf("%s,%llu,%.1f,%llu,%llu,%llu\n", PHASE_NAMES[phase], static_cast<unsigned long long>(phaseStatistics.count),
+            phaseStatistics.count > 0 ? static_cast<double>(phaseStatistics.totalMicros) / phaseStatistics.count : 0.0,
+            static_cast<unsigned long long>(phaseStatistics.maximumMicros), static_cast<unsigned long long>(phaseStatistics.totalMicros),
+            static_cast<unsigned long long>(phaseStatistics.totalValue));
+    }
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        if (statistics[phase].count > 0) {
+            printf("\nHistogram of %s:\n", PHASE_NAMES[phase]);
+            printHistogram(statistics[phase]);
+        }
+    }
+    
+    // The charge per sample, in microcoulomb.
+    const uint64_t sampleCount = statistics[1].count;
+    if (sampleCount == 0) {
+        printf("\nNo sensor phases, the charge per sample is not estimated.\n");
+        return 0;
+    }
+    printf("\nCharge per sample (%llu samples):\n", static_cast<unsigned long long>(sampleCount));
+    double awakeSeconds = 0.0;
+    double totalCharge = 0.0;
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        const double seconds = statistics[phase].totalMicros / 1e6 / sampleCount;
+        double milliamperes = options.activeMilliamperes;
+        if (phase == 1) {
+            milliamperes += options.sensorMilliamperes;
+        }
+        const double charge = seconds * milliamperes * 1e3;
+        printf("  %-8s %10.1f uC (%.3f ms awake)\n", PHASE_NAMES[phase], charge, seconds * 1e3);
+        awakeSeconds += seconds;
+        totalCharge += charge;
+    }
+    const double startupSeconds = static_cast<double>(statistics[3].totalValue) / sampleCount * options.startupCycles / CLOCK_HZ;
+    const double startupCharge = startupSeconds * options.activeMilliamperes * 1e3;
+    printf("  %-8s %10.1f uC (%.3f ms for %.1f wake-ups)\n", "startup", startupCharge, startupSeconds * 1e3,
+        static_cast<double>(statistics[3].totalValue) / sampleCount);
+    awakeSeconds += startupSeconds;
+    totalCharge += startupCharge;
+    if (options.interval > 0.0) {
+        const double sleepSeconds = fmax(0.0, options.interval - awakeSeconds);
+        const double sleepCharge = sleepSeconds * options.sleepMicroamperes;
+        printf("  %-8s %10.1f uC (%.3f s)\n", "asleep", sleepCharge, sleepSeconds);
+        totalCharge += sleepCharge;
+    }
+    printf("  %-8s %10.1f uC\n", "total", totalCharge);
+    return 0;
+}